@@ -0,0 +1,186 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AttributeFile.h"
+
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr const wchar_t* DEFAULT_STYLE_PREFIX = L"Default$";
+
+// minimal parser for the subset of JSON we need: one object with scalar or array values
+class AttributeParser {
+public:
+	explicit AttributeParser(const std::string& json) : mJson(json) {}
+
+	void parse(prt::AttributeMapBuilder& amb) {
+		expect('{');
+		if (peek() == '}') {
+			mPos++;
+			return;
+		}
+		do {
+			std::wstring key = prtu::toUTF16FromUTF8(parseString());
+			if (key.find(prtu::STYLE_DELIMITER) == std::wstring::npos)
+				key = DEFAULT_STYLE_PREFIX + key;
+			expect(':');
+			parseValue(amb, key);
+		} while (consume(','));
+		expect('}');
+	}
+
+private:
+	char peek() {
+		while (mPos < mJson.size() && std::isspace(static_cast<unsigned char>(mJson[mPos])))
+			mPos++;
+		return (mPos < mJson.size()) ? mJson[mPos] : '\0';
+	}
+
+	bool consume(char c) {
+		if (peek() != c)
+			return false;
+		mPos++;
+		return true;
+	}
+
+	void expect(char c) {
+		if (!consume(c))
+			fail(std::string("expected '") + c + "'");
+	}
+
+	[[noreturn]] void fail(const std::string& what) const {
+		throw std::runtime_error("JSON syntax error at offset " + std::to_string(mPos) + ": " + what);
+	}
+
+	std::string parseString() {
+		expect('"');
+		std::string s;
+		while (mPos < mJson.size() && mJson[mPos] != '"') {
+			char c = mJson[mPos++];
+			if (c == '\\' && mPos < mJson.size()) {
+				c = mJson[mPos++];
+				switch (c) {
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case 'r': c = '\r'; break;
+					case 'u': fail("unicode escapes are not supported, use UTF-8");
+					default: break; // '"', '\\' and '/' map to themselves
+				}
+			}
+			s.push_back(c);
+		}
+		expect('"');
+		return s;
+	}
+
+	bool parseBool() {
+		for (const std::string& literal : {std::string("true"), std::string("false")}) {
+			if (mJson.compare(mPos, literal.size(), literal) == 0) {
+				mPos += literal.size();
+				return literal == "true";
+			}
+		}
+		fail("expected value");
+	}
+
+	double parseNumber() {
+		size_t length = 0;
+		double d = 0.0;
+		try {
+			d = std::stod(mJson.substr(mPos), &length);
+		}
+		catch (const std::logic_error&) {
+			fail("expected number");
+		}
+		mPos += length;
+		return d;
+	}
+
+	void parseValue(prt::AttributeMapBuilder& amb, const std::wstring& key) {
+		const char c = peek();
+		if (c == '"') {
+			amb.setString(key.c_str(), prtu::toUTF16FromUTF8(parseString()).c_str());
+		}
+		else if (c == 't' || c == 'f') {
+			amb.setBool(key.c_str(), parseBool());
+		}
+		else if (c == '[') {
+			parseArray(amb, key);
+		}
+		else {
+			amb.setFloat(key.c_str(), parseNumber());
+		}
+	}
+
+	// the type of the first element determines the array type
+	void parseArray(prt::AttributeMapBuilder& amb, const std::wstring& key) {
+		expect('[');
+		const char c = peek();
+		if (c == '"') {
+			std::vector<std::wstring> values;
+			do {
+				values.push_back(prtu::toUTF16FromUTF8(parseString()));
+			} while (consume(','));
+			const std::vector<const wchar_t*> valuePtrs = prtu::toPtrVec(values);
+			amb.setStringArray(key.c_str(), valuePtrs.data(), valuePtrs.size());
+		}
+		else if (c == 't' || c == 'f') {
+			std::vector<bool> values;
+			do {
+				values.push_back(parseBool());
+			} while (consume(','));
+			const std::unique_ptr<bool[]> boolValues(new bool[values.size()]);
+			std::copy(values.begin(), values.end(), boolValues.get());
+			amb.setBoolArray(key.c_str(), boolValues.get(), values.size());
+		}
+		else if (c != ']') {
+			std::vector<double> values;
+			do {
+				values.push_back(parseNumber());
+			} while (consume(','));
+			amb.setFloatArray(key.c_str(), values.data(), values.size());
+		}
+		expect(']');
+	}
+
+	const std::string& mJson;
+	size_t mPos = 0;
+};
+
+} // namespace
+
+namespace batch {
+
+AttributeMapUPtr readAttributes(const std::string& path) {
+	std::ifstream file(path);
+	if (!file)
+		throw std::runtime_error("cannot open '" + path + "'");
+	const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+	AttributeParser(json).parse(*amb);
+	return AttributeMapUPtr(amb->createAttributeMap());
+}
+
+} // namespace batch
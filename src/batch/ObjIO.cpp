@@ -0,0 +1,238 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ObjIO.h"
+
+#include "utils/Utilities.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr const wchar_t* MAT_DIFFUSE_COLOR = L"diffuseColor";
+constexpr const wchar_t* MAT_DIFFUSE_MAP = L"diffuseMap";
+constexpr const wchar_t* MAT_OPACITY = L"opacity";
+
+// resolves relative (negative) and 1-based obj indices to 0-based indices
+uint32_t toIndex(long objIndex, size_t count, const std::string& line) {
+	const long index = (objIndex < 0) ? static_cast<long>(count) + objIndex : objIndex - 1;
+	if (index < 0 || index >= static_cast<long>(count))
+		throw std::runtime_error("invalid vertex index in line '" + line + "'");
+	return static_cast<uint32_t>(index);
+}
+
+void writeMaterial(std::ostream& mtl, const std::string& name, const prt::AttributeMap& material) {
+	mtl << "newmtl " << name << "\n";
+
+	if (material.hasKey(MAT_DIFFUSE_COLOR) &&
+	    material.getType(MAT_DIFFUSE_COLOR) == prt::Attributable::PT_FLOAT_ARRAY) {
+		size_t count = 0;
+		const double* color = material.getFloatArray(MAT_DIFFUSE_COLOR, &count);
+		if (count >= 3)
+			mtl << "Kd " << color[0] << " " << color[1] << " " << color[2] << "\n";
+	}
+
+	if (material.hasKey(MAT_OPACITY) && material.getType(MAT_OPACITY) == prt::Attributable::PT_FLOAT)
+		mtl << "d " << material.getFloat(MAT_OPACITY) << "\n";
+
+	if (material.hasKey(MAT_DIFFUSE_MAP) && material.getType(MAT_DIFFUSE_MAP) == prt::Attributable::PT_STRING_ARRAY) {
+		size_t count = 0;
+		wchar_t const* const* maps = material.getStringArray(MAT_DIFFUSE_MAP, &count);
+		if (count > 0 && maps[0] != nullptr && maps[0][0] != L'\0')
+			mtl << "map_Kd " << prtu::toUTF8FromUTF16(maps[0]) << "\n";
+	}
+
+	mtl << "\n";
+}
+
+} // namespace
+
+namespace batch {
+
+std::vector<InitialShapeGeometry> readObj(const std::string& path) {
+	std::ifstream obj(path);
+	if (!obj)
+		throw std::runtime_error("cannot open '" + path + "'");
+
+	std::vector<double> vertexCoords; // global obj vertex list
+	std::vector<InitialShapeGeometry> shapes(1);
+	std::map<uint32_t, uint32_t> shapeVertexIndices; // global to initial shape vertex index
+
+	std::string line;
+	while (std::getline(obj, line)) {
+		std::istringstream tokens(line);
+		std::string type;
+		tokens >> type;
+
+		if (type == "v") {
+			double x = 0.0, y = 0.0, z = 0.0;
+			if (!(tokens >> x >> y >> z))
+				throw std::runtime_error("invalid vertex in line '" + line + "'");
+			vertexCoords.insert(vertexCoords.end(), {x, y, z});
+		}
+		else if (type == "o" || type == "g") {
+			if (!shapes.back().faceCounts.empty()) {
+				shapes.emplace_back();
+				shapeVertexIndices.clear();
+			}
+			std::string name;
+			std::getline(tokens >> std::ws, name);
+			shapes.back().name = prtu::toUTF16FromUTF8(name);
+		}
+		else if (type == "f") {
+			InitialShapeGeometry& shape = shapes.back();
+			uint32_t faceCount = 0;
+			std::string vertex;
+			while (tokens >> vertex) {
+				// we only need the position index of "v/vt/vn"
+				const uint32_t vi = toIndex(std::stol(vertex), vertexCoords.size() / 3, line);
+				auto it = shapeVertexIndices.find(vi);
+				if (it == shapeVertexIndices.end()) {
+					it = shapeVertexIndices.emplace(vi, static_cast<uint32_t>(shape.vertexCoords.size() / 3)).first;
+					shape.vertexCoords.insert(shape.vertexCoords.end(), vertexCoords.begin() + vi * 3,
+					                          vertexCoords.begin() + vi * 3 + 3);
+				}
+				shape.indices.push_back(it->second);
+				faceCount++;
+			}
+			if (faceCount < 3)
+				throw std::runtime_error("face with less than 3 vertices in line '" + line + "'");
+			shape.faceCounts.push_back(faceCount);
+		}
+	}
+
+	if (shapes.back().faceCounts.empty())
+		shapes.pop_back();
+	if (shapes.empty())
+		throw std::runtime_error("no faces found in '" + path + "'");
+
+	for (size_t i = 0; i < shapes.size(); i++) {
+		if (shapes[i].name.empty())
+			shapes[i].name = L"shape" + std::to_wstring(i);
+	}
+
+	return shapes;
+}
+
+int32_t computeSeed(const std::vector<InitialShapeGeometry>& shapes) {
+	// single precision sums divided by the number of vertices, like mu::computeSeed(const MFloatPointArray&)
+	float x = 0.0f;
+	float z = 0.0f;
+	size_t vertexCount = 0;
+	for (const InitialShapeGeometry& shape : shapes) {
+		for (size_t vi = 0; vi + 2 < shape.vertexCoords.size(); vi += 3) {
+			x += static_cast<float>(shape.vertexCoords[vi + 0]);
+			z += static_cast<float>(shape.vertexCoords[vi + 2]);
+		}
+		vertexCount += shape.vertexCoords.size() / 3;
+	}
+	if (vertexCount == 0)
+		return 0;
+	return prtu::computeSeed(x / static_cast<float>(vertexCount), z / static_cast<float>(vertexCount));
+}
+
+void writeObj(const std::string& path, const std::vector<InitialShapeGeometry>& shapes,
+              const std::vector<GenerationResultUPtr>& results) {
+	const size_t extPos = path.find_last_of('.');
+	const std::string mtlPath = path.substr(0, extPos) + ".mtl";
+	const size_t sepPos = mtlPath.find_last_of("/\\");
+	const std::string mtlFileName = (sepPos == std::string::npos) ? mtlPath : mtlPath.substr(sepPos + 1);
+
+	std::ofstream obj(path);
+	std::ofstream mtl(mtlPath);
+	if (!obj || !mtl)
+		throw std::runtime_error("cannot write '" + path + "'");
+	obj.precision(17);
+
+	obj << "mtllib " << mtlFileName << "\n";
+
+	// obj indices are global and 1-based
+	size_t vertexBase = 1;
+	size_t normalBase = 1;
+	size_t uvBase = 1;
+
+	for (size_t si = 0; si < results.size(); si++) {
+		const GenerationResultUPtr& result = results[si];
+		if (!result || !result->hasMesh)
+			continue;
+
+		const std::string shapeName = prtu::toUTF8FromUTF16(shapes[si].name);
+		obj << "o " << shapeName << "\n";
+
+		for (size_t i = 0; i < result->vertices.size(); i += 3)
+			obj << "v " << result->vertices[i] << " " << result->vertices[i + 1] << " " << result->vertices[i + 2]
+			    << "\n";
+		for (size_t i = 0; i < result->normals.size(); i += 3)
+			obj << "vn " << result->normals[i] << " " << result->normals[i + 1] << " " << result->normals[i + 2]
+			    << "\n";
+
+		// only the first uv set can be represented in obj
+		const bool hasUVs = !result->uvs.empty() && !result->uvs[0].empty();
+		if (hasUVs) {
+			for (size_t i = 0; i < result->uvs[0].size(); i += 2)
+				obj << "vt " << result->uvs[0][i] << " " << result->uvs[0][i + 1] << "\n";
+		}
+		const bool hasNormals = result->normalIndices.size() == result->vertexIndices.size();
+
+		std::vector<uint32_t> faceRanges = result->faceRanges;
+		if (faceRanges.size() < 2)
+			faceRanges = {0, static_cast<uint32_t>(result->faceCounts.size())};
+
+		size_t vertexIndexPos = 0;
+		size_t uvIndexPos = 0;
+		for (size_t r = 0; r + 1 < faceRanges.size(); r++) {
+			if (r < result->materials.size() && result->materials[r]) {
+				const std::string materialName = shapeName + "_material" + std::to_string(r);
+				writeMaterial(mtl, materialName, *result->materials[r]);
+				obj << "usemtl " << materialName << "\n";
+			}
+
+			for (uint32_t f = faceRanges[r]; f < faceRanges[r + 1]; f++) {
+				const uint32_t faceCount = result->faceCounts[f];
+				const bool faceHasUVs = hasUVs && result->uvCounts[0][f] == faceCount;
+
+				obj << "f";
+				for (uint32_t v = 0; v < faceCount; v++) {
+					obj << " " << vertexBase + result->vertexIndices[vertexIndexPos + v];
+					if (faceHasUVs || hasNormals)
+						obj << "/";
+					if (faceHasUVs)
+						obj << uvBase + result->uvIndices[0][uvIndexPos + v];
+					if (hasNormals)
+						obj << "/" << normalBase + result->normalIndices[vertexIndexPos + v];
+				}
+				obj << "\n";
+
+				vertexIndexPos += faceCount;
+				if (hasUVs)
+					uvIndexPos += result->uvCounts[0][f];
+			}
+		}
+
+		vertexBase += result->vertices.size() / 3;
+		normalBase += result->normals.size() / 3;
+		if (hasUVs)
+			uvBase += result->uvs[0].size() / 2;
+	}
+}
+
+} // namespace batch
@@ -0,0 +1,47 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "modifiers/GenerationResult.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace batch {
+
+struct InitialShapeGeometry {
+	std::wstring name;
+	std::vector<double> vertexCoords;
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> faceCounts;
+};
+
+// every object or group of the OBJ file becomes a separate initial shape, throws std::runtime_error on failure
+std::vector<InitialShapeGeometry> readObj(const std::string& path);
+
+// like serlioAssign, a seed derived from the centroid of all vertices of all shapes
+int32_t computeSeed(const std::vector<InitialShapeGeometry>& shapes);
+
+// writes the results as one OBJ object per initial shape and their materials as an MTL file next to it
+void writeObj(const std::string& path, const std::vector<InitialShapeGeometry>& shapes,
+              const std::vector<GenerationResultUPtr>& results);
+
+} // namespace batch
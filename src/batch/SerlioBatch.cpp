@@ -0,0 +1,232 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AttributeFile.h"
+#include "ObjIO.h"
+
+#include "PRTContext.h"
+
+#include "modifiers/MayaCallbacks.h"
+
+#include "utils/LogHandler.h"
+#include "utils/RPKUnpackStore.h"
+#include "utils/Utilities.h"
+
+#include "encoder/IMayaCallbacks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::string USAGE = R"(usage: serlio_batch --rpk <rule package> --input <initial shapes obj> --output <result obj>
+                    [--attributes <json file>] [--start-rule <style$rule>] [--seed <int>]
+                    [--ext-dir <prt extension dir>]... [--repeat <count>] [--unpack-store <dir>]
+                    [--zero-extract <texture dir>]
+
+Generates the initial shapes with the serlio encoder, without Maya, and writes the result as OBJ/MTL.
+Each object or group of the input OBJ is a separate initial shape. The seed defaults to the one serlio assigns
+to the input mesh. With --repeat, the generation is run multiple times and timed (e.g. for profiling).
+With --unpack-store, the rule package is unpacked into (or reused from) a directory shared with other runs.
+With --zero-extract, the rule package is read without unpacking it, only the textures used by the result are
+extracted into the given directory.
+)";
+
+struct Arguments {
+	std::string rpk;
+	std::string input;
+	std::string output;
+	std::string attributes;
+	std::wstring startRule;
+	bool hasSeed = false;
+	int32_t seed = 0;
+	std::vector<std::wstring> extDirs;
+	int repeat = 1;
+	std::wstring unpackStore;
+	std::wstring textureDirectory; // enables zero extract mode
+};
+
+// throws std::logic_error on invalid numbers
+bool parseArguments(int argc, char* argv[], Arguments& args) {
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (i + 1 >= argc)
+			return false;
+		const std::string value = argv[++i];
+
+		if (arg == "--rpk")
+			args.rpk = value;
+		else if (arg == "--input")
+			args.input = value;
+		else if (arg == "--output")
+			args.output = value;
+		else if (arg == "--attributes")
+			args.attributes = value;
+		else if (arg == "--start-rule")
+			args.startRule = prtu::toUTF16FromOSNarrow(value);
+		else if (arg == "--seed") {
+			args.seed = std::stoi(value);
+			args.hasSeed = true;
+		}
+		else if (arg == "--ext-dir")
+			args.extDirs.push_back(prtu::toUTF16FromOSNarrow(value));
+		else if (arg == "--repeat")
+			args.repeat = std::max(1, std::stoi(value));
+		else if (arg == "--unpack-store")
+			args.unpackStore = prtu::toUTF16FromOSNarrow(value);
+		else if (arg == "--zero-extract")
+			args.textureDirectory = prtu::toUTF16FromOSNarrow(value);
+		else
+			return false;
+	}
+	return !args.rpk.empty() && !args.input.empty() && !args.output.empty();
+}
+
+int run(const Arguments& args, PRTContext& prtCtx) {
+	const ResolveMapSPtr resolveMap = prtCtx.mResolveMapCache->get(prtu::toUTF16FromOSNarrow(args.rpk)).first;
+	if (!resolveMap) {
+		LOG_ERR << "failed to read rule package " << args.rpk;
+		return 1;
+	}
+
+	const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const wchar_t* ruleFileURI = resolveMap->getString(ruleFile.c_str());
+	if (ruleFileURI == nullptr) {
+		LOG_ERR << "could not find rule file in rule package " << args.rpk;
+		return 1;
+	}
+
+	std::wstring startRule = args.startRule;
+	if (startRule.empty()) {
+		prt::Status infoStatus = prt::STATUS_UNSPECIFIED_ERROR;
+		const RuleFileInfoUPtr info(prt::createRuleFileInfo(ruleFileURI, prtCtx.theCache.get(), &infoStatus));
+		if (!info || infoStatus != prt::STATUS_OK) {
+			LOG_ERR << "could not get rule file info from rule file " << ruleFile;
+			return 1;
+		}
+		startRule = prtu::detectStartRule(info);
+	}
+
+	const std::vector<batch::InitialShapeGeometry> shapeGeometries = batch::readObj(args.input);
+
+	AttributeMapUPtr attributes;
+	if (!args.attributes.empty()) {
+		attributes = batch::readAttributes(args.attributes);
+	}
+	else {
+		const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+		attributes.reset(amb->createAttributeMap());
+	}
+
+	// like serlioAssign, all initial shapes share the seed derived from the whole input mesh
+	const int32_t seed = args.hasSeed ? args.seed : batch::computeSeed(shapeGeometries);
+
+	InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+	std::vector<InitialShapeUPtr> shapes;
+	for (const auto& g : shapeGeometries) {
+		const prt::Status setGeoStatus =
+		        isb->setGeometry(g.vertexCoords.data(), g.vertexCoords.size(), g.indices.data(), g.indices.size(),
+		                         g.faceCounts.data(), g.faceCounts.size());
+		if (setGeoStatus != prt::STATUS_OK) {
+			LOG_ERR << "invalid geometry of initial shape " << g.name << ": "
+			        << prt::getStatusDescription(setGeoStatus);
+			return 1;
+		}
+		isb->setAttributes(ruleFile.c_str(), startRule.c_str(), seed, g.name.c_str(), attributes.get(),
+		                   resolveMap.get());
+		shapes.emplace_back(isb->createInitialShapeAndReset());
+	}
+	const InitialShapeNOPtrVector shapePtrs = prtu::toPtrVec(shapes);
+
+	const AttributeMapBuilderUPtr optionsBuilder(prt::AttributeMapBuilder::create());
+	optionsBuilder->setBool(EO_EMIT_MATERIALS, true);
+	if (!args.textureDirectory.empty())
+		optionsBuilder->setString(EO_TEXTURE_DIRECTORY, args.textureDirectory.c_str());
+	const AttributeMapUPtr unvalidatedOptions(optionsBuilder->createAttributeMap());
+	const AttributeMapUPtr mayaEncOpts = prtu::createValidatedOptions(ENCODER_ID_Maya, unvalidatedOptions.get());
+
+	const std::vector<const wchar_t*> encIDs = {ENCODER_ID_Maya};
+	const AttributeMapNOPtrVector encOpts = {mayaEncOpts.get()};
+
+	std::vector<GenerationResultUPtr> results(shapes.size());
+	for (int r = 0; r < args.repeat; r++) {
+		MayaCallbacks mayaCallbacks(shapes.size());
+
+		const auto start = std::chrono::steady_clock::now();
+		const prt::Status generateStatus =
+		        prt::generate(shapePtrs.data(), shapePtrs.size(), nullptr, encIDs.data(), encIDs.size(),
+		                      encOpts.data(), &mayaCallbacks, prtCtx.theCache.get(), nullptr);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		if (generateStatus != prt::STATUS_OK) {
+			LOG_ERR << "prt generate failed: " << prt::getStatusDescription(generateStatus);
+			return 1;
+		}
+		if (args.repeat > 1)
+			LOG_INF << "run " << r + 1 << "/" << args.repeat << ": generated " << shapes.size() << " shapes in "
+			        << elapsed.count() << " s";
+
+		for (size_t i = 0; i < shapes.size(); i++)
+			results[i] = mayaCallbacks.takeResult(i);
+	}
+
+	batch::writeObj(args.output, shapeGeometries, results);
+	return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	Arguments args;
+	bool validArgs = false;
+	try {
+		validArgs = parseArguments(argc, argv, args);
+	}
+	catch (const std::logic_error&) {
+	}
+	if (!validArgs) {
+		std::cerr << USAGE;
+		return 1;
+	}
+
+	// the serlio codec is found in the "ext" directory next to the executable or in one of the given directories
+	PRTContext prtCtx(args.extDirs);
+	if (!prtCtx.isAlive())
+		return 1;
+
+	if (!args.unpackStore.empty())
+		prtCtx.mResolveMapCache->setUnpackStore(
+		        std::make_shared<RPKUnpackStore>(args.unpackStore, RPKUnpackStore::DEFAULT_SIZE_BUDGET));
+
+	// the texture directory is given explicitly, so the textures can be kept next to the output
+	if (!args.textureDirectory.empty() && prtu::create_directory(args.textureDirectory))
+		prtCtx.mResolveMapCache->setZeroExtract(true);
+
+	try {
+		return run(args, prtCtx);
+	}
+	catch (const std::exception& e) {
+		LOG_ERR << e.what();
+		return 1;
+	}
+}
@@ -25,12 +25,15 @@ constexpr const wchar_t* ENCODER_ID_Maya = L"MayaEncoder";
 constexpr const wchar_t* EO_EMIT_ATTRIBUTES = L"emitAttributes";
 constexpr const wchar_t* EO_EMIT_MATERIALS = L"emitMaterials";
 constexpr const wchar_t* EO_EMIT_REPORTS = L"emitReports";
+constexpr const wchar_t* EO_MAX_FACES = L"maxFaces";                 // 0 means unlimited
+constexpr const wchar_t* EO_TEXTURE_DIRECTORY = L"textureDirectory"; // for textures which are not files, e.g. in rpks
 
 class IMayaCallbacks : public prt::Callbacks {
 public:
 	~IMayaCallbacks() override = default;
 
 	/**
+	 * @param initialShapeIndex index of the initial shape in the array passed to prt::generate
 	 * @param name initial shape (primitive group) name, optionally used to create primitive groups on output
 	 * @param vtx vertex coordinate array
 	 * @param length of vertex coordinate array
@@ -50,7 +53,8 @@ public:
 	 * @param shapeIDs shape ids per face, contains faceRangesSize-1 values
 	 */
 	// clang-format off
-	virtual void addMesh(const wchar_t* name,
+	virtual void addMesh(size_t initialShapeIndex,
+	                     const wchar_t* name,
 	                     const double* vtx, size_t vtxSize,
 	                     const double* nrm, size_t nrmSize,
 	                     const uint32_t* faceCounts, size_t faceCountsSize,
@@ -68,4 +72,10 @@ public:
 	                     const int32_t* shapeIDs
 	) = 0;
 	// clang-format on
+
+	/**
+	 * Polled by the encoder while generating, once it returns true no further geometry is emitted.
+	 * @return true if the result of the running generation is not needed anymore
+	 */
+	virtual bool isCancelled() const = 0;
 };
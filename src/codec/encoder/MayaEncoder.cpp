@@ -21,6 +21,7 @@
 #include "encoder/IMayaCallbacks.h"
 
 #include "prtx/Attributable.h"
+#include "prtx/DataBackend.h"
 #include "prtx/Exception.h"
 #include "prtx/ExtensionManager.h"
 #include "prtx/GenerateContext.h"
@@ -33,15 +34,21 @@
 #include "prtx/ShapeIterator.h"
 #include "prtx/URI.h"
 
+#include "prt/StringUtils.h"
 #include "prt/prt.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <numeric>
 #include <set>
 #include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 // PRT version < 2.1
@@ -117,10 +124,72 @@ std::pair<std::vector<const T*>, std::vector<size_t>> toPtrVec(const std::vector
 	return std::make_pair(pv, ps);
 }
 
-std::wstring uriToPath(const prtx::TexturePtr& t) {
-	return t->getURI()->getPath();
+std::string toOSNarrow(const std::wstring& s) {
+	std::vector<char> buffer(2 * s.size() + 1, 0);
+	size_t size = buffer.size();
+	prt::StringUtils::toOSNarrowFromUTF16(s.c_str(), buffer.data(), &size);
+	if (size > buffer.size()) {
+		buffer.resize(size);
+		prt::StringUtils::toOSNarrowFromUTF16(s.c_str(), buffer.data(), &size);
+	}
+	return std::string(buffer.data());
 }
 
+// maya's file nodes can only read plain files, so textures read directly from an rpk are written to the texture
+// directory when a material first needs them. the file name contains a hash of the URI, i.e. each one is written once.
+class TextureExtractor {
+public:
+	TextureExtractor(prt::Cache* cache, std::wstring directory) : mCache(cache), mDirectory(std::move(directory)) {}
+
+	std::wstring getPath(const prtx::TexturePtr& t) const {
+		const prtx::URIPtr& uri = t->getURI();
+		const std::wstring uriPath = uri->getPath();
+		if (mDirectory.empty() || uri->isFilePath())
+			return uriPath;
+
+		const std::wstring uriString = uri->wstring();
+		wchar_t uriHash[17];
+		std::swprintf(uriHash, 17, L"%016llx",
+		              static_cast<unsigned long long>(std::hash<std::wstring>()(uriString)));
+		const std::wstring fileName = uriPath.substr(uriPath.find_last_of(L'/') + 1);
+		const std::wstring texturePath = mDirectory + L'/' + uriHash + L'_' + fileName;
+
+		const std::string osPath = toOSNarrow(texturePath);
+		if (std::ifstream(osPath).good())
+			return texturePath;
+
+		const prtx::BinaryVectorPtr data = prtx::DataBackend::resolveBinaryData(mCache, uriString);
+		if (!data || data->empty()) {
+			srl_log_warn(L"failed to extract texture %1%") % uriString;
+			return uriPath;
+		}
+
+		// concurrent generate calls might extract the same texture, nobody must see a partially written file
+		const size_t threadHash = std::hash<std::thread::id>()(std::this_thread::get_id());
+		const std::string tmpPath = osPath + "." + std::to_string(threadHash) + ".tmp";
+		{
+			std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(data->data()), static_cast<std::streamsize>(data->size()));
+			if (!out) {
+				srl_log_warn(L"failed to write texture %1%") % texturePath;
+				out.close();
+				std::remove(tmpPath.c_str());
+				return uriPath;
+			}
+		}
+		if (std::rename(tmpPath.c_str(), osPath.c_str()) != 0)
+			std::remove(tmpPath.c_str()); // e.g. on windows, if another thread was faster
+
+		if (DBG)
+			srl_log_debug(L"extracted texture %1% to %2%") % uriString % texturePath;
+		return texturePath;
+	}
+
+private:
+	prt::Cache* mCache;
+	const std::wstring mDirectory;
+};
+
 // we blacklist all CGA-style material attribute keys, see prtx/Material.h
 const std::set<std::wstring> MATERIAL_ATTRIBUTE_BLACKLIST = {
         L"ambient.b",
@@ -206,7 +275,7 @@ const std::set<std::wstring> MATERIAL_ATTRIBUTE_BLACKLIST = {
 };
 
 void convertMaterialToAttributeMap(prtx::PRTUtils::AttributeMapBuilderPtr& aBuilder, const prtx::Material& prtxAttr,
-                                   const prtx::WStringVector& keys) {
+                                   const prtx::WStringVector& keys, const TextureExtractor& textureExtractor) {
 	if (DBG)
 		srl_log_debug(L"-- converting material: %1%") % prtxAttr.name();
 	for (const auto& key : keys) {
@@ -265,7 +334,7 @@ void convertMaterialToAttributeMap(prtx::PRTUtils::AttributeMapBuilderPtr& aBuil
 
 			case prtx::Material::PT_TEXTURE: {
 				const auto& t = prtxAttr.getTexture(key);
-				const std::wstring p = uriToPath(t);
+				const std::wstring p = textureExtractor.getPath(t);
 				aBuilder->setString(key.c_str(), p.c_str());
 				break;
 			}
@@ -274,7 +343,8 @@ void convertMaterialToAttributeMap(prtx::PRTUtils::AttributeMapBuilderPtr& aBuil
 				const auto& ta = prtxAttr.getTextureArray(key);
 
 				prtx::WStringVector pa(ta.size());
-				std::transform(ta.begin(), ta.end(), pa.begin(), uriToPath);
+				std::transform(ta.begin(), ta.end(), pa.begin(),
+				               [&textureExtractor](const prtx::TexturePtr& t) { return textureExtractor.getPath(t); });
 
 				std::vector<const wchar_t*> ppa = toPtrVec(pa);
 				aBuilder->setStringArray(key.c_str(), ppa.data(), ppa.size());
@@ -524,6 +594,8 @@ void MayaEncoder::encode(prtx::GenerateContext& context, size_t initialShapeInde
 	auto* cb = dynamic_cast<IMayaCallbacks*>(getCallbacks());
 
 	const bool emitAttrs = getOptions()->getBool(EO_EMIT_ATTRIBUTES);
+	const bool emitReports = getOptions()->getBool(EO_EMIT_REPORTS);
+	const int32_t maxFaces = getOptions()->getInt(EO_MAX_FACES);
 
 	prtx::DefaultNamePreparator namePrep;
 	prtx::NamePreparator::NamespacePtr nsMesh = namePrep.newNamespace();
@@ -531,12 +603,40 @@ void MayaEncoder::encode(prtx::GenerateContext& context, size_t initialShapeInde
 	prtx::EncodePreparatorPtr encPrep = prtx::EncodePreparator::create(true, namePrep, nsMesh, nsMaterial);
 
 	// generate geometry
-	prtx::ReportsAccumulatorPtr reportsAccumulator{prtx::WriteFirstReportsAccumulator::create()};
-	prtx::ReportingStrategyPtr reportsCollector{
-	        prtx::LeafShapeReportingStrategy::create(context, initialShapeIndex, reportsAccumulator)};
+	prtx::ReportingStrategyPtr reportsCollector;
+	if (emitReports) {
+		prtx::ReportsAccumulatorPtr reportsAccumulator{prtx::WriteFirstReportsAccumulator::create()};
+		reportsCollector = prtx::LeafShapeReportingStrategy::create(context, initialShapeIndex, reportsAccumulator);
+	}
+
+	size_t faceCount = 0;
 	prtx::LeafIteratorPtr li = prtx::LeafIterator::create(context, initialShapeIndex);
 	for (prtx::ShapePtr shape = li->getNext(); shape; shape = li->getNext()) {
-		prtx::ReportsPtr r = reportsCollector->getReports(shape->getID());
+		// the leaf iterator generates lazily, so checking here aborts the remaining generation
+		if (cb->isCancelled()) {
+			if (DBG)
+				srl_log_debug(L"generation of initial shape %1% cancelled") % initialShapeIndex;
+			return;
+		}
+
+		// stop adding leaf shapes once the face budget is exhausted (e.g. for interactive previews). The first leaf
+		// shape with faces is always added, so a too small budget still shows something.
+		if (maxFaces > 0) {
+			size_t shapeFaceCount = 0;
+			const prtx::GeometryPtr& geo = shape->getGeometry();
+			if (geo) {
+				for (const prtx::MeshPtr& mesh : geo->getMeshes())
+					shapeFaceCount += mesh->getFaceCount();
+			}
+			if (faceCount > 0 && faceCount + shapeFaceCount > static_cast<size_t>(maxFaces)) {
+				if (DBG)
+					srl_log_debug(L"face budget of %1% reached, skipping remaining leaf shapes") % maxFaces;
+				break;
+			}
+			faceCount += shapeFaceCount;
+		}
+
+		prtx::ReportsPtr r = emitReports ? reportsCollector->getReports(shape->getID()) : prtx::ReportsPtr();
 		encPrep->add(context.getCache(), shape, initialShape.getAttributeMap(), r);
 
 		// get final values of generic attributes
@@ -546,12 +646,14 @@ void MayaEncoder::encode(prtx::GenerateContext& context, size_t initialShapeInde
 
 	prtx::EncodePreparator::InstanceVector instances;
 	encPrep->fetchFinalizedInstances(instances, PREP_FLAGS);
-	convertGeometry(initialShape, instances, cb);
+	convertGeometry(initialShapeIndex, initialShape, instances, cb, context.getCache());
 }
 
-void MayaEncoder::convertGeometry(const prtx::InitialShape& initialShape,
-                                  const prtx::EncodePreparator::InstanceVector& instances, IMayaCallbacks* cb) {
+void MayaEncoder::convertGeometry(size_t initialShapeIndex, const prtx::InitialShape& initialShape,
+                                  const prtx::EncodePreparator::InstanceVector& instances, IMayaCallbacks* cb,
+                                  prt::Cache* cache) {
 	const bool emitMaterials = getOptions()->getBool(EO_EMIT_MATERIALS);
+	const TextureExtractor textureExtractor(cache, getOptions()->getString(EO_TEXTURE_DIRECTORY));
 	const bool emitReports = getOptions()->getBool(EO_EMIT_REPORTS);
 
 	prtx::GeometryPtrVector geometries;
@@ -598,7 +700,7 @@ void MayaEncoder::convertGeometry(const prtx::InitialShape& initialShape,
 			faceRanges.push_back(faceCount);
 
 			if (emitMaterials) {
-				convertMaterialToAttributeMap(amb, *(mat.get()), mat->getKeys());
+				convertMaterialToAttributeMap(amb, *(mat.get()), mat->getKeys(), textureExtractor);
 				matAttrMaps.v.push_back(amb->createAttributeMapAndReset());
 			}
 
@@ -625,8 +727,8 @@ void MayaEncoder::convertGeometry(const prtx::InitialShape& initialShape,
 	auto puvCounts = toPtrVec(sg.uvCounts);
 	auto puvIndices = toPtrVec(sg.uvIndices);
 
-	cb->addMesh(initialShape.getName(), sg.coords.data(), sg.coords.size(), sg.normals.data(), sg.normals.size(),
-	            sg.counts.data(), sg.counts.size(), sg.vertexIndices.data(), sg.vertexIndices.size(),
+	cb->addMesh(initialShapeIndex, initialShape.getName(), sg.coords.data(), sg.coords.size(), sg.normals.data(),
+	            sg.normals.size(), sg.counts.data(), sg.counts.size(), sg.vertexIndices.data(), sg.vertexIndices.size(),
 	            sg.normalIndices.data(), sg.normalIndices.size(),
 
 	            puvs.first.data(), puvs.second.data(), puvCounts.first.data(), puvCounts.second.data(),
@@ -653,6 +755,8 @@ MayaEncoderFactory* MayaEncoderFactory::createInstance() {
 	amb->setBool(EO_EMIT_ATTRIBUTES, prtx::PRTX_TRUE);
 	amb->setBool(EO_EMIT_MATERIALS, prtx::PRTX_TRUE);
 	amb->setBool(EO_EMIT_REPORTS, prtx::PRTX_FALSE);
+	amb->setInt(EO_MAX_FACES, 0);
+	amb->setString(EO_TEXTURE_DIRECTORY, L""); // keep the URIs of textures which are not files
 	encoderInfoBuilder.setDefaultOptions(amb->createAttributeMap());
 
 	return new MayaEncoderFactory(encoderInfoBuilder.create());
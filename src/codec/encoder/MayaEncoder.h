@@ -29,6 +29,7 @@
 #include "prtx/ResolveMap.h"
 #include "prtx/Singleton.h"
 
+#include "prt/Cache.h"
 #include "prt/ContentType.h"
 #include "prt/InitialShape.h"
 
@@ -49,8 +50,9 @@ public:
 	void finish(prtx::GenerateContext& context) override;
 
 private:
-	void convertGeometry(const prtx::InitialShape& initialShape,
-	                     const prtx::EncodePreparator::InstanceVector& instances, IMayaCallbacks* callbacks);
+	void convertGeometry(size_t initialShapeIndex, const prtx::InitialShape& initialShape,
+	                     const prtx::EncodePreparator::InstanceVector& instances, IMayaCallbacks* callbacks,
+	                     prt::Cache* cache);
 };
 
 class MayaEncoderFactory : public prtx::EncoderFactory, public prtx::Singleton<MayaEncoderFactory> {
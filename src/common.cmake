@@ -95,6 +95,10 @@ find_library(maya_LINK_LIB_OPENMAYAUI NAMES "OpenMayaUI" PATHS "${MAYA_LIB_DIR}"
 if (maya_LINK_LIB_OPENMAYAUI)
 	list(APPEND maya_LINK_LIBRARIES ${maya_LINK_LIB_OPENMAYAUI})
 endif ()
+find_library(maya_LINK_LIB_OPENMAYARENDER NAMES "OpenMayaRender" PATHS "${MAYA_LIB_DIR}")
+if (maya_LINK_LIB_OPENMAYARENDER)
+	list(APPEND maya_LINK_LIBRARIES ${maya_LINK_LIB_OPENMAYARENDER})
+endif ()
 find_library(maya_LINK_LIB_METADATA NAMES "MetaData" PATHS "${MAYA_LIB_DIR}")
 if (maya_LINK_LIB_METADATA)
 	list(APPEND maya_LINK_LIBRARIES ${maya_LINK_LIB_METADATA})
@@ -21,7 +21,11 @@
 
 #include "utils/LogHandler.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
 #include <mutex>
+#include <thread>
 
 namespace {
 
@@ -32,6 +36,8 @@ constexpr const wchar_t* PRT_EXT_SUBDIR = L"ext";
 constexpr prt::LogLevel PRT_LOG_LEVEL = prt::LOG_INFO;
 constexpr bool ENABLE_LOG_CONSOLE = true;
 constexpr bool ENABLE_LOG_FILE = false;
+constexpr size_t GENERATION_CACHE_BUDGET = 512 * 1024 * 1024; // bytes, can be overridden by the plugin preferences
+constexpr size_t PRT_CACHE_BUDGET = 1024 * 1024 * 1024;       // bytes of rpk files, see PRTCacheManager
 
 bool verifyMayaEncoder() {
 	constexpr const wchar_t* ENC_ID_MAYA = L"MayaEncoder";
@@ -39,6 +45,34 @@ bool verifyMayaEncoder() {
 	return static_cast<bool>(mayaEncOpts);
 }
 
+bool preloadRulePackage(PRTContext& prtCtx, const std::wstring& rpk) {
+	const ResolveMapSPtr resolveMap = prtCtx.mResolveMapCache->get(rpk).first;
+	if (!resolveMap) {
+		LOG_WRN << "failed to preload rule package " << rpk;
+		return false;
+	}
+	prtCtx.mPRTCacheManager->touch(rpk, resolveMap);
+
+	const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const wchar_t* ruleFileURI = ruleFile.empty() ? nullptr : resolveMap->getString(ruleFile.c_str());
+	if (ruleFileURI == nullptr) {
+		LOG_WRN << "could not find rule file in rule package " << rpk;
+		return false;
+	}
+
+	// reads the compiled rule file through the prt cache
+	prt::Status status = prt::STATUS_UNSPECIFIED_ERROR;
+	const RuleFileInfoUPtr info(prt::createRuleFileInfo(ruleFileURI, prtCtx.theCache.get(), &status));
+	if (!info || status != prt::STATUS_OK) {
+		LOG_WRN << "could not get rule file info from rule file " << ruleFile;
+		return false;
+	}
+
+	if (DBG)
+		LOG_DBG << "preloaded rule package " << rpk;
+	return true;
+}
+
 } // namespace
 
 PRTContext& PRTContext::get() {
@@ -83,13 +117,27 @@ PRTContext::PRTContext(const std::vector<std::wstring>& addExtDirs) : mPluginRoo
 	}
 	else {
 		theCache.reset(prt::CacheObject::create(prt::CacheObject::CACHE_TYPE_DEFAULT));
-		mResolveMapCache = std::make_unique<ResolveMapCache>(prtu::getProcessTempDir(SRL_TMP_PREFIX));
+		mPRTCacheManager = std::make_unique<PRTCacheManager>(*theCache, PRT_CACHE_BUDGET);
+		// a reload unpacks into a new directory, results referring to the files of the old one become useless
+		auto flushRPK = [this](const std::wstring& rpk, const ResolveMapSPtr& resolveMap, uint64_t assetLocation) {
+			mPRTCacheManager->flush(rpk, resolveMap);
+			if (mGenerationCache && assetLocation != 0)
+				mGenerationCache->removeAssetLocation(assetLocation);
+		};
+		mResolveMapCache = std::make_unique<ResolveMapCache>(prtu::getProcessTempDir(SRL_TMP_PREFIX), flushRPK);
+		mGenerationCache = std::make_unique<GenerationCache>(GENERATION_CACHE_BUDGET);
+		mOcclusionManager = std::make_unique<OcclusionManager>();
 	}
 }
 
 PRTContext::~PRTContext() {
 
-	// the cache needs to be destructed before PRT, so reset them explicitely in the right order here
+	// the caches need to be destructed before PRT, so reset them explicitely in the right order here
+	mOcclusionManager.reset();
+	mDiskGenerationCache.reset();
+	mGenerationCache.reset();
+	mResolveMapCache.reset(); // waits for pending rpk prefetches
+	mPRTCacheManager.reset();
 	theCache.reset();
 	thePRT.reset();
 
@@ -105,3 +153,28 @@ PRTContext::~PRTContext() {
 		theFileLogHandler = nullptr;
 	}
 }
+
+size_t PRTContext::preloadRulePackages(const std::vector<std::wstring>& rpks) {
+	if (!isAlive())
+		return 0;
+
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> preloaded(0);
+	auto preload = [this, &rpks, &next, &preloaded]() {
+		for (size_t i = next++; i < rpks.size(); i = next++) {
+			if (preloadRulePackage(*this, rpks[i]))
+				preloaded++;
+		}
+	};
+
+	// the calling thread is one of the workers
+	const size_t workerCount = std::min<size_t>(rpks.size(), std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::future<void>> workers;
+	for (size_t w = 1; w < workerCount; w++)
+		workers.push_back(std::async(std::launch::async, preload));
+	preload();
+	for (const auto& worker : workers)
+		worker.wait();
+
+	return preloaded;
+}
@@ -21,6 +21,11 @@
 
 #include "serlioPlugin.h"
 
+#include "modifiers/DiskGenerationCache.h"
+#include "modifiers/GenerationCache.h"
+#include "modifiers/OcclusionManager.h"
+
+#include "utils/PRTCacheManager.h"
 #include "utils/ResolveMapCache.h"
 #include "utils/Utilities.h"
 
@@ -44,10 +49,18 @@ struct SRL_TEST_EXPORTS_API PRTContext final {
 		return static_cast<bool>(thePRT);
 	}
 
+	// unpacks the rpks and reads their rule file infos on worker threads, which leaves their resolve maps and compiled
+	// rules in the caches for the first assignment. Returns the number of rpks preloaded successfully.
+	size_t preloadRulePackages(const std::vector<std::wstring>& rpks);
+
 	const std::wstring mPluginRootPath; // the path where serlio dso resides
 	ObjectUPtr thePRT;
 	CacheObjectUPtr theCache;
+	PRTCacheManagerUPtr mPRTCacheManager;
 	prt::ConsoleLogHandler* theLogHandler = nullptr;
 	prt::FileLogHandler* theFileLogHandler = nullptr;
 	ResolveMapCacheUPtr mResolveMapCache;
+	GenerationCacheUPtr mGenerationCache;
+	DiskGenerationCacheUPtr mDiskGenerationCache; // optional, nullptr if disabled
+	OcclusionManagerUPtr mOcclusionManager;
 };
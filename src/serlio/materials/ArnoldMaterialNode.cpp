@@ -18,6 +18,7 @@
  */
 
 #include "materials/ArnoldMaterialNode.h"
+#include "materials/MaterialIndex.h"
 #include "materials/MaterialInfo.h"
 #include "materials/MaterialUtils.h"
 
@@ -327,9 +328,6 @@ MStatus ArnoldMaterialNode::compute(const MPlug& plug, MDataBlock& data) {
 	if (meshNameStatus != MStatus::kSuccess || meshName.length() == 0)
 		return meshNameStatus;
 
-	MaterialUtils::MaterialCache matCache =
-	        MaterialUtils::getMaterialsByStructure(*materialStructure, MATERIAL_BASE_NAME);
-
 	MELScriptBuilder scriptBuilder;
 	scriptBuilder.declString(MEL_VARIABLE_SHADING_ENGINE);
 	scriptBuilder.declString(MEL_VAR_SHADER_NODE);
@@ -377,7 +375,9 @@ MStatus ArnoldMaterialNode::compute(const MPlug& plug, MDataBlock& data) {
 		};
 
 		MaterialInfo matInfo(inMatStreamHandle);
-		std::wstring shadingEngineName = getCachedValue(matCache, matInfo, createShadingEngine, matInfo);
+		std::wstring shadingEngineName = MaterialIndex::get().find(*materialStructure, matInfo, MATERIAL_BASE_NAME);
+		if (shadingEngineName.empty())
+			shadingEngineName = createShadingEngine(matInfo);
 		scriptBuilder.setsAddFaceRange(shadingEngineName, meshName.asWChar(), faceRange.first, faceRange.second);
 		LOG_DBG << "assigned arnold shading engine (" << faceRange.first << ":" << faceRange.second
 		        << "): " << shadingEngineName;
@@ -0,0 +1,189 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "materials/MaterialIndex.h"
+
+#include "utils/LogHandler.h"
+#include "utils/MItDependencyNodesWrapper.h"
+#include "utils/MayaUtilities.h"
+
+#include "maya/MDGMessage.h"
+#include "maya/MFnDependencyNode.h"
+#include "maya/MItDependencyNodes.h"
+#include "maya/MSceneMessage.h"
+#include "maya/adskDataAssociations.h"
+
+#include <algorithm>
+#include <cwchar>
+
+namespace {
+
+constexpr bool DBG = false;
+
+constexpr const char* SHADING_ENGINE_TYPE = "shadingEngine";
+
+} // namespace
+
+MaterialIndex& MaterialIndex::get() {
+	static MaterialIndex materialIndex;
+	return materialIndex;
+}
+
+void MaterialIndex::registerCallbacks(MCallbackIdArray& callbackIds) {
+	get().reset(); // the scene may have changed while the plugin was unloaded
+
+	MStatus status = MStatus::kFailure;
+	auto nodeAdded = [](MObject& node, void*) { get().nodeAdded(node); };
+	callbackIds.append(MDGMessage::addNodeAddedCallback(nodeAdded, SHADING_ENGINE_TYPE, nullptr, &status));
+	MCHECK(status);
+	auto nodeRemoved = [](MObject& node, void*) { get().nodeRemoved(node); };
+	callbackIds.append(MDGMessage::addNodeRemovedCallback(nodeRemoved, SHADING_ENGINE_TYPE, nullptr, &status));
+	MCHECK(status);
+
+	// loading a scene creates the shading engines before their metadata, rescan the whole scene afterwards instead
+	auto sceneChanged = [](void*) { get().reset(); };
+	for (const auto message : {MSceneMessage::kBeforeNew, MSceneMessage::kBeforeOpen, MSceneMessage::kAfterOpen,
+	                           MSceneMessage::kAfterImport, MSceneMessage::kAfterReference}) {
+		callbackIds.append(MSceneMessage::addCallback(message, sceneChanged, nullptr, &status));
+		MCHECK(status);
+	}
+}
+
+std::wstring MaterialIndex::find(const adsk::Data::Structure& materialStructure, const MaterialInfo& matInfo,
+                                 const std::wstring& baseName) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	update(materialStructure);
+
+	const auto range = mShadingEngines.equal_range(matInfo);
+	for (auto it = range.first; it != range.second; ++it) {
+		// deleted shading engines stay alive in the undo queue until their removal callback
+		if (!it->second.isValid())
+			continue;
+
+		const MFnDependencyNode node(it->second.object());
+		const MString name = node.name();
+		if (std::wcsncmp(name.asWChar(), baseName.c_str(), baseName.length()) == 0)
+			return name.asWChar();
+	}
+
+	return {};
+}
+
+void MaterialIndex::add(const MObject& shadingEngine, const MaterialInfo& matInfo) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mIsBuilt)
+		return; // the first scan finds it
+
+	remove(MObjectHandle(shadingEngine));
+	insert(matInfo, MObjectHandle(shadingEngine));
+}
+
+void MaterialIndex::nodeAdded(const MObject& shadingEngine) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mIsBuilt)
+		mAddedShadingEngines.emplace_back(shadingEngine);
+}
+
+void MaterialIndex::nodeRemoved(const MObject& shadingEngine) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	remove(MObjectHandle(shadingEngine));
+}
+
+void MaterialIndex::reset() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mShadingEngines.clear();
+	mEntries.clear();
+	mAddedShadingEngines.clear();
+	mIsBuilt = false;
+}
+
+// expects mMutex to be locked
+void MaterialIndex::update(const adsk::Data::Structure& materialStructure) {
+	if (!mIsBuilt) {
+		MStatus status;
+		MItDependencyNodes shaderIt(MFn::kShadingEngine, &status);
+		MCHECK(status);
+		for (const auto& nodeObj : MItDependencyNodesWrapper(shaderIt))
+			addFromMetadata(nodeObj, materialStructure);
+		mAddedShadingEngines.clear();
+		mIsBuilt = true;
+
+		if (DBG)
+			LOG_DBG << "indexed " << mShadingEngines.size() << " serlio shading engines";
+		return;
+	}
+
+	for (const auto& shadingEngine : mAddedShadingEngines) {
+		if (shadingEngine.isValid())
+			addFromMetadata(shadingEngine.object(), materialStructure);
+	}
+	mAddedShadingEngines.clear();
+}
+
+// expects mMutex to be locked
+void MaterialIndex::addFromMetadata(const MObject& shadingEngine, const adsk::Data::Structure& materialStructure) {
+	MStatus status;
+	const MFnDependencyNode node(shadingEngine);
+
+	const adsk::Data::Associations* materialMetadata = node.metadata(&status);
+	MCHECK(status);
+
+	if (materialMetadata == nullptr)
+		return;
+
+	adsk::Data::Associations materialAssociations(materialMetadata);
+	adsk::Data::Channel* matChannel = materialAssociations.findChannel(PRT_MATERIAL_CHANNEL);
+
+	if (matChannel == nullptr)
+		return;
+
+	adsk::Data::Stream* matStream = matChannel->findDataStream(PRT_MATERIAL_STREAM);
+	if ((matStream == nullptr) || (matStream->elementCount() != 1))
+		return;
+
+	adsk::Data::Handle matSHandle = matStream->element(0);
+	if (!matSHandle.usesStructure(materialStructure))
+		return;
+
+	insert(MaterialInfo(matSHandle), MObjectHandle(shadingEngine));
+}
+
+// expects mMutex to be locked
+void MaterialIndex::insert(const MaterialInfo& matInfo, const MObjectHandle& shadingEngine) {
+	const ShadingEngines::iterator it = mShadingEngines.emplace(matInfo, shadingEngine);
+	mEntries.emplace(shadingEngine.hashCode(), it);
+}
+
+// expects mMutex to be locked
+void MaterialIndex::remove(const MObjectHandle& shadingEngine) {
+	// the index entries are found by hash code (which may collide) instead of scanning the whole index
+	const auto range = mEntries.equal_range(shadingEngine.hashCode());
+	for (auto it = range.first; it != range.second;) {
+		if (it->second->second == shadingEngine) {
+			mShadingEngines.erase(it->second);
+			it = mEntries.erase(it);
+		}
+		else
+			++it;
+	}
+
+	auto isRemoved = [&shadingEngine](const MObjectHandle& h) { return h == shadingEngine; };
+	mAddedShadingEngines.erase(std::remove_if(mAddedShadingEngines.begin(), mAddedShadingEngines.end(), isRemoved),
+	                           mAddedShadingEngines.end());
+}
@@ -0,0 +1,70 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "materials/MaterialInfo.h"
+
+#include "maya/MCallbackIdArray.h"
+#include "maya/MObject.h"
+#include "maya/MObjectHandle.h"
+#include "maya/adskDataStructure.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Process-wide index of the shading engines carrying serlio material metadata, keyed by their material. The material
+ * nodes look up existing shading engines here instead of reading the metadata of all shading engines in the scene on
+ * every compute. The index is built on first use and kept current by node added/removed and scene callbacks.
+ */
+class MaterialIndex {
+public:
+	static MaterialIndex& get();
+
+	// the callbacks are removed together with the other ids in the array
+	static void registerCallbacks(MCallbackIdArray& callbackIds);
+
+	// name of an existing shading engine with this material whose name starts with baseName, empty if there is none
+	std::wstring find(const adsk::Data::Structure& materialStructure, const MaterialInfo& matInfo,
+	                  const std::wstring& baseName);
+
+	// call after assigning the material metadata to a new shading engine
+	void add(const MObject& shadingEngine, const MaterialInfo& matInfo);
+
+private:
+	void nodeAdded(const MObject& shadingEngine);
+	void nodeRemoved(const MObject& shadingEngine);
+	void reset();
+
+	void update(const adsk::Data::Structure& materialStructure);
+	void addFromMetadata(const MObject& shadingEngine, const adsk::Data::Structure& materialStructure);
+	void insert(const MaterialInfo& matInfo, const MObjectHandle& shadingEngine);
+	void remove(const MObjectHandle& shadingEngine);
+
+	using ShadingEngines = std::multimap<MaterialInfo, MObjectHandle>;
+	ShadingEngines mShadingEngines; // names are looked up on use, so renames need no update
+	std::unordered_multimap<unsigned int, ShadingEngines::iterator> mEntries; // by MObjectHandle::hashCode()
+	std::vector<MObjectHandle> mAddedShadingEngines; // metadata is assigned after creation, therefore indexed on use
+	bool mIsBuilt = false;                           // false until the first full scan of the scene
+	std::mutex mMutex;
+};
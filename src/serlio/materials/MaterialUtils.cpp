@@ -1,8 +1,8 @@
 #include "materials/MaterialUtils.h"
+#include "materials/MaterialIndex.h"
 
 #include "utils/MArrayWrapper.h"
 #include "utils/MELScriptBuilder.h"
-#include "utils/MItDependencyNodesWrapper.h"
 #include "utils/MayaUtilities.h"
 
 #include "PRTContext.h"
@@ -10,24 +10,19 @@
 #include "maya/MDataBlock.h"
 #include "maya/MDataHandle.h"
 #include "maya/MFnMesh.h"
-#include "maya/MItDependencyNodes.h"
 #include "maya/MPlugArray.h"
+#include "maya/MSelectionList.h"
 #include "maya/adskDataAssociations.h"
 
 namespace {
 
-MObject findNamedObject(const std::wstring& name, MFn::Type fnType) {
-	MStatus status;
-	MItDependencyNodes nodeIt(fnType, &status);
-	MCHECK(status);
-
-	for (const auto& nodeObj : MItDependencyNodesWrapper(nodeIt)) {
-		MFnDependencyNode node(nodeObj);
-		if (std::wcscmp(node.name().asWChar(), name.c_str()) == 0)
-			return nodeObj;
-	}
-
-	return MObject::kNullObj;
+MObject findNamedObject(const std::wstring& name) {
+	MSelectionList selection;
+	MObject nodeObj;
+	if (selection.add(MString(name.c_str())) != MStatus::kSuccess ||
+	    selection.getDependNode(0, nodeObj) != MStatus::kSuccess)
+		return MObject::kNullObj;
+	return nodeObj;
 }
 
 } // namespace
@@ -105,44 +100,6 @@ MStatus getMeshName(MString& meshName, const MPlug& plug) {
 	return MStatus::kSuccess;
 }
 
-MaterialCache getMaterialsByStructure(const adsk::Data::Structure& materialStructure, const std::wstring& baseName) {
-	MaterialCache existingMaterialInfos;
-
-	MStatus status;
-	MItDependencyNodes shaderIt(MFn::kShadingEngine, &status);
-	MCHECK(status);
-	for (const auto& nodeObj : MItDependencyNodesWrapper(shaderIt)) {
-		MFnDependencyNode node(nodeObj);
-
-		const adsk::Data::Associations* materialMetadata = node.metadata(&status);
-		MCHECK(status);
-
-		if (materialMetadata == nullptr)
-			continue;
-
-		adsk::Data::Associations materialAssociations(materialMetadata);
-		adsk::Data::Channel* matChannel = materialAssociations.findChannel(PRT_MATERIAL_CHANNEL);
-
-		if (matChannel == nullptr)
-			continue;
-
-		adsk::Data::Stream* matStream = matChannel->findDataStream(PRT_MATERIAL_STREAM);
-		if ((matStream == nullptr) || (matStream->elementCount() != 1))
-			continue;
-
-		adsk::Data::Handle matSHandle = matStream->element(0);
-		if (!matSHandle.usesStructure(materialStructure))
-			continue;
-
-		if (std::wcsncmp(node.name().asWChar(), baseName.c_str(), baseName.length()) != 0)
-			continue;
-
-		existingMaterialInfos.emplace(matSHandle, node.name().asWChar());
-	}
-
-	return existingMaterialInfos;
-}
-
 bool getFaceRange(adsk::Data::Handle& handle, std::pair<int, int>& faceRange) {
 	if (!handle.setPositionByMemberName(PRT_MATERIAL_FACE_INDEX_START.c_str()))
 		return false;
@@ -157,7 +114,7 @@ bool getFaceRange(adsk::Data::Handle& handle, std::pair<int, int>& faceRange) {
 
 void assignMaterialMetadata(const adsk::Data::Structure& materialStructure, const adsk::Data::Handle& streamHandle,
                             const std::wstring& shadingEngineName) {
-	MObject shadingEngineObj = findNamedObject(shadingEngineName, MFn::kShadingEngine);
+	MObject shadingEngineObj = findNamedObject(shadingEngineName);
 	MFnDependencyNode shadingEngine(shadingEngineObj);
 
 	adsk::Data::Associations newMetadata;
@@ -169,6 +126,8 @@ void assignMaterialMetadata(const adsk::Data::Structure& materialStructure, cons
 	handle.makeUnique();
 	newStream.setElement(0, handle);
 	shadingEngine.setMetadata(newMetadata);
+
+	MaterialIndex::get().add(shadingEngineObj, MaterialInfo(handle));
 }
 
 std::wstring synchronouslyCreateShadingEngine(const std::wstring& desiredShadingEngineName,
@@ -177,10 +136,10 @@ std::wstring synchronouslyCreateShadingEngine(const std::wstring& desiredShading
 	scriptBuilder.setVar(shadingEngineVariable, MELStringLiteral(desiredShadingEngineName));
 	scriptBuilder.setsCreate(shadingEngineVariable);
 
-	std::wstring output;
-	status = scriptBuilder.executeSync(output);
+	std::wstring shadingEngineName;
+	status = scriptBuilder.executeSync(shadingEngineVariable, shadingEngineName);
 
-	return output;
+	return shadingEngineName;
 }
 
 std::wstring getStingrayShaderPath() {
@@ -9,8 +9,6 @@
 #include "maya/MString.h"
 #include "maya/adskDataStream.h"
 
-#include <map>
-
 namespace MaterialUtils {
 
 void forwardGeometry(const MObject& aInMesh, const MObject& aOutMesh, MDataBlock& data);
@@ -18,11 +16,9 @@ adsk::Data::Stream* getMaterialStream(const MObject& aInMesh, MDataBlock& data);
 
 MStatus getMeshName(MString& meshName, const MPlug& plug);
 
-using MaterialCache = std::map<MaterialInfo, std::wstring>;
-MaterialCache getMaterialsByStructure(const adsk::Data::Structure& materialStructure, const std::wstring& baseName);
-
 bool getFaceRange(adsk::Data::Handle& handle, std::pair<int, int>& faceRange);
 
+// also adds the shading engine to the MaterialIndex
 void assignMaterialMetadata(const adsk::Data::Structure& materialStructure, const adsk::Data::Handle& streamHandle,
                             const std::wstring& shadingEngineName);
 
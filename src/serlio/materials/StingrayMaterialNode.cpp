@@ -18,6 +18,7 @@
  */
 
 #include "materials/StingrayMaterialNode.h"
+#include "materials/MaterialIndex.h"
 #include "materials/MaterialInfo.h"
 #include "materials/MaterialUtils.h"
 
@@ -189,9 +190,6 @@ MStatus StingrayMaterialNode::compute(const MPlug& plug, MDataBlock& data) {
 	if (meshNameStatus != MStatus::kSuccess || meshName.length() == 0)
 		return meshNameStatus;
 
-	MaterialUtils::MaterialCache matCache =
-	        MaterialUtils::getMaterialsByStructure(*materialStructure, MATERIAL_BASE_NAME);
-
 	MELScriptBuilder scriptBuilder;
 	scriptBuilder.declString(MEL_VARIABLE_SHADING_ENGINE);
 
@@ -230,7 +228,9 @@ MStatus StingrayMaterialNode::compute(const MPlug& plug, MDataBlock& data) {
 		};
 
 		MaterialInfo matInfo(materialHandle);
-		std::wstring shadingEngineName = getCachedValue(matCache, matInfo, createShadingEngine, matInfo);
+		std::wstring shadingEngineName = MaterialIndex::get().find(*materialStructure, matInfo, MATERIAL_BASE_NAME);
+		if (shadingEngineName.empty())
+			shadingEngineName = createShadingEngine(matInfo);
 		scriptBuilder.setsAddFaceRange(shadingEngineName, meshName.asWChar(), faceRange.first, faceRange.second);
 		LOG_DBG << "assigned stingray shading engine (" << faceRange.first << ":" << faceRange.second
 		        << "): " << shadingEngineName;
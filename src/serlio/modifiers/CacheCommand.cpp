@@ -0,0 +1,98 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/CacheCommand.h"
+
+#include "PRTContext.h"
+
+#include "utils/LogHandler.h"
+
+#include "maya/MArgDatabase.h"
+#include "maya/MStringArray.h"
+
+#include <string>
+
+namespace {
+
+constexpr const char* FLAG_STATS = "-s";
+constexpr const char* FLAG_STATS_LONG = "-stats";
+constexpr const char* FLAG_FLUSH = "-f";
+constexpr const char* FLAG_FLUSH_LONG = "-flush";
+
+template <typename T>
+void appendStat(MStringArray& stats, const char* name, T value) {
+	stats.append(MString(name) + "=" + MString(std::to_string(value).c_str()));
+}
+
+} // namespace
+
+MSyntax CacheCommand::newSyntax() {
+	MSyntax syntax;
+	syntax.addFlag(FLAG_STATS, FLAG_STATS_LONG);
+	syntax.addFlag(FLAG_FLUSH, FLAG_FLUSH_LONG);
+	return syntax;
+}
+
+MStatus CacheCommand::doIt(const MArgList& args) {
+	MStatus status;
+	const MArgDatabase argData(syntax(), args, &status);
+	if (status != MS::kSuccess)
+		return status;
+
+	PRTContext& prtCtx = PRTContext::get();
+
+	if (argData.isFlagSet(FLAG_FLUSH)) {
+		prtCtx.mPRTCacheManager->flushAll();
+		prtCtx.mGenerationCache->clear();
+		LOG_INF << "flushed prt and generation caches";
+	}
+
+	if (argData.isFlagSet(FLAG_STATS)) {
+		const PRTCacheManager::Stats prtStats = prtCtx.mPRTCacheManager->getStats();
+		const GenerationCache& generationCache = *prtCtx.mGenerationCache;
+		const ResolveMapCache::Stats rpkStats = prtCtx.mResolveMapCache->getStats();
+
+		MStringArray stats;
+		appendStat(stats, "prtCacheRulePackages", prtStats.rulePackages);
+		appendStat(stats, "prtCacheSize", prtStats.memorySize);
+		appendStat(stats, "prtCacheBudget", prtStats.memoryBudget);
+		appendStat(stats, "prtCacheHits", prtStats.hits);
+		appendStat(stats, "prtCacheMisses", prtStats.misses);
+		appendStat(stats, "prtCacheFlushes", prtStats.flushes);
+		appendStat(stats, "generationCacheEntries", generationCache.size());
+		appendStat(stats, "generationCacheSize", generationCache.getMemorySize());
+		appendStat(stats, "generationCacheBudget", generationCache.getMemoryBudget());
+		appendStat(stats, "generationCacheHits", generationCache.getHits());
+		appendStat(stats, "generationCacheMisses", generationCache.getMisses());
+		appendStat(stats, "rpkCacheRulePackages", rpkStats.rulePackages);
+		appendStat(stats, "rpkCacheHits", rpkStats.hits);
+		appendStat(stats, "rpkCacheMisses", rpkStats.misses);
+		appendStat(stats, "rpkCacheFailures", rpkStats.failures);
+		appendStat(stats, "rpkCacheInvalidations", rpkStats.invalidations);
+		appendStat(stats, "rpkCacheEvictions", rpkStats.evictions);
+		appendStat(stats, "rpkCacheUnpackedSize", rpkStats.unpackedSize);
+		appendStat(stats, "rpkCacheUnpackTime", rpkStats.unpackTime);
+		appendStat(stats, "rpkCacheUnpackWaitTime", rpkStats.unpackWaitTime);
+		appendStat(stats, "rpkCacheFingerprintTime", rpkStats.fingerprintTime);
+		appendStat(stats, "rpkCacheLockWaitTime", rpkStats.lockWaitTime);
+		setResult(stats);
+	}
+
+	return MS::kSuccess;
+}
@@ -0,0 +1,36 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "maya/MArgList.h"
+#include "maya/MPxCommand.h"
+#include "maya/MStatus.h"
+#include "maya/MSyntax.h"
+
+constexpr const char* CMD_CACHE = "serlioCache";
+
+// serlioCache -stats: returns the sizes and hit counts of the prt, generation and rpk caches as "name=value" strings,
+// for the rpk cache also the time spent unpacking and waiting (in ms)
+// serlioCache -flush: empties the prt and generation caches, e.g. to reclaim memory in long sessions
+class CacheCommand : public MPxCommand {
+public:
+	static MSyntax newSyntax();
+	MStatus doIt(const MArgList& args) override;
+};
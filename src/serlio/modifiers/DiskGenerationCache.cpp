@@ -0,0 +1,547 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/DiskGenerationCache.h"
+
+#include "utils/LogHandler.h"
+
+#ifdef _WIN32
+// workaround for  "combaseapi.h(229): error C2187: syntax error: 'identifier' was unexpected here" when using
+// /permissive-
+struct IUnknown;
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+constexpr bool DBG = false;
+
+constexpr uint32_t FILE_MAGIC = 0x474c5253; // "SRLG"
+constexpr uint32_t FILE_VERSION = 1;
+constexpr const wchar_t* FILE_EXTENSION = L".srlgen";
+
+// no buffer, attribute or uv set list of a generation result comes near this, only corrupt files do
+constexpr uint64_t MAX_ELEMENT_COUNT = std::numeric_limits<uint32_t>::max();
+
+// cleaning up stops below the budget, so the next entries do not trigger another scan right away
+constexpr uint64_t CLEANUP_TARGET_PERCENT = 80;
+
+uint64_t getStableKeyHash(const GenerationCache::Key& key) {
+	uint64_t h = prtu::hashCombine(key.shapeHash, key.attributesHash);
+	h = prtu::hashCombine(h, static_cast<uint64_t>(key.seed));
+	h = prtu::hashCombine(h, key.encoderHash);
+	h = prtu::hashCombine(h, key.rpkFingerprint);
+	h = prtu::hash(key.ruleFile, h);
+	h = prtu::hash(key.startRule, h);
+	return prtu::hashCombine(h, FILE_VERSION);
+}
+
+// read-only mapping of a whole file
+class MappedFile {
+public:
+	explicit MappedFile(const std::wstring& path) {
+#ifdef _WIN32
+		mFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                    FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER fileSize;
+		if (mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+			return;
+		mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mMapping == nullptr)
+			return;
+		mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		if (mData != nullptr)
+			mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+		mFile = open(prtu::toOSNarrowFromUTF16(path).c_str(), O_RDONLY);
+		struct stat st;
+		if (mFile < 0 || fstat(mFile, &st) != 0 || st.st_size == 0)
+			return;
+		void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+		if (data == MAP_FAILED)
+			return;
+		mData = static_cast<const uint8_t*>(data);
+		mSize = static_cast<size_t>(st.st_size);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+#ifdef _WIN32
+		if (mData != nullptr)
+			UnmapViewOfFile(mData);
+		if (mMapping != nullptr)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+#else
+		if (mData != nullptr)
+			munmap(const_cast<uint8_t*>(mData), mSize);
+		if (mFile >= 0)
+			close(mFile);
+#endif
+	}
+
+	const uint8_t* data() const {
+		return mData;
+	}
+
+	size_t size() const {
+		return mSize;
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+#else
+	int mFile = -1;
+#endif
+	const uint8_t* mData = nullptr;
+	size_t mSize = 0;
+};
+
+// the files are only read back on the same machine, so we use the native byte order
+class Writer {
+public:
+	explicit Writer(std::ostream& out) : mOut(out) {}
+
+	template <typename T>
+	void write(T value) {
+		static_assert(std::is_arithmetic<T>::value, "only plain values can be written directly");
+		mOut.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	void write(const T* values, size_t count) {
+		write<uint64_t>(count);
+		mOut.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+	}
+
+	template <typename T>
+	void write(const std::vector<T>& values) {
+		write(values.data(), values.size());
+	}
+
+	void write(const wchar_t* s) {
+		const std::string utf8 = prtu::toUTF8FromUTF16(s);
+		write(utf8.data(), utf8.size());
+	}
+
+	void write(const prt::AttributeMap* attrs) {
+		if (attrs == nullptr) {
+			write<uint8_t>(0);
+			return;
+		}
+		write<uint8_t>(1);
+
+		size_t keyCount = 0;
+		wchar_t const* const* keys = attrs->getKeys(&keyCount);
+		write<uint64_t>(keyCount);
+		for (size_t k = 0; k < keyCount; k++) {
+			const wchar_t* key = keys[k];
+			const prt::Attributable::PrimitiveType type = attrs->getType(key);
+			write(key);
+			write<int32_t>(type);
+
+			size_t count = 0;
+			switch (type) {
+				case prt::Attributable::PT_BOOL:
+					write<uint8_t>(attrs->getBool(key) ? 1 : 0);
+					break;
+				case prt::Attributable::PT_INT:
+					write<int32_t>(attrs->getInt(key));
+					break;
+				case prt::Attributable::PT_FLOAT:
+					write<double>(attrs->getFloat(key));
+					break;
+				case prt::Attributable::PT_STRING:
+					write(attrs->getString(key));
+					break;
+				case prt::Attributable::PT_BOOL_ARRAY: {
+					const bool* values = attrs->getBoolArray(key, &count);
+					write<uint64_t>(count);
+					for (size_t i = 0; i < count; i++)
+						write<uint8_t>(values[i] ? 1 : 0);
+					break;
+				}
+				case prt::Attributable::PT_INT_ARRAY: {
+					const int32_t* values = attrs->getIntArray(key, &count);
+					write(values, count);
+					break;
+				}
+				case prt::Attributable::PT_FLOAT_ARRAY: {
+					const double* values = attrs->getFloatArray(key, &count);
+					write(values, count);
+					break;
+				}
+				case prt::Attributable::PT_STRING_ARRAY: {
+					wchar_t const* const* values = attrs->getStringArray(key, &count);
+					write<uint64_t>(count);
+					for (size_t i = 0; i < count; i++)
+						write(values[i]);
+					break;
+				}
+				default:
+					break;
+			}
+		}
+	}
+
+private:
+	std::ostream& mOut;
+};
+
+// bounds checked, once a read fails all further reads fail too
+class Reader {
+public:
+	Reader(const uint8_t* data, size_t size) : mPos(data), mEnd(data + size) {}
+
+	bool isValid() const {
+		return mValid;
+	}
+
+	template <typename T>
+	T read() {
+		T value{};
+		if (check(sizeof(T))) {
+			std::memcpy(&value, mPos, sizeof(T));
+			mPos += sizeof(T);
+		}
+		return value;
+	}
+
+	template <typename T>
+	void read(std::vector<T>& values) {
+		const size_t count = readCount(sizeof(T));
+		if (count == 0)
+			return;
+		values.resize(count);
+		std::memcpy(values.data(), mPos, count * sizeof(T));
+		mPos += count * sizeof(T);
+	}
+
+	// validates a number of elements before anything gets allocated for them, each takes at least minSize bytes
+	size_t readCount(size_t minSize) {
+		const uint64_t count = read<uint64_t>();
+		if (mValid && (count > MAX_ELEMENT_COUNT || count > static_cast<uint64_t>(mEnd - mPos) / minSize))
+			mValid = false;
+		return mValid ? static_cast<size_t>(count) : 0;
+	}
+
+	std::wstring readString() {
+		const uint64_t length = read<uint64_t>();
+		if (!check(length))
+			return {};
+		const std::string utf8(reinterpret_cast<const char*>(mPos), static_cast<size_t>(length));
+		mPos += length;
+		return prtu::toUTF16FromUTF8(utf8);
+	}
+
+	AttributeMapUPtr readAttributeMap() {
+		if (read<uint8_t>() == 0)
+			return {};
+
+		AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+		const uint64_t keyCount = read<uint64_t>();
+		for (uint64_t k = 0; k < keyCount && mValid; k++) {
+			const std::wstring key = readString();
+			switch (read<int32_t>()) {
+				case prt::Attributable::PT_BOOL:
+					amb->setBool(key.c_str(), read<uint8_t>() != 0);
+					break;
+				case prt::Attributable::PT_INT:
+					amb->setInt(key.c_str(), read<int32_t>());
+					break;
+				case prt::Attributable::PT_FLOAT:
+					amb->setFloat(key.c_str(), read<double>());
+					break;
+				case prt::Attributable::PT_STRING:
+					amb->setString(key.c_str(), readString().c_str());
+					break;
+				case prt::Attributable::PT_BOOL_ARRAY: {
+					std::vector<uint8_t> values;
+					read(values);
+					const std::unique_ptr<bool[]> boolValues(new bool[values.size()]);
+					for (size_t i = 0; i < values.size(); i++)
+						boolValues[i] = (values[i] != 0);
+					amb->setBoolArray(key.c_str(), boolValues.get(), values.size());
+					break;
+				}
+				case prt::Attributable::PT_INT_ARRAY: {
+					std::vector<int32_t> values;
+					read(values);
+					amb->setIntArray(key.c_str(), values.data(), values.size());
+					break;
+				}
+				case prt::Attributable::PT_FLOAT_ARRAY: {
+					std::vector<double> values;
+					read(values);
+					amb->setFloatArray(key.c_str(), values.data(), values.size());
+					break;
+				}
+				case prt::Attributable::PT_STRING_ARRAY: {
+					std::vector<std::wstring> values(readCount(sizeof(uint64_t))); // each has its length
+					for (size_t i = 0; i < values.size() && mValid; i++)
+						values[i] = readString();
+					const std::vector<const wchar_t*> valuePtrs = prtu::toPtrVec(values);
+					amb->setStringArray(key.c_str(), valuePtrs.data(), valuePtrs.size());
+					break;
+				}
+				default:
+					break;
+			}
+		}
+		return AttributeMapUPtr(amb->createAttributeMap());
+	}
+
+private:
+	bool check(uint64_t size) {
+		if (mValid && size > static_cast<uint64_t>(mEnd - mPos))
+			mValid = false;
+		return mValid;
+	}
+
+	const uint8_t* mPos;
+	const uint8_t* const mEnd;
+	bool mValid = true;
+};
+
+void writeAttributeMaps(Writer& writer, const AttributeMapVector& attributeMaps) {
+	writer.write<uint64_t>(attributeMaps.size());
+	for (const AttributeMapUPtr& attrs : attributeMaps)
+		writer.write(attrs.get());
+}
+
+void readAttributeMaps(Reader& reader, AttributeMapVector& attributeMaps) {
+	attributeMaps.resize(reader.readCount(sizeof(uint8_t))); // each has at least its presence flag
+	for (size_t i = 0; i < attributeMaps.size() && reader.isValid(); i++)
+		attributeMaps[i] = reader.readAttributeMap();
+}
+
+// the modification time of an entry records its last use
+void touch(const std::wstring& path) {
+#ifdef _WIN32
+	const HANDLE file = CreateFileW(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+	                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	SetFileTime(file, nullptr, nullptr, &now);
+	CloseHandle(file);
+#else
+	utimensat(AT_FDCWD, prtu::toOSNarrowFromUTF16(path).c_str(), nullptr, 0);
+#endif
+}
+
+// nodes might be evaluated concurrently and other sessions might write the same entry
+std::string getTmpSuffix() {
+#ifdef _WIN32
+	const unsigned long pid = GetCurrentProcessId();
+#else
+	const long pid = static_cast<long>(getpid());
+#endif
+	const size_t threadHash = std::hash<std::thread::id>()(std::this_thread::get_id());
+	return "." + std::to_string(pid) + "." + std::to_string(threadHash) + ".tmp";
+}
+
+bool endsWith(const std::wstring& s, const std::wstring& suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+DiskGenerationCache::DiskGenerationCache(const std::wstring& directory, uint64_t sizeBudget)
+    : mDirectory(directory), mSizeBudget(sizeBudget) {
+	if (!prtu::create_directory(mDirectory))
+		LOG_WRN << "cannot create the generation cache directory " << mDirectory;
+	removeLeastRecentlyUsed();
+}
+
+GenerationResultUPtr DiskGenerationCache::get(const GenerationCache::Key& key) const {
+	if (key.assetLocation != 0)
+		return {};
+
+	const uint64_t keyHash = getStableKeyHash(key);
+	const std::wstring path = getEntryPath(keyHash);
+	const MappedFile file(path);
+	if (file.data() == nullptr)
+		return {};
+
+	Reader reader(file.data(), file.size());
+	if (reader.read<uint32_t>() != FILE_MAGIC || reader.read<uint32_t>() != FILE_VERSION ||
+	    reader.read<uint64_t>() != keyHash)
+		return {};
+
+	auto result = std::make_unique<GenerationResult>();
+	result->hasMesh = reader.read<uint8_t>() != 0;
+	reader.read(result->vertices);
+	reader.read(result->normals);
+	reader.read(result->faceCounts);
+	reader.read(result->vertexIndices);
+	reader.read(result->normalIndices);
+
+	const size_t uvSets = reader.readCount(3 * sizeof(uint64_t)); // each has the counts of its three buffers
+	if (!reader.isValid())
+		return {};
+	result->uvs.resize(uvSets);
+	result->uvCounts.resize(uvSets);
+	result->uvIndices.resize(uvSets);
+	for (size_t uvSet = 0; uvSet < uvSets && reader.isValid(); uvSet++) {
+		reader.read(result->uvs[uvSet]);
+		reader.read(result->uvCounts[uvSet]);
+		reader.read(result->uvIndices[uvSet]);
+	}
+
+	reader.read(result->faceRanges);
+	readAttributeMaps(reader, result->materials);
+	readAttributeMaps(reader, result->reports);
+	result->attributes = reader.readAttributeMap();
+
+	if (!reader.isValid()) {
+		LOG_WRN << "ignoring corrupt generation cache file " << path;
+		return {};
+	}
+
+	touch(path);
+	if (DBG)
+		LOG_DBG << "read generation result from " << path;
+	return result;
+}
+
+void DiskGenerationCache::put(const GenerationCache::Key& key, const GenerationResult& result) {
+	if (key.assetLocation != 0)
+		return;
+
+	const uint64_t keyHash = getStableKeyHash(key);
+	const std::string path = prtu::toOSNarrowFromUTF16(getEntryPath(keyHash));
+	const std::string tmpPath = path + getTmpSuffix();
+
+	uint64_t entrySize = 0;
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		Writer writer(out);
+		writer.write<uint32_t>(FILE_MAGIC);
+		writer.write<uint32_t>(FILE_VERSION);
+		writer.write<uint64_t>(keyHash);
+
+		writer.write<uint8_t>(result.hasMesh ? 1 : 0);
+		writer.write(result.vertices);
+		writer.write(result.normals);
+		writer.write(result.faceCounts);
+		writer.write(result.vertexIndices);
+		writer.write(result.normalIndices);
+
+		writer.write<uint64_t>(result.uvs.size());
+		for (size_t uvSet = 0; uvSet < result.uvs.size(); uvSet++) {
+			writer.write(result.uvs[uvSet]);
+			writer.write(result.uvCounts[uvSet]);
+			writer.write(result.uvIndices[uvSet]);
+		}
+
+		writer.write(result.faceRanges);
+		writeAttributeMaps(writer, result.materials);
+		writeAttributeMaps(writer, result.reports);
+		writer.write(result.attributes.get());
+
+		if (!out) {
+			LOG_WRN << "failed to write generation cache file " << tmpPath;
+			out.close();
+			std::remove(tmpPath.c_str());
+			return;
+		}
+		entrySize = static_cast<uint64_t>(out.tellp());
+	}
+
+	// readers (e.g. another maya session) must never see a partially written file
+	std::remove(path.c_str());
+	if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+		std::remove(tmpPath.c_str());
+		return;
+	}
+
+	if (mSize.fetch_add(entrySize) + entrySize > mSizeBudget)
+		removeLeastRecentlyUsed();
+}
+
+void DiskGenerationCache::removeLeastRecentlyUsed() {
+	// concurrent writers leave the scan to the thread already doing it
+	std::unique_lock<std::mutex> lock(mCleanupMutex, std::try_to_lock);
+	if (!lock.owns_lock())
+		return;
+
+	struct Entry {
+		std::wstring path;
+		time_t lastUse;
+		int64_t size;
+	};
+	std::vector<Entry> entries;
+	uint64_t totalSize = 0;
+
+	const std::wstring extension = FILE_EXTENSION;
+	for (const std::wstring& name : prtu::list_directory(mDirectory)) {
+		if (!endsWith(name, extension))
+			continue;
+		const std::wstring path = mDirectory + prtu::getDirSeparator<wchar_t>() + name;
+		const int64_t size = std::max<int64_t>(prtu::getFileSize(path), 0);
+		entries.push_back({path, prtu::getFileModificationTime(path), size});
+		totalSize += static_cast<uint64_t>(size);
+	}
+
+	if (totalSize > mSizeBudget) {
+		const uint64_t targetSize = mSizeBudget / 100 * CLEANUP_TARGET_PERCENT;
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+		for (const Entry& entry : entries) {
+			if (totalSize <= targetSize)
+				break;
+			// fails e.g. on windows while another session has the entry mapped
+			if (std::remove(prtu::toOSNarrowFromUTF16(entry.path).c_str()) != 0)
+				continue;
+			totalSize -= static_cast<uint64_t>(entry.size);
+			if (DBG)
+				LOG_DBG << "removed generation cache file " << entry.path;
+		}
+	}
+	mSize = totalSize;
+}
+
+std::wstring DiskGenerationCache::getEntryPath(uint64_t keyHash) const {
+	wchar_t name[17];
+	std::swprintf(name, 17, L"%016llx", static_cast<unsigned long long>(keyHash));
+	return mDirectory + prtu::getDirSeparator<wchar_t>() + name + FILE_EXTENSION;
+}
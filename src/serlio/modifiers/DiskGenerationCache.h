@@ -0,0 +1,70 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "modifiers/GenerationCache.h"
+#include "modifiers/GenerationResult.h"
+
+#include "utils/Utilities.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * Optional persistent store for generation results, so reopening a scene does not need to call PRT for shapes which
+ * have been generated before. Each entry is a separate file named after a stable hash of its key, it is memory mapped
+ * when read back. Like the rest of the key, the rpk fingerprint is stable across sessions.
+ * Like the rule package unpack store, the directory is kept within a size budget by removing the least recently used
+ * entries. The directory is only scanned on construction and whenever the entries written since push the size over.
+ */
+class SRL_TEST_EXPORTS_API DiskGenerationCache {
+public:
+	static constexpr uint64_t DEFAULT_SIZE_BUDGET = 5ull * 1024 * 1024 * 1024;
+
+	explicit DiskGenerationCache(const std::wstring& directory, uint64_t sizeBudget = DEFAULT_SIZE_BUDGET);
+	DiskGenerationCache(const DiskGenerationCache&) = delete;
+	DiskGenerationCache(DiskGenerationCache&&) = delete;
+	DiskGenerationCache& operator=(DiskGenerationCache const&) = delete;
+	DiskGenerationCache& operator=(DiskGenerationCache&&) = delete;
+	~DiskGenerationCache() = default;
+
+	// results referring to files in a session specific unpack directory (see GenerationCache::Key::assetLocation)
+	// would outlive these files, they are neither stored nor returned.
+	// nullptr if there is no (valid) entry for the key
+	GenerationResultUPtr get(const GenerationCache::Key& key) const;
+	void put(const GenerationCache::Key& key, const GenerationResult& result);
+
+	const std::wstring& getDirectory() const {
+		return mDirectory;
+	}
+
+private:
+	std::wstring getEntryPath(uint64_t keyHash) const;
+	void removeLeastRecentlyUsed();
+
+	const std::wstring mDirectory;
+	const uint64_t mSizeBudget; // in bytes
+	std::atomic<uint64_t> mSize{0}; // estimate, entries written by other sessions are only seen by the next scan
+	std::mutex mCleanupMutex;
+};
+
+using DiskGenerationCacheUPtr = std::unique_ptr<DiskGenerationCache>;
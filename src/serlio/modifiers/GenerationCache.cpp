@@ -0,0 +1,153 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/GenerationCache.h"
+
+#include "utils/LogHandler.h"
+
+namespace {
+
+constexpr bool DBG = false;
+
+} // namespace
+
+bool GenerationCache::Key::operator==(const Key& other) const {
+	return shapeHash == other.shapeHash && attributesHash == other.attributesHash && seed == other.seed &&
+	       encoderHash == other.encoderHash && rpkFingerprint == other.rpkFingerprint && ruleFile == other.ruleFile &&
+	       startRule == other.startRule && occlusionEpoch == other.occlusionEpoch &&
+	       assetLocation == other.assetLocation;
+}
+
+size_t GenerationCache::KeyHash::operator()(const Key& key) const {
+	uint64_t h = prtu::hashCombine(key.shapeHash, key.attributesHash);
+	h = prtu::hashCombine(h, static_cast<uint64_t>(key.seed));
+	h = prtu::hashCombine(h, key.encoderHash);
+	h = prtu::hashCombine(h, key.rpkFingerprint);
+	h = prtu::hash(key.ruleFile, h);
+	h = prtu::hash(key.startRule, h);
+	h = prtu::hashCombine(h, key.occlusionEpoch);
+	h = prtu::hashCombine(h, key.assetLocation);
+	return static_cast<size_t>(h);
+}
+
+GenerationResultSPtr GenerationCache::get(const Key& key) {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto it = mIndex.find(key);
+	if (it == mIndex.end()) {
+		mMisses++;
+		return {};
+	}
+	mHits++;
+
+	// mark as most recently used
+	mEntries.splice(mEntries.begin(), mEntries, it->second);
+	return it->second->mResult;
+}
+
+void GenerationCache::insert(const Key& key, GenerationResultSPtr result) {
+	if (!result)
+		return;
+
+	const size_t memorySize = result->getMemorySize();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (memorySize > mMemoryBudget) {
+		if (DBG)
+			LOG_DBG << "generation result of " << memorySize << " bytes exceeds cache budget, not caching it";
+		return;
+	}
+
+	auto it = mIndex.find(key);
+	if (it != mIndex.end()) {
+		mMemorySize -= it->second->mMemorySize;
+		mEntries.erase(it->second);
+		mIndex.erase(it);
+	}
+
+	evict(mMemoryBudget - memorySize);
+
+	mEntries.push_front({key, std::move(result), memorySize});
+	mIndex.emplace(key, mEntries.begin());
+	mMemorySize += memorySize;
+}
+
+void GenerationCache::clear() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mIndex.clear();
+	mEntries.clear();
+	mMemorySize = 0;
+}
+
+void GenerationCache::removeAssetLocation(uint64_t assetLocation) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto it = mEntries.begin(); it != mEntries.end();) {
+		if (it->mKey.assetLocation == assetLocation) {
+			mMemorySize -= it->mMemorySize;
+			mIndex.erase(it->mKey);
+			it = mEntries.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+void GenerationCache::setMemoryBudget(size_t memoryBudget) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMemoryBudget = memoryBudget;
+	evict(mMemoryBudget);
+}
+
+size_t GenerationCache::getMemoryBudget() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMemoryBudget;
+}
+
+size_t GenerationCache::getMemorySize() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMemorySize;
+}
+
+size_t GenerationCache::size() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mEntries.size();
+}
+
+size_t GenerationCache::getHits() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mHits;
+}
+
+size_t GenerationCache::getMisses() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMisses;
+}
+
+// expects mMutex to be locked
+void GenerationCache::evict(size_t memoryBudget) {
+	while (!mEntries.empty() && mMemorySize > memoryBudget) {
+		const Entry& lru = mEntries.back();
+		if (DBG)
+			LOG_DBG << "evicting generation result of " << lru.mMemorySize << " bytes";
+		mMemorySize -= lru.mMemorySize;
+		mIndex.erase(lru.mKey);
+		mEntries.pop_back();
+	}
+}
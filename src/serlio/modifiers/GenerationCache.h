@@ -0,0 +1,102 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "modifiers/GenerationResult.h"
+
+#include "utils/Utilities.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Process-wide LRU cache of generation results, shared by all serlio nodes. Keys only depend on the generation input,
+ * so identical shapes with identical attributes hit the same entry regardless of the node they belong to.
+ */
+class SRL_TEST_EXPORTS_API GenerationCache {
+public:
+	struct Key {
+		uint64_t shapeHash = 0;      // initial shape geometry
+		uint64_t attributesHash = 0; // rule attribute values set on the initial shape
+		int32_t seed = 0;
+		std::wstring ruleFile;
+		std::wstring startRule;
+		uint64_t encoderHash = 0; // encoder id and options
+
+		// identifies the rpk content, see ResolveMapCache::getFingerprint(). unlike the resolve map itself, it does not
+		// keep evicted rpks (and their unpacked files) alive. results of rpks without fingerprint (0) are not cached.
+		uint64_t rpkFingerprint = 0;
+
+		uint64_t occlusionEpoch = 0; // version of the scene occlusion set, 0 if generated without occlusion
+
+		// see ResolveMapCache::getAssetLocation(), 0 if the files referenced by the result (e.g. textures) are stable
+		uint64_t assetLocation = 0;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	explicit GenerationCache(size_t memoryBudget) : mMemoryBudget(memoryBudget) {}
+	GenerationCache(const GenerationCache&) = delete;
+	GenerationCache(GenerationCache&&) = delete;
+	GenerationCache& operator=(GenerationCache const&) = delete;
+	GenerationCache& operator=(GenerationCache&&) = delete;
+	~GenerationCache() = default;
+
+	GenerationResultSPtr get(const Key& key);
+	void insert(const Key& key, GenerationResultSPtr result);
+	void clear();
+
+	// drops the results referring to the files of an unpack directory which is going away
+	void removeAssetLocation(uint64_t assetLocation);
+
+	// in bytes, a budget of 0 disables the cache
+	void setMemoryBudget(size_t memoryBudget);
+	size_t getMemoryBudget() const;
+	size_t getMemorySize() const;
+	size_t size() const;
+	size_t getHits() const;
+	size_t getMisses() const;
+
+private:
+	void evict(size_t memoryBudget);
+
+	struct Entry {
+		Key mKey;
+		GenerationResultSPtr mResult;
+		size_t mMemorySize;
+	};
+	using EntryList = std::list<Entry>; // most recently used first
+	EntryList mEntries;
+	std::unordered_map<Key, EntryList::iterator, KeyHash> mIndex;
+
+	size_t mMemoryBudget;
+	size_t mMemorySize = 0;
+	size_t mHits = 0;
+	size_t mMisses = 0;
+	mutable std::mutex mMutex;
+};
+
+using GenerationCacheUPtr = std::unique_ptr<GenerationCache>;
@@ -0,0 +1,99 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/GenerationResult.h"
+
+#include <cwchar>
+#include <numeric>
+
+namespace {
+
+template <typename T>
+size_t getVectorSize(const std::vector<T>& v) {
+	return v.capacity() * sizeof(T);
+}
+
+template <typename T>
+size_t getVectorSize(const std::vector<std::vector<T>>& vv) {
+	return std::accumulate(vv.begin(), vv.end(), vv.capacity() * sizeof(std::vector<T>),
+	                       [](size_t s, const std::vector<T>& v) { return s + getVectorSize(v); });
+}
+
+// rough estimate, the actual memory layout of attribute maps is hidden by PRT
+size_t getAttributeMapSize(const prt::AttributeMap* attrs) {
+	if (attrs == nullptr)
+		return 0;
+
+	size_t size = sizeof(prt::AttributeMap);
+
+	size_t keyCount = 0;
+	wchar_t const* const* keys = attrs->getKeys(&keyCount);
+	for (size_t k = 0; k < keyCount; k++) {
+		const wchar_t* key = keys[k];
+		size += (std::wcslen(key) + 1) * sizeof(wchar_t);
+
+		size_t count = 0;
+		switch (attrs->getType(key)) {
+			case prt::Attributable::PT_STRING:
+				size += (std::wcslen(attrs->getString(key)) + 1) * sizeof(wchar_t);
+				break;
+			case prt::Attributable::PT_BOOL_ARRAY:
+				attrs->getBoolArray(key, &count);
+				size += count * sizeof(bool);
+				break;
+			case prt::Attributable::PT_INT_ARRAY:
+				attrs->getIntArray(key, &count);
+				size += count * sizeof(int32_t);
+				break;
+			case prt::Attributable::PT_FLOAT_ARRAY:
+				attrs->getFloatArray(key, &count);
+				size += count * sizeof(double);
+				break;
+			case prt::Attributable::PT_STRING_ARRAY: {
+				wchar_t const* const* strings = attrs->getStringArray(key, &count);
+				for (size_t i = 0; i < count; i++)
+					size += (std::wcslen(strings[i]) + 1) * sizeof(wchar_t);
+				break;
+			}
+			default:
+				size += sizeof(double);
+				break;
+		}
+	}
+
+	return size;
+}
+
+size_t getAttributeMapSize(const AttributeMapVector& maps) {
+	return std::accumulate(maps.begin(), maps.end(), maps.capacity() * sizeof(AttributeMapUPtr),
+	                       [](size_t s, const AttributeMapUPtr& m) { return s + getAttributeMapSize(m.get()); });
+}
+
+} // namespace
+
+size_t GenerationResult::getMemorySize() const {
+	size_t size = sizeof(GenerationResult);
+	size += getVectorSize(vertices) + getVectorSize(normals);
+	size += getVectorSize(faceCounts) + getVectorSize(vertexIndices) + getVectorSize(normalIndices);
+	size += getVectorSize(uvs) + getVectorSize(uvCounts) + getVectorSize(uvIndices);
+	size += getVectorSize(faceRanges);
+	size += getAttributeMapSize(materials) + getAttributeMapSize(reports);
+	size += getAttributeMapSize(attributes.get());
+	return size;
+}
@@ -0,0 +1,56 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Utilities.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Maya independent copy of the data MayaEncoder hands to IMayaCallbacks::addMesh for one initial shape, plus the
+ * evaluated rule attributes. This is what we keep in the GenerationCache, the maya mesh is (re)built from it.
+ */
+struct GenerationResult {
+	std::vector<double> vertices;
+	std::vector<double> normals;
+	std::vector<uint32_t> faceCounts;
+	std::vector<uint32_t> vertexIndices;
+	std::vector<uint32_t> normalIndices;
+
+	// per uv set
+	std::vector<std::vector<double>> uvs;
+	std::vector<std::vector<uint32_t>> uvCounts;
+	std::vector<std::vector<uint32_t>> uvIndices;
+
+	std::vector<uint32_t> faceRanges;
+	AttributeMapVector materials; // empty or faceRanges.size()-1 entries
+	AttributeMapVector reports;   // empty or faceRanges.size()-1 entries
+
+	bool hasMesh = false; // false if the encoder did not emit any geometry (e.g. attribute evaluation only)
+
+	AttributeMapUPtr attributes; // final values of rule attributes, if requested
+
+	size_t getMemorySize() const;
+};
+
+using GenerationResultUPtr = std::unique_ptr<GenerationResult>;
+using GenerationResultSPtr = std::shared_ptr<const GenerationResult>;
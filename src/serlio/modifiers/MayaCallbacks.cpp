@@ -18,408 +18,161 @@
  */
 
 #include "modifiers/MayaCallbacks.h"
-#include "modifiers/PRTModifierNode.h"
-
-#include "materials/MaterialInfo.h"
 
 #include "utils/LogHandler.h"
-#include "utils/MayaUtilities.h"
 #include "utils/Utilities.h"
 
-#include "prt/StringUtils.h"
-
-#include "maya/MFloatArray.h"
-#include "maya/MFloatPointArray.h"
-#include "maya/MFloatVectorArray.h"
-#include "maya/MFnMesh.h"
-#include "maya/MFnMeshData.h"
-#include "maya/adskDataAssociations.h"
-#include "maya/adskDataStream.h"
-
-#include <cassert>
-#include <sstream>
+#include <chrono>
 
 namespace {
 
 constexpr bool DBG = false;
 
-void checkStringLength(const wchar_t* string, const size_t& maxStringLength) {
-	if (wcslen(string) >= maxStringLength) {
-		const std::wstring msg = L"Maximum texture path size is " + std::to_wstring(maxStringLength);
-		prt::log(msg.c_str(), prt::LOG_ERROR);
-	}
-}
-
-MIntArray toMayaIntArray(uint32_t const* a, size_t s) {
-	MIntArray mia(static_cast<unsigned int>(s), 0);
-	for (unsigned int i = 0; i < s; ++i)
-		mia.set(a[i], i);
-	return mia;
-}
+AttributeMapVector copyAttributeMaps(const prt::AttributeMap** maps, size_t count) {
+	AttributeMapVector copies;
+	if (maps == nullptr)
+		return copies;
 
-MFloatPointArray toMayaFloatPointArray(double const* a, size_t s) {
-	assert(s % 3 == 0);
-	const unsigned int numPoints = static_cast<unsigned int>(s) / 3;
-	MFloatPointArray mfpa(numPoints);
-	for (unsigned int i = 0; i < numPoints; ++i) {
-		mfpa.set(MFloatPoint(static_cast<float>(a[i * 3 + 0]), static_cast<float>(a[i * 3 + 1]),
-		                     static_cast<float>(a[i * 3 + 2])),
-		         i);
+	copies.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::createFromAttributeMap(maps[i]));
+		copies.emplace_back(amb->createAttributeMap());
 	}
-	return mfpa;
+	return copies;
 }
 
 } // namespace
 
-struct TextureUVOrder {
-	MString mayaUvSetName;
-	uint8_t mayaUvSetIndex;
-	uint8_t prtUvSetIndex;
-};
-
-// maya pbr stingray shader only supports first 4 uvsets -> reoder so first 4 are most important ones
-// other shaders support >4 sets
-const std::vector<TextureUVOrder> TEXTURE_UV_ORDERS = []() -> std::vector<TextureUVOrder> {
-	// clang-format off
-	return {
-	        // maya uvset name | maya idx | prt idx  | CGA key
-	        { L"map1",         0,    0 },  // colormap
-	        { L"dirtMap",      1,    2 },  // dirtmap
-	        { L"normalMap",    2,    5 },  // normalmap
-	        { L"opacityMap",   3,    4 },  // opacitymap
-
-	        { L"bumpMap",      4,    1 },  // bumpmap
-	        { L"specularMap",  5,    3 },  // specularmap
-	        { L"emissiveMap",  6,    6 },  // emissivemap
-	        { L"occlusionMap", 7,    7 },  // occlusionmap
-	        { L"roughnessMap", 8,    8 },  // roughnessmap
-	        { L"metallicMap",  9,    9 }   // metallicmap
-	};
-	// clang-format on
-}();
+MayaCallbacks::MayaCallbacks(size_t initialShapeCount, CancellationToken cancellationToken)
+    : mCancellationToken(std::move(cancellationToken)), mResults(initialShapeCount),
+      mAddMeshTimes(initialShapeCount, 0.0) {
+	mAttributeMapBuilders.reserve(initialShapeCount);
+	for (size_t i = 0; i < initialShapeCount; i++)
+		mAttributeMapBuilders.emplace_back(prt::AttributeMapBuilder::create());
+}
 
-void MayaCallbacks::addMesh(const wchar_t*, const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize,
-                            const uint32_t* faceCounts, size_t faceCountsSize, const uint32_t* vertexIndices,
-                            size_t vertexIndicesSize, const uint32_t* normalIndices,
-                            MAYBE_UNUSED size_t normalIndicesSize, double const* const* uvs, size_t const* uvsSizes,
+void MayaCallbacks::addMesh(size_t initialShapeIndex, const wchar_t*, const double* vtx, size_t vtxSize,
+                            const double* nrm, size_t nrmSize, const uint32_t* faceCounts, size_t faceCountsSize,
+                            const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices,
+                            size_t normalIndicesSize, double const* const* uvs, size_t const* uvsSizes,
                             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
                             uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSetsCount,
                             const uint32_t* faceRanges, size_t faceRangesSize, const prt::AttributeMap** materials,
                             const prt::AttributeMap** reports, const int32_t*) {
-	MFloatPointArray mayaVertices = toMayaFloatPointArray(vtx, vtxSize);
-	MIntArray mayaFaceCounts = toMayaIntArray(faceCounts, faceCountsSize);
-	MIntArray mayaVertexIndices = toMayaIntArray(vertexIndices, vertexIndicesSize);
-
 	if (DBG) {
 		LOG_DBG << "-- MayaCallbacks::addMesh";
+		LOG_DBG << "   initialShapeIndex = " << initialShapeIndex;
 		LOG_DBG << "   faceCountsSize = " << faceCountsSize;
 		LOG_DBG << "   vertexIndicesSize = " << vertexIndicesSize;
-		LOG_DBG << "   mayaVertices.length         = " << mayaVertices.length();
-		LOG_DBG << "   mayaFaceCounts.length   = " << mayaFaceCounts.length();
-		LOG_DBG << "   mayaVertexIndices.length = " << mayaVertexIndices.length();
 	}
 
-	MStatus stat;
-	MCHECK(stat);
-
-	MFnMeshData dataCreator;
-	MObject newOutputData = dataCreator.create(&stat);
-	MCHECK(stat);
-
-	MFnMesh mFnMesh1;
-	MObject oMesh = mFnMesh1.create(mayaVertices.length(), mayaFaceCounts.length(), mayaVertices, mayaFaceCounts,
-	                                mayaVertexIndices, newOutputData, &stat);
-	MCHECK(stat);
-
-	MFnMesh mFnMesh(oMesh);
-	mFnMesh.clearUVs();
-
-	// -- add texture coordinates
-	for (const TextureUVOrder& o : TEXTURE_UV_ORDERS) {
-		uint8_t uvSet = o.prtUvSetIndex;
-
-		if (uvSetsCount > uvSet && uvsSizes[uvSet] > 0) {
-
-			MFloatArray mU;
-			MFloatArray mV;
-			for (size_t uvIdx = 0; uvIdx < uvsSizes[uvSet] / 2; ++uvIdx) {
-				mU.append(static_cast<float>(uvs[uvSet][uvIdx * 2 + 0])); // maya mesh only supports float uvs
-				mV.append(static_cast<float>(uvs[uvSet][uvIdx * 2 + 1]));
-			}
-
-			MString uvSetName = o.mayaUvSetName;
-
-			if (uvSet != 0) {
-				mFnMesh.createUVSetDataMeshWithName(uvSetName, &stat);
-				MCHECK(stat);
-			}
-
-			MCHECK(mFnMesh.setUVs(mU, mV, &uvSetName));
-
-			MIntArray mUVCounts = toMayaIntArray(uvCounts[uvSet], uvCountsSizes[uvSet]);
-			MIntArray mUVIndices = toMayaIntArray(uvIndices[uvSet], uvIndicesSizes[uvSet]);
-			MCHECK(mFnMesh.assignUVs(mUVCounts, mUVIndices, &uvSetName));
-		}
-		else {
-			if (uvSet > 0) {
-				// add empty set to keep order consistent
-				mFnMesh.createUVSetDataMeshWithName(o.mayaUvSetName, &stat);
-				MCHECK(stat);
-			}
-		}
+	if (initialShapeIndex >= mResults.size()) {
+		LOG_ERR << "ignoring mesh of unexpected initial shape index " << initialShapeIndex;
+		return;
 	}
 
-	if (nrmSize > 0) {
-		assert(normalIndicesSize == vertexIndicesSize);
-		// guaranteed by MayaEncoder, see prtx::VertexNormalProcessor::SET_MISSING_TO_FACE_NORMALS
-
-		// convert to native maya normal layout
-		MVectorArray expandedNormals(static_cast<unsigned int>(vertexIndicesSize));
-		MIntArray faceList(static_cast<unsigned int>(vertexIndicesSize));
-
-		int indexCount = 0;
-		for (int i = 0; i < faceCountsSize; i++) {
-			int faceLength = mayaFaceCounts[i];
-
-			for (int j = 0; j < faceLength; j++) {
-				faceList[indexCount] = i;
-				int idx = normalIndices[indexCount];
-				expandedNormals.set(&nrm[idx * 3], indexCount);
-				indexCount++;
-			}
-		}
-
-		MCHECK(mFnMesh.setFaceVertexNormals(expandedNormals, faceList, mayaVertexIndices));
+	const auto start = std::chrono::steady_clock::now();
+
+	mResults[initialShapeIndex] = std::make_unique<GenerationResult>();
+	GenerationResult& r = *mResults[initialShapeIndex];
+
+	r.hasMesh = true;
+	r.vertices.assign(vtx, vtx + vtxSize);
+	r.normals.assign(nrm, nrm + nrmSize);
+	r.faceCounts.assign(faceCounts, faceCounts + faceCountsSize);
+	r.vertexIndices.assign(vertexIndices, vertexIndices + vertexIndicesSize);
+	r.normalIndices.assign(normalIndices, normalIndices + normalIndicesSize);
+
+	r.uvs.resize(uvSetsCount);
+	r.uvCounts.resize(uvSetsCount);
+	r.uvIndices.resize(uvSetsCount);
+	for (size_t uvSet = 0; uvSet < uvSetsCount; uvSet++) {
+		r.uvs[uvSet].assign(uvs[uvSet], uvs[uvSet] + uvsSizes[uvSet]);
+		r.uvCounts[uvSet].assign(uvCounts[uvSet], uvCounts[uvSet] + uvCountsSizes[uvSet]);
+		r.uvIndices[uvSet].assign(uvIndices[uvSet], uvIndices[uvSet] + uvIndicesSizes[uvSet]);
 	}
 
-	MFnMesh outputMesh(outMeshObj);
-	outputMesh.copyInPlace(oMesh);
+	r.faceRanges.assign(faceRanges, faceRanges + faceRangesSize);
+	const size_t faceRangeCount = (faceRangesSize > 0) ? faceRangesSize - 1 : 0;
+	r.materials = copyAttributeMaps(materials, faceRangeCount);
+	r.reports = copyAttributeMaps(reports, faceRangeCount);
 
-	// create material metadata
-	constexpr unsigned int maxStringLength = 400;
-	constexpr unsigned int maxFloatArrayLength = 5;
-	constexpr unsigned int maxStringArrayLength = 2;
-
-	adsk::Data::Structure* fStructure; // Structure to use for creation
-	fStructure = adsk::Data::Structure::structureByName(PRT_MATERIAL_STRUCTURE.c_str());
-	if ((fStructure == nullptr) && (materials != nullptr) && (faceRangesSize > 1)) {
-		const prt::AttributeMap* mat = materials[0];
+	const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+	mAddMeshTimes[initialShapeIndex] += duration.count();
+}
 
-		// Register our structure since it is not registered yet.
-		fStructure = adsk::Data::Structure::create();
-		fStructure->setName(PRT_MATERIAL_STRUCTURE.c_str());
+double MayaCallbacks::getAddMeshTime(size_t initialShapeIndex) const {
+	return (initialShapeIndex < mAddMeshTimes.size()) ? mAddMeshTimes[initialShapeIndex] : 0.0;
+}
 
-		fStructure->addMember(adsk::Data::Member::kInt32, 1, PRT_MATERIAL_FACE_INDEX_START.c_str());
-		fStructure->addMember(adsk::Data::Member::kInt32, 1, PRT_MATERIAL_FACE_INDEX_END.c_str());
+GenerationResultUPtr MayaCallbacks::takeResult(size_t initialShapeIndex) {
+	GenerationResultUPtr result;
+	if (initialShapeIndex < mResults.size())
+		result = std::move(mResults[initialShapeIndex]);
 
+	if (initialShapeIndex < mAttributeMapBuilders.size()) {
+		AttributeMapUPtr attributes(mAttributeMapBuilders[initialShapeIndex]->createAttributeMapAndReset());
 		size_t keyCount = 0;
-		wchar_t const* const* keys = mat->getKeys(&keyCount);
-		for (int k = 0; k < keyCount; k++) {
-			wchar_t const* key = keys[k];
-
-			adsk::Data::Member::eDataType type;
-			unsigned int size = 0;
-			unsigned int arrayLength = 1;
-
-			// clang-format off
-			switch (mat->getType(key)) {
-				case prt::Attributable::PT_BOOL: type = adsk::Data::Member::kBoolean; size = 1;  break;
-				case prt::Attributable::PT_FLOAT: type = adsk::Data::Member::kDouble; size = 1; break;
-				case prt::Attributable::PT_INT: type = adsk::Data::Member::kInt32; size = 1; break;
-
-				//workaround: using kString type crashes maya when setting metadata elememts. Therefore we use array of kUInt8
-				case prt::Attributable::PT_STRING: type = adsk::Data::Member::kUInt8; size = maxStringLength;  break;
-				case prt::Attributable::PT_BOOL_ARRAY: type = adsk::Data::Member::kBoolean; size = maxStringLength; break;
-				case prt::Attributable::PT_INT_ARRAY: type = adsk::Data::Member::kInt32; size = maxStringLength; break;
-				case prt::Attributable::PT_FLOAT_ARRAY: type = adsk::Data::Member::kDouble; size = maxFloatArrayLength; break;
-				case prt::Attributable::PT_STRING_ARRAY: type = adsk::Data::Member::kUInt8; size = maxStringLength; arrayLength = maxStringArrayLength; break;
-
-				case prt::Attributable::PT_UNDEFINED: break;
-				case prt::Attributable::PT_BLIND_DATA: break;
-				case prt::Attributable::PT_BLIND_DATA_ARRAY: break;
-				case prt::Attributable::PT_COUNT: break;
-			}
-			// clang-format on
-
-			if (size > 0) {
-				for (unsigned int i = 0; i < arrayLength; i++) {
-					std::wstring keyToUse = key;
-					if (i > 0)
-						keyToUse = key + std::to_wstring(i);
-					const std::string keyToUseNarrow = prtu::toOSNarrowFromUTF16(keyToUse);
-					fStructure->addMember(type, size, keyToUseNarrow.c_str());
-				}
-			}
+		attributes->getKeys(&keyCount);
+		if (keyCount > 0) {
+			if (!result)
+				result = std::make_unique<GenerationResult>();
+			result->attributes = std::move(attributes);
 		}
-
-		adsk::Data::Structure::registerStructure(*fStructure);
 	}
 
-	MCHECK(stat);
-	MFnMesh inputMesh(inMeshObj);
-
-	adsk::Data::Associations newMetadata(inputMesh.metadata(&stat));
-	newMetadata.makeUnique();
-	MCHECK(stat);
-	adsk::Data::Channel newChannel = newMetadata.channel(PRT_MATERIAL_CHANNEL);
-	adsk::Data::Stream newStream(*fStructure, PRT_MATERIAL_STREAM);
-
-	newChannel.setDataStream(newStream);
-	newMetadata.setChannel(newChannel);
-
-	if (faceRangesSize > 1) {
-
-		for (size_t fri = 0; fri < faceRangesSize - 1; fri++) {
-
-			if (materials != nullptr) {
-				adsk::Data::Handle handle(*fStructure);
-
-				const prt::AttributeMap* mat = materials[fri];
-
-				size_t keyCount = 0;
-				wchar_t const* const* keys = mat->getKeys(&keyCount);
-
-				for (int k = 0; k < keyCount; k++) {
-
-					wchar_t const* key = keys[k];
-
-					const std::string keyNarrow = prtu::toOSNarrowFromUTF16(key);
-
-					if (!handle.setPositionByMemberName(keyNarrow.c_str()))
-						continue;
-
-					size_t arraySize = 0;
-
-					switch (mat->getType(key)) {
-						case prt::Attributable::PT_BOOL:
-							handle.asBoolean()[0] = mat->getBool(key);
-							break;
-						case prt::Attributable::PT_FLOAT:
-							handle.asDouble()[0] = mat->getFloat(key);
-							break;
-						case prt::Attributable::PT_INT:
-							handle.asInt32()[0] = mat->getInt(key);
-							break;
-
-							// workaround: transporting string as uint8 array, because using asString crashes maya
-						case prt::Attributable::PT_STRING: {
-							const wchar_t* str = mat->getString(key);
-							if (wcslen(str) == 0)
-								break;
-							checkStringLength(str, maxStringLength);
-							size_t maxStringLengthTmp = maxStringLength;
-							prt::StringUtils::toOSNarrowFromUTF16(str, (char*)handle.asUInt8(), &maxStringLengthTmp);
-							break;
-						}
-						case prt::Attributable::PT_BOOL_ARRAY: {
-							const bool* boolArray;
-							boolArray = mat->getBoolArray(key, &arraySize);
-							for (unsigned int i = 0; i < arraySize && i < maxStringLength; i++)
-								handle.asBoolean()[i] = boolArray[i];
-							break;
-						}
-						case prt::Attributable::PT_INT_ARRAY: {
-							const int* intArray;
-							intArray = mat->getIntArray(key, &arraySize);
-							for (unsigned int i = 0; i < arraySize && i < maxStringLength; i++)
-								handle.asInt32()[i] = intArray[i];
-							break;
-						}
-						case prt::Attributable::PT_FLOAT_ARRAY: {
-							const double* floatArray;
-							floatArray = mat->getFloatArray(key, &arraySize);
-							for (unsigned int i = 0; i < arraySize && i < maxStringLength && i < maxFloatArrayLength;
-							     i++)
-								handle.asDouble()[i] = floatArray[i];
-							break;
-						}
-						case prt::Attributable::PT_STRING_ARRAY: {
-
-							const wchar_t* const* stringArray = mat->getStringArray(key, &arraySize);
-
-							for (unsigned int i = 0; i < arraySize && i < maxStringLength; i++) {
-								if (wcslen(stringArray[i]) == 0)
-									continue;
-
-								if (i > 0) {
-									std::wstring keyToUse = key + std::to_wstring(i);
-									const std::string keyToUseNarrow = prtu::toOSNarrowFromUTF16(keyToUse);
-									if (!handle.setPositionByMemberName(keyToUseNarrow.c_str()))
-										continue;
-								}
-
-								checkStringLength(stringArray[i], maxStringLength);
-								size_t maxStringLengthTmp = maxStringLength;
-								prt::StringUtils::toOSNarrowFromUTF16(stringArray[i], (char*)handle.asUInt8(),
-								                                      &maxStringLengthTmp);
-							}
-							break;
-						}
-
-						case prt::Attributable::PT_UNDEFINED:
-							break;
-						case prt::Attributable::PT_BLIND_DATA:
-							break;
-						case prt::Attributable::PT_BLIND_DATA_ARRAY:
-							break;
-						case prt::Attributable::PT_COUNT:
-							break;
-					}
-				}
-
-				handle.setPositionByMemberName(PRT_MATERIAL_FACE_INDEX_START.c_str());
-				*handle.asInt32() = faceRanges[fri];
-
-				handle.setPositionByMemberName(PRT_MATERIAL_FACE_INDEX_END.c_str());
-				*handle.asInt32() = faceRanges[fri + 1];
-
-				newStream.setElement(static_cast<adsk::Data::IndexCount>(fri), handle);
-			}
+	return result;
+}
 
-			if (reports != nullptr) {
-				// todo
-			}
-		}
+prt::AttributeMapBuilder* MayaCallbacks::getAttributeMapBuilder(size_t initialShapeIndex) {
+	if (initialShapeIndex >= mAttributeMapBuilders.size()) {
+		LOG_ERR << "ignoring attribute of unexpected initial shape index " << initialShapeIndex;
+		return nullptr;
 	}
-
-	outputMesh.setMetadata(newMetadata);
+	return mAttributeMapBuilders[initialShapeIndex].get();
 }
 
-prt::Status MayaCallbacks::attrBool(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key, bool value) {
-	mAttributeMapBuilder->setBool(key, value);
-	return prt::STATUS_OK;
+prt::Status MayaCallbacks::attrBool(size_t isIndex, int32_t /*shapeID*/, const wchar_t* key, bool value) {
+	if (prt::AttributeMapBuilder* amb = getAttributeMapBuilder(isIndex))
+		amb->setBool(key, value);
+	return getStatus();
 }
 
-prt::Status MayaCallbacks::attrFloat(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key, double value) {
-	mAttributeMapBuilder->setFloat(key, value);
-	return prt::STATUS_OK;
+prt::Status MayaCallbacks::attrFloat(size_t isIndex, int32_t /*shapeID*/, const wchar_t* key, double value) {
+	if (prt::AttributeMapBuilder* amb = getAttributeMapBuilder(isIndex))
+		amb->setFloat(key, value);
+	return getStatus();
 }
 
-prt::Status MayaCallbacks::attrString(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key,
+prt::Status MayaCallbacks::attrString(size_t isIndex, int32_t /*shapeID*/, const wchar_t* key,
                                       const wchar_t* value) {
-	mAttributeMapBuilder->setString(key, value);
-	return prt::STATUS_OK;
+	if (prt::AttributeMapBuilder* amb = getAttributeMapBuilder(isIndex))
+		amb->setString(key, value);
+	return getStatus();
 }
 
 // PRT version >= 2.1
 #if PRT_VERSION_GTE(2, 1)
 
-prt::Status MayaCallbacks::attrBoolArray(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key,
+prt::Status MayaCallbacks::attrBoolArray(size_t isIndex, int32_t /*shapeID*/, const wchar_t* key,
                                          const bool* values, size_t size) {
-	mAttributeMapBuilder->setBoolArray(key, values, size);
-	return prt::STATUS_OK;
+	if (prt::AttributeMapBuilder* amb = getAttributeMapBuilder(isIndex))
+		amb->setBoolArray(key, values, size);
+	return getStatus();
 }
 
-prt::Status MayaCallbacks::attrFloatArray(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key,
+prt::Status MayaCallbacks::attrFloatArray(size_t isIndex, int32_t /*shapeID*/, const wchar_t* key,
                                           const double* values, size_t size) {
-	mAttributeMapBuilder->setFloatArray(key, values, size);
-	return prt::STATUS_OK;
+	if (prt::AttributeMapBuilder* amb = getAttributeMapBuilder(isIndex))
+		amb->setFloatArray(key, values, size);
+	return getStatus();
 }
 
-prt::Status MayaCallbacks::attrStringArray(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key,
+prt::Status MayaCallbacks::attrStringArray(size_t isIndex, int32_t /*shapeID*/, const wchar_t* key,
                                            const wchar_t* const* values, size_t size) {
-	mAttributeMapBuilder->setStringArray(key, values, size);
-	return prt::STATUS_OK;
+	if (prt::AttributeMapBuilder* amb = getAttributeMapBuilder(isIndex))
+		amb->setStringArray(key, values, size);
+	return getStatus();
 }
 
 #endif // PRT version >= 2.1
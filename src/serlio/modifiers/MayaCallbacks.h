@@ -21,11 +21,15 @@
 
 #include "encoder/IMayaCallbacks.h"
 
+#include "modifiers/GenerationResult.h"
+
 #include "utils/LogHandler.h"
 #include "utils/Utilities.h"
 
-#include "maya/MObject.h"
-
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -35,39 +39,44 @@
 
 class MayaCallbacks : public IMayaCallbacks {
 public:
-	MayaCallbacks(const MObject& inMesh, const MObject& outMesh, AttributeMapBuilderUPtr& amb)
-	    : inMeshObj(inMesh), outMeshObj(outMesh), mAttributeMapBuilder(amb) {}
+	// returns true once the result of the generation is not needed anymore, may be called from PRT worker threads
+	using CancellationToken = std::function<bool()>;
+
+	// PRT calls the callbacks concurrently for different initial shapes, therefore all per shape state is allocated
+	// up front for the number of initial shapes passed to prt::generate
+	explicit MayaCallbacks(size_t initialShapeCount, CancellationToken cancellationToken = {});
 
 	// prt::Callbacks interface
+	// returning a non-OK status makes PRT abort the generation
 	prt::Status generateError(size_t /*isIndex*/, prt::Status /*status*/, const wchar_t* message) override {
 		LOG_ERR << "GENERATE ERROR: " << message;
-		return prt::STATUS_OK;
+		return getStatus();
 	}
 	prt::Status assetError(size_t /*isIndex*/, prt::CGAErrorLevel /*level*/, const wchar_t* /*key*/,
 	                       const wchar_t* /*uri*/, const wchar_t* message) override {
 		LOG_ERR << "ASSET ERROR: " << message;
-		return prt::STATUS_OK;
+		return getStatus();
 	}
 	prt::Status cgaError(size_t /*isIndex*/, int32_t /*shapeID*/, prt::CGAErrorLevel /*level*/, int32_t /*methodId*/,
 	                     int32_t /*pc*/, const wchar_t* message) override {
 		LOG_ERR << "CGA ERROR: " << message;
-		return prt::STATUS_OK;
+		return getStatus();
 	}
 	prt::Status cgaPrint(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* txt) override {
 		LOG_INF << "CGA PRINT: " << txt;
-		return prt::STATUS_OK;
+		return getStatus();
 	}
 	prt::Status cgaReportBool(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/,
 	                          bool /*value*/) override {
-		return prt::STATUS_OK;
+		return getStatus();
 	}
 	prt::Status cgaReportFloat(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/,
 	                           double /*value*/) override {
-		return prt::STATUS_OK;
+		return getStatus();
 	}
 	prt::Status cgaReportString(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/,
 	                            const wchar_t* /*value*/) override {
-		return prt::STATUS_OK;
+		return getStatus();
 	}
 	prt::Status attrBool(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/, bool /*value*/) override;
 	prt::Status attrFloat(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/, double /*value*/) override;
@@ -88,7 +97,8 @@ public:
 
 public:
 	// clang-format off
-	void addMesh(const wchar_t* name,
+	void addMesh(size_t initialShapeIndex,
+	                     const wchar_t* name,
 	                     const double* vtx, size_t vtxSize,
 	                     const double* nrm, size_t nrmSize,
 	                     const uint32_t* faceCounts, size_t faceCountsSize,
@@ -106,9 +116,47 @@ public:
 	                     const int32_t* shapeIDs) override;
 	// clang-format on
 
+	bool isCancelled() const override {
+		return mCancellationToken && mCancellationToken();
+	}
+
+	// the geometry and attribute values received for the given initial shape, nullptr if nothing was received
+	GenerationResultUPtr takeResult(size_t initialShapeIndex = 0);
+
+	// time spent converting the encoder output of the given initial shape in addMesh, in milliseconds
+	double getAddMeshTime(size_t initialShapeIndex = 0) const;
+
 private:
-	MObject outMeshObj;
-	MObject inMeshObj;
+	// nullptr for an unexpected initial shape index
+	prt::AttributeMapBuilder* getAttributeMapBuilder(size_t initialShapeIndex);
 
-	AttributeMapBuilderUPtr& mAttributeMapBuilder;
+	prt::Status getStatus() const {
+		return isCancelled() ? prt::STATUS_UNSPECIFIED_ERROR : prt::STATUS_OK;
+	}
+
+	const CancellationToken mCancellationToken;
+
+	std::vector<GenerationResultUPtr> mResults;                 // per initial shape
+	std::vector<double> mAddMeshTimes;                          // per initial shape
+	std::vector<AttributeMapBuilderUPtr> mAttributeMapBuilders; // per initial shape
 };
+
+/**
+ * Runs generate() on a worker thread while the calling thread polls interruptRequested(). Once that returns true,
+ * cancelled is set, i.e. generate() should use it as the cancellation token of its MayaCallbacks.
+ * Without interruptRequested, generate() is called directly.
+ */
+template <typename F>
+prt::Status generateInterruptible(F&& generate, const std::function<bool()>& interruptRequested,
+                                  std::atomic<bool>& cancelled) {
+	if (!interruptRequested)
+		return generate();
+
+	constexpr std::chrono::milliseconds INTERRUPT_POLL_INTERVAL(20);
+	std::future<prt::Status> status = std::async(std::launch::async, std::forward<F>(generate));
+	while (status.wait_for(INTERRUPT_POLL_INTERVAL) != std::future_status::ready) {
+		if (!cancelled && interruptRequested())
+			cancelled = true;
+	}
+	return status.get();
+}
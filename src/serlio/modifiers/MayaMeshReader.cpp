@@ -0,0 +1,74 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/MayaMeshReader.h"
+
+#include "utils/MArrayWrapper.h"
+#include "utils/MayaUtilities.h"
+
+#include "maya/MFloatPointArray.h"
+#include "maya/MFnMesh.h"
+#include "maya/MIntArray.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+namespace MayaMeshReader {
+
+PRTMesh read(const MObject& mesh) {
+	assert(mesh.hasFn(MFn::kMesh));
+
+	MStatus status;
+	const MFnMesh meshFn(mesh, &status);
+	MCHECK(status);
+
+	// vertex coordinates
+	MFloatPointArray vertexArray;
+	meshFn.getPoints(vertexArray);
+
+	const unsigned int vertexArrayLength = vertexArray.length();
+	std::vector<double> vertexCoords;
+	vertexCoords.reserve(3 * vertexArrayLength);
+	for (unsigned int i = 0; i < vertexArrayLength; ++i) {
+		vertexCoords.push_back(vertexArray[i].x);
+		vertexCoords.push_back(vertexArray[i].y);
+		vertexCoords.push_back(vertexArray[i].z);
+	}
+
+	// faces
+	MIntArray vertexCount;
+	MIntArray vertexList;
+	meshFn.getVertices(vertexCount, vertexList);
+
+	std::vector<uint32_t> faceCounts;
+	faceCounts.reserve(vertexCount.length());
+	const auto vertexCountWrapper = mu::makeMArrayConstWrapper(vertexCount);
+	std::copy(vertexCountWrapper.begin(), vertexCountWrapper.end(), std::back_inserter(faceCounts));
+
+	std::vector<uint32_t> indices;
+	indices.reserve(vertexList.length());
+	const auto vertexListWrapper = mu::makeMArrayConstWrapper(vertexList);
+	std::copy(vertexListWrapper.begin(), vertexListWrapper.end(), std::back_inserter(indices));
+
+	return PRTMesh(std::move(vertexCoords), std::move(indices), std::move(faceCounts));
+}
+
+} // namespace MayaMeshReader
@@ -0,0 +1,444 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/MayaMeshWriter.h"
+
+#include "materials/MaterialInfo.h"
+
+#include "utils/LogHandler.h"
+#include "utils/MayaUtilities.h"
+#include "utils/Utilities.h"
+
+#include "prt/StringUtils.h"
+
+#include "maya/MFloatArray.h"
+#include "maya/MFloatPointArray.h"
+#include "maya/MFloatVectorArray.h"
+#include "maya/MFnMesh.h"
+#include "maya/MFnMeshData.h"
+#include "maya/MVectorArray.h"
+#include "maya/adskDataAssociations.h"
+#include "maya/adskDataStream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+namespace {
+
+constexpr bool DBG = false;
+
+void checkStringLength(const wchar_t* string, const size_t& maxStringLength) {
+	if (wcslen(string) >= maxStringLength) {
+		const std::wstring msg = L"Maximum texture path size is " + std::to_wstring(maxStringLength);
+		prt::log(msg.c_str(), prt::LOG_ERROR);
+	}
+}
+
+// concatenates a uv set of all results, faces of results without this uv set get no uvs (uv count 0)
+bool spliceUVSet(const std::vector<GenerationResultSPtr>& results, size_t uvSet, MFloatArray& u, MFloatArray& v,
+                 MIntArray& uvCounts, MIntArray& uvIndices) {
+	unsigned int uvBase = 0;
+	for (const GenerationResultSPtr& r : results) {
+		if (!r || !r->hasMesh)
+			continue;
+
+		if (uvSet < r->uvs.size()) {
+			const std::vector<double>& uvs = r->uvs[uvSet];
+			for (size_t uvIdx = 0; uvIdx < uvs.size() / 2; ++uvIdx) {
+				u.append(static_cast<float>(uvs[uvIdx * 2 + 0])); // maya mesh only supports float uvs
+				v.append(static_cast<float>(uvs[uvIdx * 2 + 1]));
+			}
+			for (const uint32_t c : r->uvCounts[uvSet])
+				uvCounts.append(static_cast<int>(c));
+			for (const uint32_t i : r->uvIndices[uvSet])
+				uvIndices.append(static_cast<int>(uvBase + i));
+			uvBase += static_cast<unsigned int>(uvs.size() / 2);
+		}
+		else {
+			for (size_t fi = 0; fi < r->faceCounts.size(); fi++)
+				uvCounts.append(0);
+		}
+	}
+	return u.length() > 0;
+}
+
+} // namespace
+
+struct TextureUVOrder {
+	MString mayaUvSetName;
+	uint8_t mayaUvSetIndex;
+	uint8_t prtUvSetIndex;
+};
+
+// maya pbr stingray shader only supports first 4 uvsets -> reoder so first 4 are most important ones
+// other shaders support >4 sets
+const std::vector<TextureUVOrder> TEXTURE_UV_ORDERS = []() -> std::vector<TextureUVOrder> {
+	// clang-format off
+	return {
+	        // maya uvset name | maya idx | prt idx  | CGA key
+	        { L"map1",         0,    0 },  // colormap
+	        { L"dirtMap",      1,    2 },  // dirtmap
+	        { L"normalMap",    2,    5 },  // normalmap
+	        { L"opacityMap",   3,    4 },  // opacitymap
+
+	        { L"bumpMap",      4,    1 },  // bumpmap
+	        { L"specularMap",  5,    3 },  // specularmap
+	        { L"emissiveMap",  6,    6 },  // emissivemap
+	        { L"occlusionMap", 7,    7 },  // occlusionmap
+	        { L"roughnessMap", 8,    8 },  // roughnessmap
+	        { L"metallicMap",  9,    9 }   // metallicmap
+	};
+	// clang-format on
+}();
+
+MStatus MayaMeshWriter::write(const std::vector<GenerationResultSPtr>& results, const MObject& inMeshObj,
+                              const MObject& outMeshObj) {
+	// the results of all initial shapes are spliced into a single maya mesh, indices are offset accordingly
+	unsigned int numVertices = 0;
+	unsigned int numFaces = 0;
+	unsigned int numIndices = 0;
+	size_t uvSetsCount = 0;
+	bool hasMesh = false;
+	bool hasNormals = true;
+	bool hasReports = false;
+	for (const GenerationResultSPtr& r : results) {
+		if (!r || !r->hasMesh)
+			continue;
+		hasMesh = true;
+		numVertices += static_cast<unsigned int>(r->vertices.size() / 3);
+		numFaces += static_cast<unsigned int>(r->faceCounts.size());
+		numIndices += static_cast<unsigned int>(r->vertexIndices.size());
+		uvSetsCount = std::max(uvSetsCount, r->uvs.size());
+		hasNormals = hasNormals && (r->normals.size() > 0 || r->vertexIndices.empty());
+		hasReports = hasReports || !r->reports.empty();
+	}
+	if (!hasMesh)
+		return MS::kSuccess;
+
+	MFloatPointArray mayaVertices(numVertices);
+	MIntArray mayaFaceCounts(numFaces, 0);
+	MIntArray mayaVertexIndices(numIndices, 0);
+
+	// native maya normal layout
+	MVectorArray expandedNormals(hasNormals ? numIndices : 0);
+	MIntArray faceList(hasNormals ? numIndices : 0);
+
+	std::vector<uint32_t> faceRanges;
+	std::vector<const prt::AttributeMap*> materialPtrs;
+
+	unsigned int vertexBase = 0;
+	unsigned int faceBase = 0;
+	unsigned int indexBase = 0;
+	for (const GenerationResultSPtr& r : results) {
+		if (!r || !r->hasMesh)
+			continue;
+
+		const unsigned int vertexCount = static_cast<unsigned int>(r->vertices.size() / 3);
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			const double* v = &r->vertices[i * 3];
+			mayaVertices.set(MFloatPoint(static_cast<float>(v[0]), static_cast<float>(v[1]), static_cast<float>(v[2])),
+			                 vertexBase + i);
+		}
+
+		for (size_t fi = 0; fi < r->faceCounts.size(); fi++)
+			mayaFaceCounts[faceBase + static_cast<unsigned int>(fi)] = r->faceCounts[fi];
+
+		for (size_t vi = 0; vi < r->vertexIndices.size(); vi++)
+			mayaVertexIndices[indexBase + static_cast<unsigned int>(vi)] = vertexBase + r->vertexIndices[vi];
+
+		if (hasNormals && !r->normals.empty()) {
+			assert(r->normalIndices.size() == r->vertexIndices.size());
+			// guaranteed by MayaEncoder, see prtx::VertexNormalProcessor::SET_MISSING_TO_FACE_NORMALS
+
+			unsigned int indexCount = indexBase;
+			for (size_t fi = 0; fi < r->faceCounts.size(); fi++) {
+				for (uint32_t j = 0; j < r->faceCounts[fi]; j++) {
+					faceList[indexCount] = faceBase + static_cast<int>(fi);
+					const uint32_t idx = r->normalIndices[indexCount - indexBase];
+					expandedNormals.set(&r->normals[idx * 3], indexCount);
+					indexCount++;
+				}
+			}
+		}
+
+		for (size_t fri = 0; fri + 1 < r->faceRanges.size(); fri++) {
+			faceRanges.push_back(faceBase + r->faceRanges[fri]);
+			materialPtrs.push_back((fri < r->materials.size()) ? r->materials[fri].get() : nullptr);
+		}
+
+		vertexBase += vertexCount;
+		faceBase += static_cast<unsigned int>(r->faceCounts.size());
+		indexBase += static_cast<unsigned int>(r->vertexIndices.size());
+	}
+	faceRanges.push_back(faceBase); // close last range
+
+	const size_t faceRangesSize = faceRanges.size();
+	const auto firstMaterial = std::find_if(materialPtrs.begin(), materialPtrs.end(),
+	                                        [](const prt::AttributeMap* m) { return m != nullptr; });
+	const prt::AttributeMap* const* materials = (firstMaterial != materialPtrs.end()) ? materialPtrs.data() : nullptr;
+
+	if (DBG) {
+		LOG_DBG << "-- MayaMeshWriter::write";
+		LOG_DBG << "   results.size = " << results.size();
+		LOG_DBG << "   mayaVertices.length         = " << mayaVertices.length();
+		LOG_DBG << "   mayaFaceCounts.length   = " << mayaFaceCounts.length();
+		LOG_DBG << "   mayaVertexIndices.length = " << mayaVertexIndices.length();
+	}
+
+	MStatus stat;
+	MCHECK(stat);
+
+	MFnMeshData dataCreator;
+	MObject newOutputData = dataCreator.create(&stat);
+	MCHECK(stat);
+
+	MFnMesh mFnMesh1;
+	MObject oMesh = mFnMesh1.create(mayaVertices.length(), mayaFaceCounts.length(), mayaVertices, mayaFaceCounts,
+	                                mayaVertexIndices, newOutputData, &stat);
+	MCHECK(stat);
+
+	MFnMesh mFnMesh(oMesh);
+	mFnMesh.clearUVs();
+
+	// -- add texture coordinates
+	for (const TextureUVOrder& o : TEXTURE_UV_ORDERS) {
+		uint8_t uvSet = o.prtUvSetIndex;
+
+		MFloatArray mU;
+		MFloatArray mV;
+		MIntArray mUVCounts;
+		MIntArray mUVIndices;
+		if (uvSetsCount > uvSet && spliceUVSet(results, uvSet, mU, mV, mUVCounts, mUVIndices)) {
+			MString uvSetName = o.mayaUvSetName;
+
+			if (uvSet != 0) {
+				mFnMesh.createUVSetDataMeshWithName(uvSetName, &stat);
+				MCHECK(stat);
+			}
+
+			MCHECK(mFnMesh.setUVs(mU, mV, &uvSetName));
+			MCHECK(mFnMesh.assignUVs(mUVCounts, mUVIndices, &uvSetName));
+		}
+		else {
+			if (uvSet > 0) {
+				// add empty set to keep order consistent
+				mFnMesh.createUVSetDataMeshWithName(o.mayaUvSetName, &stat);
+				MCHECK(stat);
+			}
+		}
+	}
+
+	if (hasNormals && numIndices > 0)
+		MCHECK(mFnMesh.setFaceVertexNormals(expandedNormals, faceList, mayaVertexIndices));
+
+	MFnMesh outputMesh(outMeshObj);
+	outputMesh.copyInPlace(oMesh);
+
+	// create material metadata
+	constexpr unsigned int maxStringLength = 400;
+	constexpr unsigned int maxFloatArrayLength = 5;
+	constexpr unsigned int maxStringArrayLength = 2;
+
+	adsk::Data::Structure* fStructure; // Structure to use for creation
+	fStructure = adsk::Data::Structure::structureByName(PRT_MATERIAL_STRUCTURE.c_str());
+	if ((fStructure == nullptr) && (materials != nullptr) && (faceRangesSize > 1)) {
+		const prt::AttributeMap* mat = *firstMaterial;
+
+		// Register our structure since it is not registered yet.
+		fStructure = adsk::Data::Structure::create();
+		fStructure->setName(PRT_MATERIAL_STRUCTURE.c_str());
+
+		fStructure->addMember(adsk::Data::Member::kInt32, 1, PRT_MATERIAL_FACE_INDEX_START.c_str());
+		fStructure->addMember(adsk::Data::Member::kInt32, 1, PRT_MATERIAL_FACE_INDEX_END.c_str());
+
+		size_t keyCount = 0;
+		wchar_t const* const* keys = mat->getKeys(&keyCount);
+		for (int k = 0; k < keyCount; k++) {
+			wchar_t const* key = keys[k];
+
+			adsk::Data::Member::eDataType type;
+			unsigned int size = 0;
+			unsigned int arrayLength = 1;
+
+			// clang-format off
+			switch (mat->getType(key)) {
+				case prt::Attributable::PT_BOOL: type = adsk::Data::Member::kBoolean; size = 1;  break;
+				case prt::Attributable::PT_FLOAT: type = adsk::Data::Member::kDouble; size = 1; break;
+				case prt::Attributable::PT_INT: type = adsk::Data::Member::kInt32; size = 1; break;
+
+				//workaround: using kString type crashes maya when setting metadata elememts. Therefore we use array of kUInt8
+				case prt::Attributable::PT_STRING: type = adsk::Data::Member::kUInt8; size = maxStringLength;  break;
+				case prt::Attributable::PT_BOOL_ARRAY: type = adsk::Data::Member::kBoolean; size = maxStringLength; break;
+				case prt::Attributable::PT_INT_ARRAY: type = adsk::Data::Member::kInt32; size = maxStringLength; break;
+				case prt::Attributable::PT_FLOAT_ARRAY: type = adsk::Data::Member::kDouble; size = maxFloatArrayLength; break;
+				case prt::Attributable::PT_STRING_ARRAY: type = adsk::Data::Member::kUInt8; size = maxStringLength; arrayLength = maxStringArrayLength; break;
+
+				case prt::Attributable::PT_UNDEFINED: break;
+				case prt::Attributable::PT_BLIND_DATA: break;
+				case prt::Attributable::PT_BLIND_DATA_ARRAY: break;
+				case prt::Attributable::PT_COUNT: break;
+			}
+			// clang-format on
+
+			if (size > 0) {
+				for (unsigned int i = 0; i < arrayLength; i++) {
+					std::wstring keyToUse = key;
+					if (i > 0)
+						keyToUse = key + std::to_wstring(i);
+					const std::string keyToUseNarrow = prtu::toOSNarrowFromUTF16(keyToUse);
+					fStructure->addMember(type, size, keyToUseNarrow.c_str());
+				}
+			}
+		}
+
+		adsk::Data::Structure::registerStructure(*fStructure);
+	}
+
+	MCHECK(stat);
+	MFnMesh inputMesh(inMeshObj);
+
+	adsk::Data::Associations newMetadata(inputMesh.metadata(&stat));
+	newMetadata.makeUnique();
+	MCHECK(stat);
+	adsk::Data::Channel newChannel = newMetadata.channel(PRT_MATERIAL_CHANNEL);
+	adsk::Data::Stream newStream(*fStructure, PRT_MATERIAL_STREAM);
+
+	newChannel.setDataStream(newStream);
+	newMetadata.setChannel(newChannel);
+
+	if (faceRangesSize > 1) {
+
+		for (size_t fri = 0; fri < faceRangesSize - 1; fri++) {
+
+			if (materials != nullptr && materials[fri] != nullptr) {
+				adsk::Data::Handle handle(*fStructure);
+
+				const prt::AttributeMap* mat = materials[fri];
+
+				size_t keyCount = 0;
+				wchar_t const* const* keys = mat->getKeys(&keyCount);
+
+				for (int k = 0; k < keyCount; k++) {
+
+					wchar_t const* key = keys[k];
+
+					const std::string keyNarrow = prtu::toOSNarrowFromUTF16(key);
+
+					if (!handle.setPositionByMemberName(keyNarrow.c_str()))
+						continue;
+
+					size_t arraySize = 0;
+
+					switch (mat->getType(key)) {
+						case prt::Attributable::PT_BOOL:
+							handle.asBoolean()[0] = mat->getBool(key);
+							break;
+						case prt::Attributable::PT_FLOAT:
+							handle.asDouble()[0] = mat->getFloat(key);
+							break;
+						case prt::Attributable::PT_INT:
+							handle.asInt32()[0] = mat->getInt(key);
+							break;
+
+							// workaround: transporting string as uint8 array, because using asString crashes maya
+						case prt::Attributable::PT_STRING: {
+							const wchar_t* str = mat->getString(key);
+							if (wcslen(str) == 0)
+								break;
+							checkStringLength(str, maxStringLength);
+							size_t maxStringLengthTmp = maxStringLength;
+							prt::StringUtils::toOSNarrowFromUTF16(str, (char*)handle.asUInt8(), &maxStringLengthTmp);
+							break;
+						}
+						case prt::Attributable::PT_BOOL_ARRAY: {
+							const bool* boolArray;
+							boolArray = mat->getBoolArray(key, &arraySize);
+							for (unsigned int i = 0; i < arraySize && i < maxStringLength; i++)
+								handle.asBoolean()[i] = boolArray[i];
+							break;
+						}
+						case prt::Attributable::PT_INT_ARRAY: {
+							const int* intArray;
+							intArray = mat->getIntArray(key, &arraySize);
+							for (unsigned int i = 0; i < arraySize && i < maxStringLength; i++)
+								handle.asInt32()[i] = intArray[i];
+							break;
+						}
+						case prt::Attributable::PT_FLOAT_ARRAY: {
+							const double* floatArray;
+							floatArray = mat->getFloatArray(key, &arraySize);
+							for (unsigned int i = 0; i < arraySize && i < maxStringLength && i < maxFloatArrayLength;
+							     i++)
+								handle.asDouble()[i] = floatArray[i];
+							break;
+						}
+						case prt::Attributable::PT_STRING_ARRAY: {
+
+							const wchar_t* const* stringArray = mat->getStringArray(key, &arraySize);
+
+							for (unsigned int i = 0; i < arraySize && i < maxStringLength; i++) {
+								if (wcslen(stringArray[i]) == 0)
+									continue;
+
+								if (i > 0) {
+									std::wstring keyToUse = key + std::to_wstring(i);
+									const std::string keyToUseNarrow = prtu::toOSNarrowFromUTF16(keyToUse);
+									if (!handle.setPositionByMemberName(keyToUseNarrow.c_str()))
+										continue;
+								}
+
+								checkStringLength(stringArray[i], maxStringLength);
+								size_t maxStringLengthTmp = maxStringLength;
+								prt::StringUtils::toOSNarrowFromUTF16(stringArray[i], (char*)handle.asUInt8(),
+								                                      &maxStringLengthTmp);
+							}
+							break;
+						}
+
+						case prt::Attributable::PT_UNDEFINED:
+							break;
+						case prt::Attributable::PT_BLIND_DATA:
+							break;
+						case prt::Attributable::PT_BLIND_DATA_ARRAY:
+							break;
+						case prt::Attributable::PT_COUNT:
+							break;
+					}
+				}
+
+				handle.setPositionByMemberName(PRT_MATERIAL_FACE_INDEX_START.c_str());
+				*handle.asInt32() = faceRanges[fri];
+
+				handle.setPositionByMemberName(PRT_MATERIAL_FACE_INDEX_END.c_str());
+				*handle.asInt32() = faceRanges[fri + 1];
+
+				newStream.setElement(static_cast<adsk::Data::IndexCount>(fri), handle);
+			}
+
+			if (hasReports) {
+				// todo
+			}
+		}
+	}
+
+	outputMesh.setMetadata(newMetadata);
+
+	return MS::kSuccess;
+}
@@ -0,0 +1,35 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "modifiers/GenerationResult.h"
+
+#include "maya/MObject.h"
+#include "maya/MStatus.h"
+
+#include <vector>
+
+namespace MayaMeshWriter {
+
+// replaces outMesh with the generated geometry of all results (one per initial shape, null entries are skipped) and
+// attaches the material metadata (based on the metadata of inMesh)
+MStatus write(const std::vector<GenerationResultSPtr>& results, const MObject& inMesh, const MObject& outMesh);
+
+} // namespace MayaMeshWriter
@@ -0,0 +1,165 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/OcclusionManager.h"
+
+#include "utils/LogHandler.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr bool DBG = false;
+
+} // namespace
+
+bool OcclusionManager::hasInput(OwnerID owner, uint64_t inputHash) const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	const auto it = mEntries.find(owner);
+	return (it != mEntries.end()) && (it->second.mInput.inputHash == inputHash);
+}
+
+void OcclusionManager::setInput(OwnerID owner, OccluderInput&& input) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	Entry& entry = mEntries[owner];
+	entry.mInput = std::move(input);
+	entry.mChanged = true; // the previous occluders stay in the set until the next rebuild
+	mDirty = true;
+}
+
+void OcclusionManager::removeInput(OwnerID owner) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	const auto it = mEntries.find(owner);
+	if (it == mEntries.end())
+		return;
+	const std::vector<prt::OcclusionSet::Handle>& handles = it->second.mHandles;
+	mRemovedHandles.insert(mRemovedHandles.end(), handles.begin(), handles.end());
+	mEntries.erase(it);
+	mDirty = true;
+}
+
+bool OcclusionManager::isDirty() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mDirty;
+}
+
+uint64_t OcclusionManager::rebuild(prt::Callbacks* callbacks, prt::Cache* cache) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	const uint64_t epoch = ++mEpoch;
+
+	std::vector<prt::OcclusionSet::Handle> outdatedHandles = std::move(mRemovedHandles);
+	mRemovedHandles.clear();
+	if (!outdatedHandles.empty())
+		mRemovalEpoch = epoch;
+
+	InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+	std::vector<InitialShapeUPtr> shapes;
+	std::vector<Entry*> shapeEntries;
+	for (auto& e : mEntries) {
+		Entry& entry = e.second;
+		if (!entry.mChanged)
+			continue;
+
+		outdatedHandles.insert(outdatedHandles.end(), entry.mHandles.begin(), entry.mHandles.end());
+		entry.mHandles.clear();
+		entry.mEpoch = epoch;
+		entry.mChanged = false;
+
+		const OccluderInput& input = entry.mInput;
+		for (const OccluderShape& shape : input.shapes) {
+			isb->setGeometry(shape.vertexCoords.data(), shape.vertexCoords.size(), shape.indices.data(),
+			                 shape.indices.size(), shape.faceCounts.data(), shape.faceCounts.size());
+			isb->setAttributes(input.ruleFile.c_str(), input.startRule.c_str(), shape.seed, L"",
+			                   input.attributes.get(), input.resolveMap.get());
+			shapes.emplace_back(isb->createInitialShapeAndReset());
+			shapeEntries.push_back(&entry);
+		}
+	}
+
+	if (mOcclusionSet && !outdatedHandles.empty())
+		mOcclusionSet->dispose(outdatedHandles.data(), outdatedHandles.size());
+
+	if (!shapes.empty()) {
+		if (!mOcclusionSet)
+			mOcclusionSet.reset(prt::OcclusionSet::create(), PRTDestroyer());
+
+		std::vector<prt::OcclusionSet::Handle> handles(shapes.size());
+		const InitialShapeNOPtrVector shapePtrs = prtu::toPtrVec(shapes);
+		const prt::Status status = prt::generateOccluders(shapePtrs.data(), shapePtrs.size(), handles.data(), nullptr,
+		                                                  0, nullptr, callbacks, cache, mOcclusionSet.get());
+		if (status == prt::STATUS_OK) {
+			for (size_t si = 0; si < shapeEntries.size(); si++)
+				shapeEntries[si]->mHandles.push_back(handles[si]);
+		}
+		else {
+			// we do not know which occluders made it into the set, the next rebuild starts over
+			LOG_ERR << "prt generateOccluders failed: " << prt::getStatusDescription(status);
+			mOcclusionSet.reset();
+			for (auto& e : mEntries) {
+				e.second.mHandles.clear();
+				e.second.mEpoch = epoch;
+				e.second.mChanged = true;
+			}
+		}
+	}
+
+	if (DBG)
+		LOG_DBG << "regenerated " << shapes.size() << " occluders and removed " << outdatedHandles.size()
+		        << " of " << mEntries.size() << " nodes";
+
+	mDirty = false;
+	return epoch;
+}
+
+bool OcclusionManager::isPartOfSet(const Entry& entry) const {
+	return mOcclusionSet && !entry.mHandles.empty() && entry.mHandles.size() == entry.mInput.shapes.size();
+}
+
+uint64_t OcclusionManager::getEpoch(const Entry& entry) const {
+	if (!isPartOfSet(entry))
+		return 0;
+
+	// the occluders of an owner are only seen by its own queries if it has several shapes, e.g. one per face
+	const bool seesOwnOccluders = entry.mInput.shapes.size() > 1;
+	uint64_t epoch = mRemovalEpoch;
+	for (const auto& e : mEntries) {
+		if (&e.second != &entry || seesOwnOccluders)
+			epoch = std::max(epoch, e.second.mEpoch);
+	}
+	return epoch;
+}
+
+OcclusionManager::Occluders OcclusionManager::getOccluders(OwnerID owner) const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	Occluders occluders;
+	const auto it = mEntries.find(owner);
+	if (it == mEntries.end() || !isPartOfSet(it->second))
+		return occluders;
+
+	occluders.occlusionSet = mOcclusionSet;
+	occluders.handles = it->second.mHandles;
+	occluders.epoch = getEpoch(it->second);
+	return occluders;
+}
+
+uint64_t OcclusionManager::getEpoch(OwnerID owner) const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	const auto it = mEntries.find(owner);
+	return (it != mEntries.end()) ? getEpoch(it->second) : 0;
+}
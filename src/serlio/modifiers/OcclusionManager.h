@@ -0,0 +1,106 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Utilities.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Scene-wide occlusion set shared by all serlio nodes with enabled scene occlusion. The occluders of all new or changed
+ * initial shapes are generated in a single prt::generateOccluders call (i.e. in parallel on the PRT thread pool) and
+ * added to the set, the outdated ones are removed. Each node passes the shared set to its prt::generate, so that
+ * inside/touches queries also see other nodes.
+ *
+ * The handles passed along identify the occluders of the generated shapes themselves, which are ignored by their
+ * queries. Therefore the result of an owner with a single shape only depends on the occluders of the other owners and
+ * the epoch of an owner only changes with these. Until the next rebuild, a changed owner keeps its previous handles.
+ */
+class OcclusionManager {
+public:
+	using OwnerID = const void*;
+
+	struct OccluderShape {
+		std::vector<double> vertexCoords;
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> faceCounts;
+		int32_t seed = 0;
+	};
+
+	struct OccluderInput {
+		uint64_t inputHash = 0; // covers geometry, seeds, rule and attributes of all shapes
+		std::vector<OccluderShape> shapes;
+		std::wstring ruleFile;
+		std::wstring startRule;
+		AttributeMapUPtr attributes;
+		ResolveMapSPtr resolveMap;
+	};
+
+	struct Occluders {
+		OcclusionSetSPtr occlusionSet;                  // empty if the owner is not part of the current set
+		std::vector<prt::OcclusionSet::Handle> handles; // one per shape of the owner
+		uint64_t epoch = 0; // version of the occluders seen by the owner, 0 if it is not part of the set
+	};
+
+	OcclusionManager() = default;
+	OcclusionManager(const OcclusionManager&) = delete;
+	OcclusionManager(OcclusionManager&&) = delete;
+	OcclusionManager& operator=(OcclusionManager const&) = delete;
+	OcclusionManager& operator=(OcclusionManager&&) = delete;
+	~OcclusionManager() = default;
+
+	bool hasInput(OwnerID owner, uint64_t inputHash) const;
+	void setInput(OwnerID owner, OccluderInput&& input);
+	void removeInput(OwnerID owner);
+
+	// true if the registered inputs changed since the last rebuild
+	bool isDirty() const;
+
+	// regenerates the occluders of the new and changed inputs, removes outdated ones and returns the new epoch
+	uint64_t rebuild(prt::Callbacks* callbacks, prt::Cache* cache);
+
+	Occluders getOccluders(OwnerID owner) const;
+	uint64_t getEpoch(OwnerID owner) const; // see Occluders::epoch
+
+private:
+	struct Entry {
+		OccluderInput mInput;
+		std::vector<prt::OcclusionSet::Handle> mHandles; // of the input of the last rebuild, empty before
+		uint64_t mEpoch = 0;                             // of the rebuild which generated mHandles
+		bool mChanged = true;                            // mInput differs from the one of mHandles
+	};
+	std::unordered_map<OwnerID, Entry> mEntries;
+
+	bool isPartOfSet(const Entry& entry) const;
+	uint64_t getEpoch(const Entry& entry) const;
+
+	OcclusionSetSPtr mOcclusionSet;
+	std::vector<prt::OcclusionSet::Handle> mRemovedHandles; // of removed inputs, disposed by the next rebuild
+	uint64_t mEpoch = 0;
+	uint64_t mRemovalEpoch = 0; // of the last rebuild which disposed the occluders of removed inputs
+	bool mDirty = false;
+	mutable std::mutex mMutex;
+};
+
+using OcclusionManagerUPtr = std::unique_ptr<OcclusionManager>;
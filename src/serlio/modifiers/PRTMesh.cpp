@@ -19,44 +19,41 @@
 
 #include "modifiers/PRTMesh.h"
 
-#include "utils/MArrayWrapper.h"
-#include "utils/MayaUtilities.h"
-
-#include "maya/MFloatPointArray.h"
-#include "maya/MFnMesh.h"
-#include "maya/MIntArray.h"
-
-#include <cassert>
-
-PRTMesh::PRTMesh(const MObject& mesh) {
-	assert(mesh.hasFn(MFn::kMesh));
-
-	MStatus status;
-	const MFnMesh meshFn(mesh, &status);
-	MCHECK(status);
-
-	// vertex coordinates
-	MFloatPointArray vertexArray;
-	meshFn.getPoints(vertexArray);
-
-	const unsigned int vertexArrayLength = vertexArray.length();
-	mVertexCoordsVec.reserve(3 * vertexArrayLength);
-	for (unsigned int i = 0; i < vertexArrayLength; ++i) {
-		mVertexCoordsVec.push_back(vertexArray[i].x);
-		mVertexCoordsVec.push_back(vertexArray[i].y);
-		mVertexCoordsVec.push_back(vertexArray[i].z);
+#include "utils/Utilities.h"
+
+#include <utility>
+
+PRTMesh::PRTMesh(std::vector<double> vertexCoords, std::vector<uint32_t> indices, std::vector<uint32_t> faceCounts)
+    : mVertexCoordsVec(std::move(vertexCoords)), mIndicesVec(std::move(indices)),
+      mFaceCountsVec(std::move(faceCounts)) {}
+
+std::vector<PRTMesh> PRTMesh::splitFaces() const {
+	std::vector<PRTMesh> faces;
+	faces.reserve(mFaceCountsVec.size());
+
+	size_t indexBase = 0;
+	for (const uint32_t faceCount : mFaceCountsVec) {
+		faces.push_back(PRTMesh());
+		PRTMesh& face = faces.back();
+
+		face.mVertexCoordsVec.reserve(3 * faceCount);
+		face.mIndicesVec.reserve(faceCount);
+		for (uint32_t vi = 0; vi < faceCount; vi++) {
+			const uint32_t index = mIndicesVec[indexBase + vi];
+			face.mVertexCoordsVec.insert(face.mVertexCoordsVec.end(), mVertexCoordsVec.begin() + 3 * index,
+			                             mVertexCoordsVec.begin() + 3 * index + 3);
+			face.mIndicesVec.push_back(vi);
+		}
+		face.mFaceCountsVec.push_back(faceCount);
+
+		indexBase += faceCount;
 	}
 
-	// faces
-	MIntArray vertexCount;
-	MIntArray vertexList;
-	meshFn.getVertices(vertexCount, vertexList);
-
-	mFaceCountsVec.reserve(vertexCount.length());
-	const auto vertexCountWrapper = mu::makeMArrayConstWrapper(vertexCount);
-	std::copy(vertexCountWrapper.begin(), vertexCountWrapper.end(), std::back_inserter(mFaceCountsVec));
+	return faces;
+}
 
-	mIndicesVec.reserve(vertexList.length());
-	const auto vertexListWrapper = mu::makeMArrayConstWrapper(vertexList);
-	std::copy(vertexListWrapper.begin(), vertexListWrapper.end(), std::back_inserter(mIndicesVec));
+uint64_t PRTMesh::hash() const {
+	uint64_t h = prtu::hash(mVertexCoordsVec);
+	h = prtu::hash(mIndicesVec, h);
+	return prtu::hash(mFaceCountsVec, h);
 }
@@ -19,10 +19,11 @@
 
 #pragma once
 
-#include "maya/MTypes.h"
-
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
+// initial shape geometry, see MayaMeshReader::read() for the conversion from maya meshes
 class PRTMesh {
 
 private:
@@ -30,8 +31,13 @@ private:
 	std::vector<uint32_t> mIndicesVec;
 	std::vector<uint32_t> mFaceCountsVec;
 
+	PRTMesh() = default;
+
 public:
-	explicit PRTMesh(const MObject& mesh);
+	PRTMesh(std::vector<double> vertexCoords, std::vector<uint32_t> indices, std::vector<uint32_t> faceCounts);
+
+	// one mesh per face, e.g. to use each face as a separate initial shape
+	std::vector<PRTMesh> splitFaces() const;
 
 	const double* vertexCoords() const noexcept {
 		return mVertexCoordsVec.data();
@@ -56,4 +62,6 @@ public:
 	size_t faceCountsCount() const noexcept {
 		return mFaceCountsVec.size();
 	}
+
+	uint64_t hash() const;
 };
@@ -18,7 +18,10 @@
  */
 
 #include "modifiers/PRTModifierAction.h"
+#include "modifiers/GenerationCache.h"
 #include "modifiers/MayaCallbacks.h"
+#include "modifiers/MayaMeshReader.h"
+#include "modifiers/MayaMeshWriter.h"
 #include "modifiers/PRTModifierCommand.h"
 #include "modifiers/RuleAttributes.h"
 
@@ -28,6 +31,8 @@
 
 #include "prt/StringUtils.h"
 
+#include "maya/MComputation.h"
+#include "maya/MDataHandle.h"
 #include "maya/MFloatPointArray.h"
 #include "maya/MFnCompoundAttribute.h"
 #include "maya/MFnMesh.h"
@@ -35,7 +40,14 @@
 #include "maya/MFnStringData.h"
 #include "maya/MFnTypedAttribute.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cwchar>
+#include <map>
+#include <tuple>
+#include <unordered_set>
 
 #define CHECK_STATUS(st)                                                                                               \
 	if ((st) != MS::kSuccess) {                                                                                        \
@@ -53,49 +65,114 @@ constexpr const wchar_t* FILE_CGA_ERROR = L"CGAErrors.txt";
 constexpr const wchar_t* FILE_CGA_PRINT = L"CGAPrint.txt";
 
 constexpr const wchar_t* NULL_KEY = L"#NULL#";
-constexpr const wchar_t* MIN_KEY = L"min";
-constexpr const wchar_t* MAX_KEY = L"max";
 constexpr const wchar_t* RESTRICTED_KEY = L"restricted";
 
 const AttributeMapUPtr
         EMPTY_ATTRIBUTES(AttributeMapBuilderUPtr(prt::AttributeMapBuilder::create())->createAttributeMap());
 
-AttributeMapUPtr getDefaultAttributeValues(const std::wstring& ruleFile, const std::wstring& startRule,
-                                           const prt::ResolveMap& resolveMap, prt::CacheObject& cache,
-                                           const PRTMesh& prtMesh) {
-	AttributeMapBuilderUPtr mayaCallbacksAttributeBuilder(prt::AttributeMapBuilder::create());
-	MayaCallbacks mayaCallbacks(MObject::kNullObj, MObject::kNullObj, mayaCallbacksAttributeBuilder);
+uint64_t getEncoderHash(const wchar_t* encoderID, const AttributeMapUPtr& encoderOptions) {
+	return prtu::hashAttributeMap(encoderOptions.get(), prtu::hash(std::wstring(encoderID)));
+}
 
-	InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+// looks up the memory cache first, then the disk cache. results depending on scene occlusion are never stored on disk.
+GenerationResultSPtr getCachedResult(const GenerationCache::Key& key) {
+	if (key.rpkFingerprint == 0)
+		return {};
 
-	isb->setGeometry(prtMesh.vertexCoords(), prtMesh.vcCount(), prtMesh.indices(), prtMesh.indicesCount(),
-	                 prtMesh.faceCounts(), prtMesh.faceCountsCount());
+	GenerationCache& generationCache = *PRTContext::get().mGenerationCache;
+	GenerationResultSPtr result = generationCache.get(key);
+	if (result || !PRTContext::get().mDiskGenerationCache || key.occlusionEpoch != 0)
+		return result;
+
+	result = PRTContext::get().mDiskGenerationCache->get(key);
+	if (result)
+		generationCache.insert(key, result);
+	return result;
+}
 
-	const int32_t seed = mu::computeSeed(prtMesh.vertexCoords(), prtMesh.vcCount());
+void putCachedResult(const GenerationCache::Key& key, const GenerationResultSPtr& result) {
+	if (key.rpkFingerprint == 0)
+		return;
+	PRTContext::get().mGenerationCache->insert(key, result);
+	if (PRTContext::get().mDiskGenerationCache && key.occlusionEpoch == 0)
+		PRTContext::get().mDiskGenerationCache->put(key, *result);
+}
+
+// evaluates the default rule attribute values of all meshes with a single prt::generate call
+std::vector<GenerationResultSPtr> getDefaultAttributeValues(const std::wstring& ruleFile, const std::wstring& startRule,
+                                                            const ResolveMapSPtr& resolveMap, uint64_t rpkFingerprint,
+                                                            prt::CacheObject& cache,
+                                                            const std::vector<const PRTMesh*>& prtMeshes) {
+	const AttributeMapUPtr attrEncOpts = prtu::createValidatedOptions(ENC_ID_ATTR_EVAL);
+	const uint64_t attrEncOptsHash = getEncoderHash(ENC_ID_ATTR_EVAL, attrEncOpts);
+	const uint64_t emptyAttributesHash = prtu::hashAttributeMap(EMPTY_ATTRIBUTES.get());
+
+	// attribute values do not refer to unpacked files, so their keys do not depend on the asset location
+	std::vector<GenerationCache::Key> keys;
+	std::vector<GenerationResultSPtr> results;
+	std::vector<size_t> missingShapes;
+	for (const PRTMesh* prtMesh : prtMeshes) {
+		const int32_t seed = prtu::computeSeed(prtMesh->vertexCoords(), prtMesh->vcCount());
+		keys.push_back(
+		        {prtMesh->hash(), emptyAttributesHash, seed, ruleFile, startRule, attrEncOptsHash, rpkFingerprint});
+		results.push_back(getCachedResult(keys.back()));
+		if (!results.back())
+			missingShapes.push_back(results.size() - 1);
+	}
+	if (missingShapes.empty())
+		return results;
 
-	isb->setAttributes(ruleFile.c_str(), startRule.c_str(), seed, L"", EMPTY_ATTRIBUTES.get(), &resolveMap);
+	MayaCallbacks mayaCallbacks(missingShapes.size());
 
-	const InitialShapeUPtr shape(isb->createInitialShapeAndReset());
-	const InitialShapeNOPtrVector shapes = {shape.get()};
+	InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+	std::vector<InitialShapeUPtr> shapes;
+	shapes.reserve(missingShapes.size());
+	for (const size_t i : missingShapes) {
+		const PRTMesh& prtMesh = *prtMeshes[i];
+		isb->setGeometry(prtMesh.vertexCoords(), prtMesh.vcCount(), prtMesh.indices(), prtMesh.indicesCount(),
+		                 prtMesh.faceCounts(), prtMesh.faceCountsCount());
+		isb->setAttributes(ruleFile.c_str(), startRule.c_str(), keys[i].seed, L"", EMPTY_ATTRIBUTES.get(),
+		                   resolveMap.get());
+		shapes.emplace_back(isb->createInitialShapeAndReset());
+	}
+	const InitialShapeNOPtrVector shapePtrs = prtu::toPtrVec(shapes);
 
 	const std::vector<const wchar_t*> encIDs = {ENC_ID_ATTR_EVAL};
-	const AttributeMapUPtr attrEncOpts = prtu::createValidatedOptions(ENC_ID_ATTR_EVAL);
 	const AttributeMapNOPtrVector encOpts = {attrEncOpts.get()};
 	assert(encIDs.size() == encOpts.size());
 
-	prt::generate(shapes.data(), shapes.size(), nullptr, encIDs.data(), encIDs.size(), encOpts.data(), &mayaCallbacks,
-	              &cache, nullptr);
+	const prt::Status generateStatus =
+	        prt::generate(shapePtrs.data(), shapePtrs.size(), nullptr, encIDs.data(), encIDs.size(), encOpts.data(),
+	                      &mayaCallbacks, &cache, nullptr);
+
+	for (size_t si = 0; si < missingShapes.size(); si++) {
+		const size_t i = missingShapes[si];
+		GenerationResultUPtr result = mayaCallbacks.takeResult(si);
+		if (!result)
+			result = std::make_unique<GenerationResult>();
+		if (!result->attributes) {
+			const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+			result->attributes.reset(amb->createAttributeMap());
+		}
+		results[i] = std::move(result);
+		if (generateStatus == prt::STATUS_OK)
+			putCachedResult(keys[i], results[i]);
+	}
+	return results;
+}
 
-	return AttributeMapUPtr(mayaCallbacksAttributeBuilder->createAttributeMap());
+GenerationResultSPtr getDefaultAttributeValues(const std::wstring& ruleFile, const std::wstring& startRule,
+                                               const ResolveMapSPtr& resolveMap, uint64_t rpkFingerprint,
+                                               prt::CacheObject& cache, const PRTMesh& prtMesh) {
+	return getDefaultAttributeValues(ruleFile, startRule, resolveMap, rpkFingerprint, cache, {&prtMesh}).front();
 }
 
 } // namespace
 
 PRTModifierAction::PRTModifierAction() {
-	AttributeMapBuilderUPtr optionsBuilder(prt::AttributeMapBuilder::create());
-
-	mMayaEncOpts = prtu::createValidatedOptions(ENC_ID_MAYA);
+	updateMayaEncoderOptions();
 
+	AttributeMapBuilderUPtr optionsBuilder(prt::AttributeMapBuilder::create());
 	optionsBuilder->setString(L"name", FILE_CGA_ERROR);
 	const AttributeMapUPtr errOptions(optionsBuilder->createAttributeMapAndReset());
 	mCGAErrorOptions = prtu::createValidatedOptions(ENC_ID_CGA_ERROR, errOptions.get());
@@ -105,6 +182,12 @@ PRTModifierAction::PRTModifierAction() {
 	mCGAPrintOptions = prtu::createValidatedOptions(ENC_ID_CGA_PRINT, printOptions.get());
 }
 
+PRTModifierAction::~PRTModifierAction() {
+	const OcclusionManagerUPtr& occlusionManager = PRTContext::get().mOcclusionManager;
+	if (occlusionManager)
+		occlusionManager->removeInput(this);
+}
+
 std::list<MObject> getNodeAttributesCorrespondingToCGA(const MFnDependencyNode& node) {
 	std::list<MObject> rawAttrs;
 	std::list<MObject> ignoreList;
@@ -139,14 +222,13 @@ std::list<MObject> getNodeAttributesCorrespondingToCGA(const MFnDependencyNode&
 	return rawAttrs;
 }
 
-const RuleAttribute RULE_NOT_FOUND{};
-
-MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
+// reads the attribute values from the data block, which (unlike MPlug) is safe during parallel evaluation
+MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node, MDataBlock& data) {
 	MStatus stat;
 	const MFnDependencyNode fNode(node, &stat);
 	MCHECK(stat);
 
-	auto resolveMap = getResolveMap();
+	const ResolveMapSPtr& resolveMap = mResolveMap;
 	if (!resolveMap)
 		return MStatus::kInvalidParameter;
 
@@ -154,32 +236,28 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 	if (ruleFileURI == nullptr)
 		return MStatus::kInvalidParameter;
 
-	const RuleFileInfoUPtr info(prt::createRuleFileInfo(ruleFileURI));
-
-	auto reverseLookupAttribute = [this](const std::wstring& mayaFullAttrName) {
-		auto it = std::find_if(mRuleAttributes.begin(), mRuleAttributes.end(),
-		                       [&mayaFullAttrName](const auto& ra) { return (ra.mayaFullName == mayaFullAttrName); });
-		if (it != mRuleAttributes.end())
-			return *it;
-		return RULE_NOT_FOUND;
-	};
-
 	const std::list<MObject> cgaAttributes = getNodeAttributesCorrespondingToCGA(fNode);
 
-	const AttributeMapUPtr defaultAttributeValues =
-	        getDefaultAttributeValues(mRuleFile, mStartRule, *getResolveMap(), *PRTContext::get().theCache, *inPrtMesh);
+	const GenerationResultSPtr defaultResult = getDefaultAttributeValues(
+	        mRuleFile, mStartRule, resolveMap, mRPKFingerprint, *PRTContext::get().theCache, *inPrtMesh);
+	const AttributeMapUPtr& defaultAttributeValues = defaultResult->attributes;
 	AttributeMapBuilderUPtr aBuilder(prt::AttributeMapBuilder::create());
 
 	for (const auto& attrObj : cgaAttributes) {
 		MFnAttribute fnAttr(attrObj);
-		const MPlug plug(node, attrObj);
+		MDataHandle handle = data.inputValue(attrObj, &stat);
+		if (stat != MS::kSuccess)
+			continue;
 
 		const MString fullAttrName = fnAttr.name();
-		const RuleAttribute ruleAttr = reverseLookupAttribute(fullAttrName.asWChar());
-		assert(!ruleAttr.fqName.empty()); // poor mans check for RULE_NOT_FOUND
+		const RuleAttribute* ruleAttr = mRuleAttributes.findByMayaFullName(fullAttrName.asWChar());
+		if (ruleAttr == nullptr) {
+			LOG_WRN << "no rule attribute found for node attribute " << fullAttrName.asWChar();
+			continue;
+		}
 
-		const std::wstring fqAttrName = ruleAttr.fqName;
-		const auto ruleAttrType = ruleAttr.mType;
+		const std::wstring& fqAttrName = ruleAttr->fqName;
+		const auto ruleAttrType = ruleAttr->mType;
 
 		if (attrObj.hasFn(MFn::kNumericAttribute)) {
 			MFnNumericAttribute nAttr(attrObj);
@@ -187,8 +265,7 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 			if (nAttr.unitType() == MFnNumericData::kBoolean) {
 				assert(ruleAttrType == prt::AAT_BOOL);
 
-				bool val;
-				MCHECK(plug.getValue(val));
+				const bool val = handle.asBool();
 
 				const auto defVal = defaultAttributeValues->getBool(fqAttrName.c_str());
 				if (val != defVal)
@@ -197,8 +274,7 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 			else if (nAttr.unitType() == MFnNumericData::kDouble) {
 				assert(ruleAttrType == prt::AAT_FLOAT);
 
-				double val;
-				MCHECK(plug.getValue(val));
+				const double val = handle.asDouble();
 
 				const auto defVal = defaultAttributeValues->getFloat(fqAttrName.c_str());
 				if (val != defVal)
@@ -208,12 +284,8 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 				assert(ruleAttrType == prt::AAT_STR);
 				const wchar_t* defColStr = defaultAttributeValues->getString(fqAttrName.c_str());
 
-				MObject rgb;
-				MCHECK(plug.getValue(rgb));
-				MFnNumericData fRGB(rgb);
-
-				prtu::Color col;
-				MCHECK(fRGB.getData3Float(col[0], col[1], col[2]));
+				const float3& rgb = handle.asFloat3();
+				const prtu::Color col = {rgb[0], rgb[1], rgb[2]};
 				const std::wstring colStr = prtu::getColorString(col);
 
 				if (std::wcscmp(colStr.c_str(), defColStr) != 0)
@@ -223,8 +295,7 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 		else if (attrObj.hasFn(MFn::kTypedAttribute)) {
 			assert(ruleAttrType == prt::AAT_STR);
 
-			MString val;
-			MCHECK(plug.getValue(val));
+			const MString& val = handle.asString();
 
 			const auto defVal = defaultAttributeValues->getString(fqAttrName.c_str());
 			if (std::wcscmp(val.asWChar(), defVal) != 0)
@@ -234,9 +305,8 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 			MFnEnumAttribute eAttr(attrObj);
 
 			short di;
-			short i;
 			MCHECK(eAttr.getDefault(di));
-			MCHECK(plug.getValue(i));
+			const short i = handle.asShort();
 			if (i != di) {
 				switch (ruleAttrType) {
 					case prt::AAT_STR:
@@ -264,14 +334,35 @@ void PRTModifierAction::setMesh(MObject& _inMesh, MObject& _outMesh) {
 	inMesh = _inMesh;
 	outMesh = _outMesh;
 
-	inPrtMesh = std::make_unique<PRTMesh>(_inMesh);
+	inPrtMesh = std::make_unique<PRTMesh>(MayaMeshReader::read(_inMesh));
 }
 
-ResolveMapSPtr PRTModifierAction::getResolveMap() {
-	ResolveMapCache::LookupResult lookupResult =
-	        PRTContext::get().mResolveMapCache->get(std::wstring(mRulePkg.asWChar()));
-	ResolveMapSPtr resolveMap = lookupResult.first;
-	return resolveMap;
+void PRTModifierAction::updateResolveMap() {
+	const std::wstring rulePkg(mRulePkg.asWChar());
+	ResolveMapCache::LookupResult lookupResult = PRTContext::get().mResolveMapCache->get(rulePkg);
+	mResolveMap = lookupResult.first;
+	mRPKFingerprint = mResolveMap ? PRTContext::get().mResolveMapCache->getFingerprint(rulePkg) : 0;
+	mAssetLocation = mResolveMap ? PRTContext::get().mResolveMapCache->getAssetLocation(rulePkg) : 0;
+	PRTContext::get().mPRTCacheManager->touch(rulePkg, mResolveMap);
+	updateMayaEncoderOptions();
+}
+
+void PRTModifierAction::updateMayaEncoderOptions() {
+	// textures read directly from the rpks need to be extracted for maya's file nodes. The directory depends only on
+	// the rpk content, so the encoder options (and therefore the cache keys) stay the same across sessions.
+	std::wstring textureDirectory;
+	if (mResolveMap)
+		textureDirectory = PRTContext::get().mResolveMapCache->getTextureDirectory(mRulePkg.asWChar());
+	if (mMayaEncOpts && textureDirectory == mTextureDirectory)
+		return;
+	mTextureDirectory = textureDirectory;
+
+	AttributeMapBuilderUPtr optionsBuilder(prt::AttributeMapBuilder::create());
+	if (!mTextureDirectory.empty())
+		optionsBuilder->setString(EO_TEXTURE_DIRECTORY, mTextureDirectory.c_str());
+	const AttributeMapUPtr mayaOptions(optionsBuilder->createAttributeMap());
+	mMayaEncOpts = prtu::createValidatedOptions(ENC_ID_MAYA, mayaOptions.get());
+	mMayaEncOptsHash = getEncoderHash(ENC_ID_MAYA, mMayaEncOpts);
 }
 
 MStatus PRTModifierAction::updateRuleFiles(const MObject& node, const MString& rulePkg) {
@@ -280,9 +371,10 @@ MStatus PRTModifierAction::updateRuleFiles(const MObject& node, const MString& r
 	mEnums.clear();
 	mRuleFile.clear();
 	mStartRule.clear();
-	mRuleAttributes.clear();
+	mRuleAttributes = RuleAttributeRegistry();
 
-	ResolveMapSPtr resolveMap = getResolveMap();
+	updateResolveMap();
+	const ResolveMapSPtr& resolveMap = mResolveMap;
 	if (!resolveMap) {
 		LOG_ERR << "failed to get resolve map from rule package " << mRulePkg.asWChar();
 		return MS::kFailure;
@@ -310,59 +402,373 @@ MStatus PRTModifierAction::updateRuleFiles(const MObject& node, const MString& r
 	mStartRule = prtu::detectStartRule(info);
 
 	if (node != MObject::kNullObj) {
-		mGenerateAttrs = getDefaultAttributeValues(mRuleFile, mStartRule, *getResolveMap(), *PRTContext::get().theCache,
-		                                           *inPrtMesh);
+		const GenerationResultSPtr defaultResult = getDefaultAttributeValues(
+		        mRuleFile, mStartRule, resolveMap, mRPKFingerprint, *PRTContext::get().theCache, *inPrtMesh);
 		if (DBG)
-			LOG_DBG << "default attrs: " << prtu::objectToXML(mGenerateAttrs);
+			LOG_DBG << "default attrs: " << prtu::objectToXML(defaultResult->attributes);
 
 		// derive necessary data from PRT rule info to populate node with dynamic rule attributes
-		mRuleAttributes = getRuleAttributes(mRuleFile, info.get());
-		sortRuleAttributes(mRuleAttributes);
+		RuleAttributes ruleAttributes = getRuleAttributes(mRuleFile, info.get());
+		sortRuleAttributes(ruleAttributes);
+		mRuleAttributes = RuleAttributeRegistry(std::move(ruleAttributes), std::move(info));
 
-		createNodeAttributes(node, info.get());
+		createNodeAttributes(node, defaultResult->attributes.get());
 	}
 
 	return MS::kSuccess;
 }
 
 MStatus PRTModifierAction::doIt() {
-	MStatus status;
+	const GenerationRequestUPtr request = prepareGeneration();
+	generateMissingShapes({request.get()});
 
-	AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
-	std::unique_ptr<MayaCallbacks> outputHandler(new MayaCallbacks(inMesh, outMesh, amb));
+	const auto start = std::chrono::steady_clock::now();
+	const MStatus status = MayaMeshWriter::write(request->results, inMesh, outMesh);
+	const std::chrono::duration<double, std::milli> meshBuildTime = std::chrono::steady_clock::now() - start;
 
-	InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
-	const prt::Status setGeoStatus =
-	        isb->setGeometry(inPrtMesh->vertexCoords(), inPrtMesh->vcCount(), inPrtMesh->indices(),
-	                         inPrtMesh->indicesCount(), inPrtMesh->faceCounts(), inPrtMesh->faceCountsCount());
-	if (setGeoStatus != prt::STATUS_OK)
-		LOG_ERR << "InitialShapeBuilder setGeometry failed status = " << prt::getStatusDescription(setGeoStatus);
+	updateGenerationStats(*request, meshBuildTime.count());
+	return status;
+}
 
-	isb->setAttributes(mRuleFile.c_str(), mStartRule.c_str(), mRandomSeed, L"", mGenerateAttrs.get(),
-	                   getResolveMap().get());
+void PRTModifierAction::updateGenerationStats(const GenerationRequest& request, double meshBuildMs) {
+	GenerationStats stats;
 
-	std::unique_ptr<const prt::InitialShape, PRTDestroyer> shape(isb->createInitialShapeAndReset());
+	// after generateBatch() the results only need to be fetched from the cache, report the batch timings instead
+	if (request.missCount == 0 && mHasBatchGenerationStats)
+		stats = mBatchGenerationStats;
+	else {
+		stats.generateMs = request.generateMs;
+		stats.encodeMs = request.encodeMs;
+		stats.cacheHit = (request.missCount == 0);
+	}
+	mHasBatchGenerationStats = false;
 
-	const std::vector<const wchar_t*> encIDs = {ENC_ID_MAYA, ENC_ID_CGA_ERROR, ENC_ID_CGA_PRINT};
-	const AttributeMapNOPtrVector encOpts = {mMayaEncOpts.get(), mCGAErrorOptions.get(), mCGAPrintOptions.get()};
-	assert(encIDs.size() == encOpts.size());
+	stats.meshBuildMs = meshBuildMs;
+	for (const GenerationResultSPtr& r : request.results) {
+		if (!r || !r->hasMesh)
+			continue;
+		stats.faceCount += static_cast<int32_t>(r->faceCounts.size());
+		stats.vertexCount += static_cast<int32_t>(r->vertices.size() / 3);
+		stats.materialCount += static_cast<int32_t>(r->materials.size());
+	}
+	mGenerationStats = stats;
+}
 
-	InitialShapeNOPtrVector shapes = {shape.get()};
-	const prt::Status generateStatus =
-	        prt::generate(shapes.data(), shapes.size(), nullptr, encIDs.data(), encIDs.size(), encOpts.data(),
-	                      outputHandler.get(), PRTContext::get().theCache.get(), nullptr);
-	if (generateStatus != prt::STATUS_OK)
-		LOG_ERR << "prt generate failed: " << prt::getStatusDescription(generateStatus);
+void PRTModifierAction::generateBatch(const std::vector<PRTModifierAction*>& actions) {
+	std::vector<GenerationRequestUPtr> requests;
+	std::vector<GenerationRequest*> requestPtrs;
+	for (PRTModifierAction* action : actions) {
+		requests.push_back(action->prepareGeneration());
+		requestPtrs.push_back(requests.back().get());
+	}
+	generateMissingShapes(requestPtrs);
+
+	for (size_t i = 0; i < actions.size(); i++) {
+		GenerationStats& stats = actions[i]->mBatchGenerationStats;
+		stats.generateMs = requests[i]->generateMs;
+		stats.encodeMs = requests[i]->encodeMs;
+		stats.cacheHit = (requests[i]->missCount == 0);
+		actions[i]->mHasBatchGenerationStats = true;
+	}
+}
 
-	return status;
+void PRTModifierAction::evaluateDefaultAttributesBatch(const std::vector<PRTModifierAction*>& actions) {
+	// default values can only be evaluated together for shapes with the same rule file
+	using RuleKey = std::tuple<ResolveMapSPtr, uint64_t, std::wstring, std::wstring>;
+	std::map<RuleKey, std::vector<const PRTMesh*>> meshesByRule;
+	for (PRTModifierAction* action : actions) {
+		const ResolveMapSPtr& resolveMap = action->mResolveMap;
+		if (!resolveMap || action->mRuleFile.empty() || !action->inPrtMesh)
+			continue;
+		const RuleKey ruleKey(resolveMap, action->mRPKFingerprint, action->mRuleFile, action->mStartRule);
+		meshesByRule[ruleKey].push_back(action->inPrtMesh.get());
+	}
+
+	for (const auto& rm : meshesByRule)
+		getDefaultAttributeValues(std::get<2>(rm.first), std::get<3>(rm.first), std::get<0>(rm.first),
+		                          std::get<1>(rm.first), *PRTContext::get().theCache, rm.second);
+}
+
+PRTModifierAction::GenerationRequestUPtr PRTModifierAction::prepareGeneration() {
+	auto request = std::make_unique<GenerationRequest>();
+	request->resolveMap = mResolveMap;
+
+	// either the whole mesh is a single initial shape or each face is a separate one
+	if (mInitialShapePerFace) {
+		request->faceMeshes = inPrtMesh->splitFaces();
+		request->shapeMeshes.reserve(request->faceMeshes.size());
+		for (const PRTMesh& faceMesh : request->faceMeshes)
+			request->shapeMeshes.push_back(&faceMesh);
+	}
+	else
+		request->shapeMeshes.push_back(inPrtMesh.get());
+
+	// look up all initial shapes, only the ones with changed geometry, attributes or seed need to be generated
+	// the preview settings end up in the cache key via the start rule, attributes and encoder options hash
+	const bool isPreview = mPreviewSettings.enabled;
+	if (isPreview) {
+		updatePreviewEncoderOptions();
+		request->previewAttrs = createPreviewAttributes();
+	}
+	const std::wstring startRule = isPreview ? getPreviewStartRule() : mStartRule;
+	const prt::AttributeMap* ruleAttrs = mGenerateAttrs ? mGenerateAttrs.get() : EMPTY_ATTRIBUTES.get();
+	request->generateAttrs = isPreview ? request->previewAttrs.get() : ruleAttrs;
+	request->mayaEncOpts = isPreview ? mPreviewEncOpts.get() : mMayaEncOpts.get();
+	request->cgaErrorOpts = mCGAErrorOptions.get();
+	request->cgaPrintOpts = mCGAPrintOptions.get();
+	const uint64_t mayaEncOptsHash = isPreview ? mPreviewEncOptsHash : mMayaEncOptsHash;
+	const uint64_t attributesHash = prtu::hashAttributeMap(request->generateAttrs);
+
+	std::vector<GenerationCache::Key>& keys = request->keys;
+	keys.reserve(request->shapeMeshes.size());
+	for (const PRTMesh* shapeMesh : request->shapeMeshes) {
+		const int32_t faceSeed =
+		        mInitialShapePerFace ? prtu::computeSeed(shapeMesh->vertexCoords(), shapeMesh->vcCount()) : 0;
+		const int32_t seed = prtu::addSeeds(mRandomSeed, faceSeed);
+		keys.push_back({shapeMesh->hash(), attributesHash, seed, mRuleFile, startRule, mayaEncOptsHash, mRPKFingerprint,
+		                0, mAssetLocation});
+	}
+
+	// results generated against a different scene occlusion set are outdated
+	request->occluders = updateOccluders(request->shapeMeshes, keys, request->generateAttrs);
+	if (request->occluders.occlusionSet) {
+		for (GenerationCache::Key& key : keys)
+			key.occlusionEpoch = request->occluders.epoch;
+	}
+
+	request->results.reserve(keys.size());
+	for (const GenerationCache::Key& key : keys)
+		request->results.push_back(getCachedResult(key));
+
+	return request;
+}
+
+void PRTModifierAction::generateMissingShapes(const std::vector<GenerationRequest*>& requests) {
+	// shapes can only share a prt::generate call if they use the same encoder options and occlusion set
+	using GroupKey = std::pair<uint64_t, const prt::OcclusionSet*>;
+	struct MissingShape {
+		GenerationRequest* request;
+		size_t index;
+	};
+	std::map<GroupKey, std::vector<MissingShape>> missingShapeGroups;
+	for (GenerationRequest* request : requests) {
+		for (size_t i = 0; i < request->keys.size(); i++) {
+			if (request->results[i])
+				continue;
+			const GroupKey groupKey(request->keys[i].encoderHash, request->occluders.occlusionSet.get());
+			missingShapeGroups[groupKey].push_back({request, i});
+			request->missCount++;
+		}
+	}
+
+	if (DBG) {
+		size_t numShapes = 0;
+		size_t numMissing = 0;
+		for (const GenerationRequest* request : requests)
+			numShapes += request->keys.size();
+		for (const auto& g : missingShapeGroups)
+			numMissing += g.second.size();
+		LOG_DBG << "generation cache: " << numShapes - numMissing << " hits, " << numMissing << " misses in "
+		        << requests.size() << " requests";
+	}
+
+	if (missingShapeGroups.empty())
+		return;
+
+	// the calling thread waits for PRT anyway, on the main thread it meanwhile watches for the user pressing Esc.
+	// Stale generations are not cancelled otherwise: maya evaluates synchronously, so a newer compute of the same node
+	// (e.g. the next step of a slider drag) only starts once this one returned. Worker threads generate directly.
+	std::atomic<bool> cancelled(false);
+	std::unique_ptr<MComputation> computation;
+	std::function<bool()> interruptRequested;
+	if (mu::isMainThread()) {
+		computation = std::make_unique<MComputation>();
+		computation->beginComputation(false, true, false);
+		interruptRequested = [&computation]() { return computation->isInterruptRequested(); };
+	}
+
+	for (const auto& g : missingShapeGroups) {
+		if (cancelled)
+			break;
+
+		const std::vector<MissingShape>& missingShapes = g.second;
+		const GenerationRequest& firstRequest = *missingShapes.front().request;
+		const prt::OcclusionSet* occlusionSet = g.first.second;
+
+		std::vector<GenerationRequest*> groupRequests;
+		for (const MissingShape& ms : missingShapes) {
+			if (groupRequests.empty() || groupRequests.back() != ms.request)
+				groupRequests.push_back(ms.request);
+		}
+		MayaCallbacks outputHandler(missingShapes.size(), [&cancelled]() { return cancelled.load(); });
+
+		InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+		std::vector<InitialShapeUPtr> shapes;
+		std::vector<prt::OcclusionSet::Handle> occlusionHandles;
+		shapes.reserve(missingShapes.size());
+		for (const MissingShape& ms : missingShapes) {
+			const PRTMesh& shapeMesh = *ms.request->shapeMeshes[ms.index];
+			const GenerationCache::Key& key = ms.request->keys[ms.index];
+			const prt::Status setGeoStatus =
+			        isb->setGeometry(shapeMesh.vertexCoords(), shapeMesh.vcCount(), shapeMesh.indices(),
+			                         shapeMesh.indicesCount(), shapeMesh.faceCounts(), shapeMesh.faceCountsCount());
+			if (setGeoStatus != prt::STATUS_OK)
+				LOG_ERR << "InitialShapeBuilder setGeometry failed status = "
+				        << prt::getStatusDescription(setGeoStatus);
+
+			isb->setAttributes(key.ruleFile.c_str(), key.startRule.c_str(), key.seed, L"",
+			                   ms.request->generateAttrs, ms.request->resolveMap.get());
+
+			shapes.emplace_back(isb->createInitialShapeAndReset());
+			if (occlusionSet != nullptr)
+				occlusionHandles.push_back(ms.request->occluders.handles[ms.index]);
+		}
+
+		const std::vector<const wchar_t*> encIDs = {ENC_ID_MAYA, ENC_ID_CGA_ERROR, ENC_ID_CGA_PRINT};
+		const AttributeMapNOPtrVector encOpts = {firstRequest.mayaEncOpts, firstRequest.cgaErrorOpts,
+		                                         firstRequest.cgaPrintOpts};
+		assert(encIDs.size() == encOpts.size());
+
+		const InitialShapeNOPtrVector shapePtrs = prtu::toPtrVec(shapes);
+		const auto generateStart = std::chrono::steady_clock::now();
+		auto generate = [&]() {
+			return prt::generate(shapePtrs.data(), shapePtrs.size(),
+			                     (occlusionSet != nullptr) ? occlusionHandles.data() : nullptr, encIDs.data(),
+			                     encIDs.size(), encOpts.data(), &outputHandler, PRTContext::get().theCache.get(),
+			                     occlusionSet);
+		};
+		const prt::Status generateStatus = generateInterruptible(generate, interruptRequested, cancelled);
+		const std::chrono::duration<double, std::milli> generateTime = std::chrono::steady_clock::now() - generateStart;
+		for (GenerationRequest* request : groupRequests)
+			request->generateMs += generateTime.count();
+
+		// results of a cancelled generation may be incomplete, they are not cached
+		if (cancelled)
+			LOG_WRN << "generation of " << missingShapes.size() << " shapes interrupted";
+		else if (generateStatus != prt::STATUS_OK)
+			LOG_ERR << "prt generate failed: " << prt::getStatusDescription(generateStatus);
+
+		for (size_t si = 0; si < missingShapes.size(); si++) {
+			const MissingShape& ms = missingShapes[si];
+			GenerationResultSPtr& result = ms.request->results[ms.index];
+			result = outputHandler.takeResult(si);
+			ms.request->encodeMs += outputHandler.getAddMeshTime(si);
+			if (result && generateStatus == prt::STATUS_OK && !cancelled)
+				putCachedResult(ms.request->keys[ms.index], result);
+		}
+	}
+
+	if (computation)
+		computation->endComputation();
+}
+
+std::wstring PRTModifierAction::getPreviewStartRule() const {
+	const std::wstring& startRule = mPreviewSettings.startRule;
+	if (startRule.empty())
+		return mStartRule;
+	if (startRule.find(L'$') != std::wstring::npos)
+		return startRule;
+	return mRuleStyle + L"$" + startRule;
+}
+
+AttributeMapUPtr PRTModifierAction::createPreviewAttributes() const {
+	AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::createFromAttributeMap(mGenerateAttrs.get()));
+
+	std::wstring lodAttribute = mPreviewSettings.lodAttribute;
+	if (!lodAttribute.empty()) {
+		if (lodAttribute.find(L'$') == std::wstring::npos)
+			lodAttribute = mRuleStyle + L"$" + lodAttribute;
+
+		const RuleAttribute* ruleAttr = mRuleAttributes.findByFqName(lodAttribute);
+		if (ruleAttr == nullptr) {
+			LOG_WRN << "preview LOD attribute " << lodAttribute << " not found in rule file " << mRuleFile;
+		}
+		else {
+			const std::wstring& value = mPreviewSettings.lodValue;
+			switch (ruleAttr->mType) {
+				case prt::AAT_BOOL:
+					amb->setBool(lodAttribute.c_str(), value == L"true" || value == L"1");
+					break;
+				case prt::AAT_FLOAT:
+					amb->setFloat(lodAttribute.c_str(), std::wcstod(value.c_str(), nullptr));
+					break;
+				case prt::AAT_STR:
+					amb->setString(lodAttribute.c_str(), value.c_str());
+					break;
+				default:
+					LOG_WRN << "cannot use attribute of type " << ruleAttr->mType << " as preview LOD attribute";
+			}
+		}
+	}
+
+	return AttributeMapUPtr(amb->createAttributeMap());
+}
+
+OcclusionManager::Occluders PRTModifierAction::updateOccluders(const std::vector<const PRTMesh*>& shapeMeshes,
+                                                               const std::vector<GenerationCache::Key>& keys,
+                                                               const prt::AttributeMap* generateAttrs) {
+	OcclusionManager& occlusionManager = *PRTContext::get().mOcclusionManager;
+	if (!mSceneOcclusion || keys.empty()) {
+		occlusionManager.removeInput(this);
+		return {};
+	}
+
+	// the keys cover everything which affects the occluders of our shapes
+	uint64_t inputHash = 0;
+	for (const GenerationCache::Key& key : keys)
+		inputHash = prtu::hashCombine(inputHash, GenerationCache::KeyHash()(key));
+
+	// the shared occlusion set is not rebuilt here but on idle, see PRTModifierNode::updateSceneOcclusion()
+	if (!occlusionManager.hasInput(this, inputHash)) {
+		OcclusionManager::OccluderInput input;
+		input.inputHash = inputHash;
+		input.ruleFile = mRuleFile;
+		input.startRule = keys.front().startRule;
+		const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::createFromAttributeMap(generateAttrs));
+		input.attributes.reset(amb->createAttributeMap());
+		input.resolveMap = mResolveMap;
+		input.shapes.reserve(shapeMeshes.size());
+		for (size_t i = 0; i < shapeMeshes.size(); i++) {
+			const PRTMesh& mesh = *shapeMeshes[i];
+			OcclusionManager::OccluderShape shape;
+			shape.vertexCoords.assign(mesh.vertexCoords(), mesh.vertexCoords() + mesh.vcCount());
+			shape.indices.assign(mesh.indices(), mesh.indices() + mesh.indicesCount());
+			shape.faceCounts.assign(mesh.faceCounts(), mesh.faceCounts() + mesh.faceCountsCount());
+			shape.seed = keys[i].seed;
+			input.shapes.push_back(std::move(shape));
+		}
+		occlusionManager.setInput(this, std::move(input));
+	}
+
+	OcclusionManager::Occluders occluders = occlusionManager.getOccluders(this);
+	mOcclusionEpoch = occluders.epoch;
+	return occluders;
 }
 
-MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const prt::RuleFileInfo* info) {
+void PRTModifierAction::updatePreviewEncoderOptions() {
+	if (mPreviewEncOpts && mPreviewEncOptsMaxFaces == mPreviewSettings.maxFaces)
+		return;
+
+	// the preview geometry does not need materials, reports or attribute values
+	AttributeMapBuilderUPtr optionsBuilder(prt::AttributeMapBuilder::create());
+	optionsBuilder->setBool(EO_EMIT_ATTRIBUTES, false);
+	optionsBuilder->setBool(EO_EMIT_MATERIALS, false);
+	optionsBuilder->setBool(EO_EMIT_REPORTS, false);
+	optionsBuilder->setInt(EO_MAX_FACES, mPreviewSettings.maxFaces);
+	const AttributeMapUPtr previewOptions(optionsBuilder->createAttributeMap());
+
+	mPreviewEncOpts = prtu::createValidatedOptions(ENC_ID_MAYA, previewOptions.get());
+	mPreviewEncOptsHash = getEncoderHash(ENC_ID_MAYA, mPreviewEncOpts);
+	mPreviewEncOptsMaxFaces = mPreviewSettings.maxFaces;
+}
+
+MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj,
+                                                const prt::AttributeMap* defaultAttributeValues) {
 	MStatus stat;
 	MFnDependencyNode node(nodeObj, &stat);
 	MCHECK(stat);
 
-	for (const RuleAttribute& p : mRuleAttributes) {
+	for (const RuleAttribute& p : mRuleAttributes.getAttributes()) {
 		const std::wstring fqName = p.fqName;
 
 		// only use attributes of current style
@@ -370,62 +776,18 @@ MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const pr
 		if (style != mRuleStyle)
 			continue;
 
-		const prt::Attributable::PrimitiveType attrType = mGenerateAttrs->getType(fqName.c_str());
-
-		// TMP: detect attribute traits based on rule info / annotations
-		enum class AttributeTrait { ENUM, RANGE, FILE, DIR, COLOR, PLAIN };
-		struct AttributeTraitPayload { // intermediate representation of annotation data, poor man's std::variant
-			std::wstring mString;
-			const prt::Annotation* mAnnot = nullptr; // TODO: just while refactoring...
-		};
-
-		auto detectAttributeTrait =
-		        [&info](const std::wstring& key) -> std::pair<AttributeTrait, AttributeTraitPayload> {
-			for (size_t ai = 0, numAttrs = info->getNumAttributes(); ai < numAttrs; ai++) {
-				const auto* attr = info->getAttribute(ai);
-				if (std::wcscmp(key.c_str(), attr->getName()) != 0)
-					continue;
-
-				for (size_t a = 0; a < attr->getNumAnnotations(); a++) {
-					const prt::Annotation* an = attr->getAnnotation(a);
-					const wchar_t* anName = an->getName();
-					if (std::wcscmp(anName, ANNOT_ENUM) == 0)
-						return {AttributeTrait::ENUM, {{}, an}};
-					else if (std::wcscmp(anName, ANNOT_RANGE) == 0)
-						return {AttributeTrait::RANGE, {{}, an}};
-					else if (std::wcscmp(anName, ANNOT_COLOR) == 0)
-						return {AttributeTrait::COLOR, {}};
-					else if (std::wcscmp(anName, ANNOT_DIR) == 0) {
-						return {AttributeTrait::DIR, {}};
-					}
-					else if (std::wcscmp(anName, ANNOT_FILE) == 0) {
-						std::wstring exts;
-						for (size_t arg = 0; arg < an->getNumArguments(); arg++) {
-							if (an->getArgument(arg)->getType() == prt::AAT_STR) {
-								exts += an->getArgument(arg)->getStr();
-								exts += L" (*.";
-								exts += an->getArgument(arg)->getStr();
-								exts += L");";
-							}
-						}
-						exts += L"All Files (*.*)";
-						return {AttributeTrait::FILE, {exts, nullptr}};
-					}
-				}
-			}
-			return {AttributeTrait::PLAIN, {}};
-		};
+		const prt::Attributable::PrimitiveType attrType = defaultAttributeValues->getType(fqName.c_str());
 
-		auto attrTrait = detectAttributeTrait(fqName);
+		AttributeTrait attrTrait = p.trait;
 
 		MObject attr;
 
 		switch (attrType) {
 			case prt::Attributable::PT_BOOL: {
-				const bool value = mGenerateAttrs->getBool(fqName.c_str());
-				if (attrTrait.first == AttributeTrait::ENUM) {
+				const bool value = defaultAttributeValues->getBool(fqName.c_str());
+				if (attrTrait == AttributeTrait::ENUM) {
 					mEnums.emplace_front();
-					MCHECK(addEnumParameter(attrTrait.second.mAnnot, node, attr, p, value, mEnums.front()));
+					MCHECK(addEnumParameter(p.enumAnnotation, node, attr, p, value, mEnums.front()));
 				}
 				else {
 					MCHECK(addBoolParameter(node, attr, p, value));
@@ -433,33 +795,16 @@ MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const pr
 				break;
 			}
 			case prt::Attributable::PT_FLOAT: {
-				const double value = mGenerateAttrs->getFloat(fqName.c_str());
+				const double value = defaultAttributeValues->getFloat(fqName.c_str());
 
-				switch (attrTrait.first) {
+				switch (attrTrait) {
 					case AttributeTrait::ENUM: {
 						mEnums.emplace_front();
-						MCHECK(addEnumParameter(attrTrait.second.mAnnot, node, attr, p, value, mEnums.front()));
+						MCHECK(addEnumParameter(p.enumAnnotation, node, attr, p, value, mEnums.front()));
 						break;
 					}
 					case AttributeTrait::RANGE: {
-						auto tryParseRangeAnnotation = [](const prt::Annotation* an) -> std::pair<double, double> {
-							auto minMax = std::make_pair(std::numeric_limits<double>::quiet_NaN(),
-							                             std::numeric_limits<double>::quiet_NaN());
-							for (int argIdx = 0; argIdx < an->getNumArguments(); argIdx++) {
-								const prt::AnnotationArgument* arg = an->getArgument(argIdx);
-								const wchar_t* key = arg->getKey();
-								if (std::wcscmp(key, MIN_KEY) == 0) {
-									minMax.first = arg->getFloat();
-								}
-								else if (std::wcscmp(key, MAX_KEY) == 0) {
-									minMax.second = arg->getFloat();
-								}
-							}
-							return minMax;
-						};
-
-						std::pair<double, double> minMax = tryParseRangeAnnotation(attrTrait.second.mAnnot);
-						MCHECK(addFloatParameter(node, attr, p, value, minMax.first, minMax.second));
+						MCHECK(addFloatParameter(node, attr, p, value, p.rangeMin, p.rangeMax));
 						break;
 					}
 					case AttributeTrait::PLAIN: {
@@ -475,24 +820,24 @@ MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const pr
 				break;
 			}
 			case prt::Attributable::PT_STRING: {
-				const std::wstring value = mGenerateAttrs->getString(fqName.c_str());
+				const std::wstring value = defaultAttributeValues->getString(fqName.c_str());
 
 				// special case: detect color trait from value
-				if (attrTrait.first == AttributeTrait::PLAIN) {
+				if (attrTrait == AttributeTrait::PLAIN) {
 					if (value.length() == 7 && value[0] == L'#')
-						attrTrait.first = AttributeTrait::COLOR;
+						attrTrait = AttributeTrait::COLOR;
 				}
 
 				const MString mvalue(value.c_str());
 
-				switch (attrTrait.first) {
+				switch (attrTrait) {
 					case AttributeTrait::ENUM:
 						mEnums.emplace_front();
-						MCHECK(addEnumParameter(attrTrait.second.mAnnot, node, attr, p, mvalue, mEnums.front()));
+						MCHECK(addEnumParameter(p.enumAnnotation, node, attr, p, mvalue, mEnums.front()));
 						break;
 					case AttributeTrait::FILE:
 					case AttributeTrait::DIR:
-						MCHECK(addFileParameter(node, attr, p, mvalue, attrTrait.second.mString));
+						MCHECK(addFileParameter(node, attr, p, mvalue, p.fileFilter));
 						break;
 					case AttributeTrait::COLOR:
 						MCHECK(addColorParameter(node, attr, p, mvalue));
@@ -515,7 +860,7 @@ MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const pr
 			fnAttr.addToCategory(MString(p.ruleFile.c_str()));
 			fnAttr.addToCategory(MString(join<wchar_t>(p.groups, L" > ").c_str()));
 		}
-	} // for all mGenerateAttrs keys
+	} // for all rule attributes
 
 	removeUnusedAttribs(node);
 
@@ -524,13 +869,11 @@ MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const pr
 
 void PRTModifierAction::removeUnusedAttribs(MFnDependencyNode& node) {
 	auto isInUse = [this](const MString& attrName) {
-		auto it = std::find_if(mRuleAttributes.begin(), mRuleAttributes.end(),
-		                       [&attrName](const auto& ra) { return (ra.mayaFullName == attrName.asWChar()); });
-		return (it != mRuleAttributes.end());
+		return (mRuleAttributes.findByMayaFullName(attrName.asWChar()) != nullptr);
 	};
 
 	std::list<MObject> attrToRemove;
-	std::list<MObject> ignoreList;
+	std::unordered_set<std::wstring> ignoreList; // names of color child attributes
 
 	for (unsigned int i = 0; i < node.attributeCount(); i++) {
 		const MObject attrObj = node.attribute(i);
@@ -544,7 +887,7 @@ void PRTModifierAction::removeUnusedAttribs(MFnDependencyNode& node) {
 		if (attr.isUsedAsColor()) {
 			MFnCompoundAttribute compAttr(attrObj);
 			for (unsigned int ci = 0, numChildren = compAttr.numChildren(); ci < numChildren; ci++)
-				ignoreList.emplace_back(compAttr.child(ci));
+				ignoreList.emplace(MFnAttribute(compAttr.child(ci)).name().asWChar());
 		}
 
 		if (isInUse(attrName))
@@ -554,7 +897,7 @@ void PRTModifierAction::removeUnusedAttribs(MFnDependencyNode& node) {
 	}
 
 	for (auto& attr : attrToRemove) {
-		if (std::count(std::begin(ignoreList), std::end(ignoreList), attr) > 0)
+		if (ignoreList.count(MFnAttribute(attr).name().asWChar()) > 0)
 			continue;
 		node.removeAttribute(attr);
 	}
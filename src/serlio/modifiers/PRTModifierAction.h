@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include "modifiers/GenerationCache.h"
+#include "modifiers/OcclusionManager.h"
 #include "modifiers/PRTMesh.h"
 #include "modifiers/RuleAttributes.h"
 #include "modifiers/polyModifier/polyModifierFty.h"
@@ -29,6 +31,7 @@
 
 #include "prt/API.h"
 
+#include "maya/MDataBlock.h"
 #include "maya/MDoubleArray.h"
 #include "maya/MFnEnumAttribute.h"
 #include "maya/MIntArray.h"
@@ -39,6 +42,8 @@
 
 #include <list>
 #include <map>
+#include <memory>
+#include <vector>
 
 class PRTModifierAction;
 
@@ -64,21 +69,75 @@ class PRTModifierAction : public polyModifierFty {
 	friend class PRTModifierEnum;
 
 public:
+	// cheaper generation settings used while the user is interactively editing
+	struct PreviewSettings {
+		bool enabled = false;
+		int32_t maxFaces = 0;      // 0 means no limit
+		std::wstring startRule;    // optional, replaces the start rule of the rule file
+		std::wstring lodAttribute; // optional, rule attribute which is overridden with lodValue
+		std::wstring lodValue;
+	};
+
+	// measurements of the last doIt(), times in milliseconds
+	struct GenerationStats {
+		double generateMs = 0.0;  // prt::generate calls (shared by all nodes of a batch), 0 if everything was cached
+		double encodeMs = 0.0;    // conversion of the encoder output in MayaCallbacks::addMesh
+		double meshBuildMs = 0.0; // MayaMeshWriter
+		int32_t faceCount = 0;
+		int32_t vertexCount = 0;
+		int32_t materialCount = 0; // number of face ranges with a material
+		bool cacheHit = false;     // all initial shapes came from the generation cache
+	};
+
 	explicit PRTModifierAction();
+	~PRTModifierAction() override;
 
 	MStatus updateRuleFiles(const MObject& node, const MString& rulePkg);
-	MStatus fillAttributesFromNode(const MObject& node);
+	MStatus fillAttributesFromNode(const MObject& node, MDataBlock& data);
+
+	// looks up the resolve map of the rule package once, fillAttributesFromNode() and doIt() reuse it
+	void updateResolveMap();
 	void setMesh(MObject& _inMesh, MObject& _outMesh);
 	void setRandomSeed(int32_t randomSeed) {
 		mRandomSeed = randomSeed;
 	};
+	void setInitialShapePerFace(bool initialShapePerFace) {
+		mInitialShapePerFace = initialShapePerFace;
+	}
+	void setPreviewSettings(const PreviewSettings& previewSettings) {
+		mPreviewSettings = previewSettings;
+	}
+	void setSceneOcclusion(bool sceneOcclusion) {
+		mSceneOcclusion = sceneOcclusion;
+	}
+	bool usesSceneOcclusion() const {
+		return mSceneOcclusion;
+	}
+	uint64_t getOcclusionEpoch() const {
+		return mOcclusionEpoch;
+	}
+	const GenerationStats& getGenerationStats() const {
+		return mGenerationStats;
+	}
 
 	// polyModifierFty inherited methods
 	MStatus doIt() override;
 
+	// generates the current meshes of all actions with as few prt::generate calls as possible, the results are stored
+	// in the generation cache so a subsequent doIt() of each action only needs to write the mesh
+	static void generateBatch(const std::vector<PRTModifierAction*>& actions);
+
+	// same for the default rule attribute values needed by updateRuleFiles() and fillAttributesFromNode()
+	static void evaluateDefaultAttributesBatch(const std::vector<PRTModifierAction*>& actions);
+
 private:
 	// init in PRTModifierAction::PRTModifierAction()
-	AttributeMapUPtr mMayaEncOpts;
+	AttributeMapUPtr mMayaEncOpts; // rebuilt whenever the texture directory changes, see updateMayaEncoderOptions()
+	uint64_t mMayaEncOptsHash = 0;
+	std::wstring mTextureDirectory; // only used for rpks read without unpacking
+	AttributeMapUPtr mPreviewEncOpts; // rebuilt in doIt() whenever the preview face limit changes
+	uint64_t mPreviewEncOptsHash = 0;
+	int32_t mPreviewEncOptsMaxFaces = -1;
 	AttributeMapUPtr mCGAPrintOptions;
 	AttributeMapUPtr mCGAErrorOptions;
 
@@ -95,16 +154,55 @@ private:
 	std::wstring mStartRule;
 	const std::wstring mRuleStyle = L"Default"; // Serlio atm only supports the "Default" style
 	int32_t mRandomSeed = 0;
-	RuleAttributes mRuleAttributes; // TODO: could be cached together with ResolveMap
-
-	ResolveMapSPtr getResolveMap();
+	bool mInitialShapePerFace = false; // only regenerates the faces whose geometry changed
+	PreviewSettings mPreviewSettings;
+	bool mSceneOcclusion = false; // generate against the occluders of all serlio nodes in the scene
+	uint64_t mOcclusionEpoch = 0; // of the occluders used by the last doIt(), see OcclusionManager::Occluders
+	GenerationStats mGenerationStats;
+	GenerationStats mBatchGenerationStats; // timings of generateBatch(), reported by the next doIt()
+	bool mHasBatchGenerationStats = false;
+	RuleAttributeRegistry mRuleAttributes; // TODO: could be cached together with ResolveMap
+	ResolveMapSPtr mResolveMap;            // of mRulePkg, see updateResolveMap()
+	uint64_t mRPKFingerprint = 0;          // content of mRulePkg, identifies it in the generation cache keys
+	uint64_t mAssetLocation = 0;           // unpack directory of mResolveMap, see ResolveMapCache::getAssetLocation()
 
 	// init in fillAttributesFromNode()
 	AttributeMapUPtr mGenerateAttrs;
 
+	// the initial shapes of the current mesh, their generation cache keys and results (nullptr if not cached yet)
+	struct GenerationRequest {
+		std::vector<PRTMesh> faceMeshes; // owns the initial shapes in per face mode
+		std::vector<const PRTMesh*> shapeMeshes;
+		std::vector<GenerationCache::Key> keys;
+		std::vector<GenerationResultSPtr> results;
+		ResolveMapSPtr resolveMap;
+		AttributeMapUPtr previewAttrs;
+		const prt::AttributeMap* generateAttrs = nullptr;
+		const prt::AttributeMap* mayaEncOpts = nullptr;
+		const prt::AttributeMap* cgaErrorOpts = nullptr;
+		const prt::AttributeMap* cgaPrintOpts = nullptr;
+		OcclusionManager::Occluders occluders;
+		size_t missCount = 0; // initial shapes not found in the cache
+		double generateMs = 0.0;
+		double encodeMs = 0.0;
+	};
+	using GenerationRequestUPtr = std::unique_ptr<GenerationRequest>;
+
+	GenerationRequestUPtr prepareGeneration();
+	void updateGenerationStats(const GenerationRequest& request, double meshBuildMs);
+	static void generateMissingShapes(const std::vector<GenerationRequest*>& requests);
+
+	std::wstring getPreviewStartRule() const;
+	AttributeMapUPtr createPreviewAttributes() const;
+	void updatePreviewEncoderOptions();
+	void updateMayaEncoderOptions();
+	OcclusionManager::Occluders updateOccluders(const std::vector<const PRTMesh*>& shapeMeshes,
+	                                            const std::vector<GenerationCache::Key>& keys,
+	                                            const prt::AttributeMap* generateAttrs);
+
 	std::list<PRTModifierEnum> mEnums;
 	//	std::map<std::wstring, std::wstring> mBriefName2prtAttr;
-	MStatus createNodeAttributes(const MObject& node, const prt::RuleFileInfo* info);
+	MStatus createNodeAttributes(const MObject& node, const prt::AttributeMap* defaultAttributeValues);
 	void removeUnusedAttribs(MFnDependencyNode& node);
 
 	static MStatus addParameter(MFnDependencyNode& node, MObject& attr, MFnAttribute& tAttr);
@@ -28,6 +28,19 @@
 #include "maya/MGlobal.h"
 #include "maya/MItSelectionList.h"
 
+#include <algorithm>
+
+namespace {
+
+int32_t computeInitialSeed(const MDagPath& meshPath) {
+	MFnMesh meshFn(meshPath);
+	MFloatPointArray vertices;
+	MCHECK(meshFn.getPoints(vertices, MSpace::kWorld));
+	return mu::computeSeed(vertices);
+}
+
+} // namespace
+
 bool PRTModifierCommand::isUndoable() const {
 	return true;
 }
@@ -51,47 +64,46 @@ MStatus PRTModifierCommand::doIt(const MArgList& argList) {
 	MItSelectionList selListIter(selList);
 	selListIter.setFilter(MFn::kMesh);
 
-	bool found = false;
-	bool foundMultiple = false;
-
+	std::vector<MDagPath> meshPaths;
 	for (; !selListIter.isDone(); selListIter.next()) {
 		MDagPath dagPath;
 		MObject component;
 		selListIter.getDagPath(dagPath, component);
 
-		if (!found) {
-			// Ensure that this DAG path will point to the shape
-			// of our object. Set the DAG path for the polyModifierCmd.
-			if ((dagPath.extendToShape() == MStatus::kSuccess) ||
-			    (dagPath.extendToShapeDirectlyBelow(0) == MStatus::kSuccess)) {
-				setMeshNode(dagPath);
-				found = true;
-			}
+		// Ensure that this DAG path will point to the shape of our object.
+		if ((dagPath.extendToShape() == MStatus::kSuccess) ||
+		    (dagPath.extendToShapeDirectlyBelow(0) == MStatus::kSuccess)) {
+			// e.g. transform and shape of the same object are selected
+			if (std::find(meshPaths.begin(), meshPaths.end(), dagPath) == meshPaths.end())
+				meshPaths.push_back(dagPath);
 		}
-		else {
-			foundMultiple = true;
-			break;
-		}
-	}
-	if (foundMultiple) {
-		displayWarning("Found more than one object with selected components.");
-		displayWarning("Only operating on first found object.");
 	}
 
-	// Initialize the polyModifierCmd node type - mesh node already set
-	//
-	setModifierNodeType(PRTModifierNode::id);
-
-	if (found) {
-		MFnMesh meshFn(getMeshNode());
+	if (!meshPaths.empty()) {
+		// Initialize the polyModifierCmd node type and mesh node for all meshes
+		mMeshCommands.clear();
+		for (size_t i = 0; i < meshPaths.size(); i++) {
+			PRTModifierCommand* cmd = this;
+			if (i > 0) {
+				mMeshCommands.emplace_back(new PRTModifierCommand());
+				cmd = mMeshCommands.back().get();
+				cmd->mRulePkg = mRulePkg;
+			}
+			cmd->setMeshNode(meshPaths[i]);
+			cmd->setModifierNodeType(PRTModifierNode::id);
+			cmd->mInitialSeed = computeInitialSeed(meshPaths[i]);
+		}
 
-		MFloatPointArray vertices;
-		MCHECK(meshFn.getPoints(vertices, MSpace::kWorld));
-		mInitialSeed = mu::computeSeed(vertices);
+		generateInitialShapes();
 
 		// Now, pass control over to the polyModifierCmd::doModifyPoly() method
 		// to handle the operation.
 		status = doModifyPoly();
+		for (const auto& cmd : mMeshCommands) {
+			if (status != MS::kSuccess)
+				break;
+			status = cmd->doModifyPoly();
+		}
 
 		if (status == MS::kSuccess) {
 			setResult("PRT command succeeded!");
@@ -111,6 +123,11 @@ MStatus PRTModifierCommand::doIt(const MArgList& argList) {
 MStatus PRTModifierCommand::redoIt() {
 	MStatus status;
 	status = redoModifyPoly();
+	for (const auto& cmd : mMeshCommands) {
+		if (status != MS::kSuccess)
+			break;
+		status = cmd->redoModifyPoly();
+	}
 
 	if (status == MS::kSuccess) {
 		setResult("PRT command succeeded!");
@@ -124,6 +141,8 @@ MStatus PRTModifierCommand::redoIt() {
 
 MStatus PRTModifierCommand::undoIt() {
 	MStatus status;
+	for (auto it = mMeshCommands.rbegin(); it != mMeshCommands.rend(); ++it)
+		MCHECK((*it)->undoModifyPoly());
 	status = undoModifyPoly();
 	if (status == MS::kSuccess) {
 		setResult("PRT undo succeeded!");
@@ -134,6 +153,29 @@ MStatus PRTModifierCommand::undoIt() {
 	return status;
 }
 
+// all meshes are generated together before the modifier nodes are created, so their first compute is a cache hit
+void PRTModifierCommand::generateInitialShapes() {
+	std::vector<PRTModifierCommand*> commands = {this};
+	for (const auto& cmd : mMeshCommands)
+		commands.push_back(cmd.get());
+
+	std::vector<std::unique_ptr<PRTModifierAction>> actions;
+	std::vector<PRTModifierAction*> actionPtrs;
+	for (PRTModifierCommand* cmd : commands) {
+		MObject mesh = cmd->getMeshNode().node();
+		actions.emplace_back(new PRTModifierAction());
+		PRTModifierAction& action = *actions.back();
+		action.setMesh(mesh, mesh);
+		action.setRandomSeed(cmd->mInitialSeed);
+		if (action.updateRuleFiles(MObject::kNullObj, mRulePkg) != MS::kSuccess)
+			return;
+		actionPtrs.push_back(&action);
+	}
+
+	PRTModifierAction::evaluateDefaultAttributesBatch(actionPtrs);
+	PRTModifierAction::generateBatch(actionPtrs);
+}
+
 MStatus PRTModifierCommand::initModifierNode(MObject modifierNode) {
 	MStatus status;
 	MFnDependencyNode depNodeFn(modifierNode);
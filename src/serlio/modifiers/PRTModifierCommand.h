@@ -23,6 +23,9 @@
 
 #include "PRTContext.h"
 
+#include <memory>
+#include <vector>
+
 // based on the splitUVCommand and meshOpCommand Maya example .
 class PRTModifierCommand : public polyModifierCmd {
 public:
@@ -36,6 +39,11 @@ public:
 	MStatus directModifier(MObject mesh) override;
 
 private:
+	void generateInitialShapes();
+
 	MString mRulePkg;
 	int32_t mInitialSeed = 0;
+
+	// polyModifierCmd handles a single mesh, this command handles the first selected mesh and delegates the others
+	std::vector<std::unique_ptr<PRTModifierCommand>> mMeshCommands;
 };
@@ -18,16 +18,26 @@
  */
 
 #include "modifiers/PRTModifierNode.h"
+#include "modifiers/MayaCallbacks.h"
 
+#include "utils/MItDependencyNodesWrapper.h"
 #include "utils/MayaUtilities.h"
 
 #include "serlioPlugin.h"
 
 #include "maya/MDataHandle.h"
+#include "maya/MFnDependencyNode.h"
 #include "maya/MFnMeshData.h"
 #include "maya/MFnNumericAttribute.h"
 #include "maya/MFnStringData.h"
 #include "maya/MFnTypedAttribute.h"
+#include "maya/MDGMessage.h"
+#include "maya/MGlobal.h"
+#include "maya/MItDependencyNodes.h"
+#include "maya/MPlug.h"
+#include "maya/MRenderUtil.h"
+
+#include <memory>
 
 #define MCheckStatus(status, message)                                                                                  \
 	if (MStatus::kSuccess != (status)) {                                                                               \
@@ -36,8 +46,58 @@
 	}
 
 namespace {
+
+constexpr bool DBG = false;
+
 const MString NAME_RULE_PKG = "Rule_Package";
 const MString NAME_RANDOM_SEED = "Random_Seed";
+const MString NAME_INITIAL_SHAPE_PER_FACE = "Initial_Shape_Per_Face";
+const MString NAME_PREVIEW = "Preview";
+const MString NAME_PREVIEW_MAX_FACES = "Preview_Max_Faces";
+const MString NAME_PREVIEW_START_RULE = "Preview_Start_Rule";
+const MString NAME_PREVIEW_LOD_ATTRIBUTE = "Preview_LOD_Attribute";
+const MString NAME_PREVIEW_LOD_VALUE = "Preview_LOD_Value";
+const MString NAME_SCENE_OCCLUSION = "Scene_Occlusion";
+const MString NAME_LAST_GENERATE_MS = "Last_Generate_Ms";
+const MString NAME_LAST_ENCODE_MS = "Last_Encode_Ms";
+const MString NAME_LAST_MESH_BUILD_MS = "Last_Mesh_Build_Ms";
+const MString NAME_OUTPUT_FACE_COUNT = "Output_Face_Count";
+const MString NAME_OUTPUT_VERTEX_COUNT = "Output_Vertex_Count";
+const MString NAME_MATERIAL_COUNT = "Material_Count";
+const MString NAME_CACHE_HIT = "Cache_Hit";
+
+constexpr int PREVIEW_MAX_FACES_DEFAULT = 10000;
+
+MObject createStringAttribute(const MString& name, const MString& briefName, const MString& niceName) {
+	MStatus stat;
+	MFnStringData stringData;
+	MFnTypedAttribute fAttr;
+	MObject attr = fAttr.create(name, briefName, MFnData::kString, stringData.create(&stat), &stat);
+	MCHECK(stat);
+	MCHECK(fAttr.setCached(true));
+	MCHECK(fAttr.setStorable(true));
+	MCHECK(fAttr.setNiceNameOverride(niceName));
+	return attr;
+}
+
+MObject createStatisticsAttribute(const MString& name, const MString& briefName, const MString& niceName,
+                                  MFnNumericData::Type type) {
+	MStatus stat;
+	MFnNumericAttribute nAttr;
+	MObject attr = nAttr.create(name, briefName, type, 0, &stat);
+	MCHECK(stat);
+	MCHECK(nAttr.setStorable(false));
+	MCHECK(nAttr.setWritable(false));
+	MCHECK(nAttr.setNiceNameOverride(niceName));
+	return attr;
+}
+
+template <typename T>
+void setOutputValue(MDataBlock& data, const MObject& attr, T value) {
+	MDataHandle handle = data.outputValue(attr);
+	handle.set(value);
+	handle.setClean();
+}
 } // namespace
 
 // Unique Node TypeId
@@ -45,6 +105,51 @@ MTypeId PRTModifierNode::id(SerlioNodeIDs::SERLIO_PREFIX, SerlioNodeIDs::PRT_GEO
 MObject PRTModifierNode::rulePkg;
 MObject PRTModifierNode::currentRulePkg;
 MObject PRTModifierNode::mRandomSeed;
+MObject PRTModifierNode::mInitialShapePerFace;
+MObject PRTModifierNode::mPreview;
+MObject PRTModifierNode::mPreviewMaxFaces;
+MObject PRTModifierNode::mPreviewStartRule;
+MObject PRTModifierNode::mPreviewLODAttribute;
+MObject PRTModifierNode::mPreviewLODValue;
+MObject PRTModifierNode::mSceneOcclusion;
+MObject PRTModifierNode::mLastGenerateMs;
+MObject PRTModifierNode::mLastEncodeMs;
+MObject PRTModifierNode::mLastMeshBuildMs;
+MObject PRTModifierNode::mOutputFaceCount;
+MObject PRTModifierNode::mOutputVertexCount;
+MObject PRTModifierNode::mMaterialCount;
+MObject PRTModifierNode::mCacheHit;
+std::atomic<bool> PRTModifierNode::sForceFullQuality{false};
+std::atomic<bool> PRTModifierNode::sSceneOcclusionUpdateScheduled{false};
+MCallbackId PRTModifierNode::sNodeAddedCallbackId = 0;
+std::vector<MObjectHandle> PRTModifierNode::sSceneLoadNodes;
+
+PRTModifierNode::~PRTModifierNode() {
+	if (mAttributeChangedCallbackId != 0)
+		MMessage::removeCallback(mAttributeChangedCallbackId);
+}
+
+void PRTModifierNode::postConstructor() {
+	MObject node = thisMObject();
+	MStatus status;
+	mAttributeChangedCallbackId = MNodeMessage::addAttributeChangedCallback(node, attributeChanged, this, &status);
+	MCHECK(status);
+}
+
+// start unpacking a newly set rule package right away instead of waiting for the next compute
+void PRTModifierNode::attributeChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& /*otherPlug*/,
+                                       void* /*clientData*/) {
+	if ((msg & MNodeMessage::kAttributeSet) == 0 || plug.attribute() != rulePkg)
+		return;
+
+	const MString rulePkgPath = plug.asString();
+	if (rulePkgPath.length() == 0)
+		return;
+
+	if (DBG)
+		LOG_DBG << "rule package changed to " << rulePkgPath.asWChar() << ", starting prefetch";
+	PRTContext::get().mResolveMapCache->prefetch(rulePkgPath.asWChar());
+}
 
 // make sure the dynamically added plugs affect the outMesh
 MStatus PRTModifierNode::setDependentsDirty(const MPlug& /*plugBeingDirtied*/, MPlugArray& affectedPlugs) {
@@ -67,7 +172,9 @@ MStatus PRTModifierNode::compute(const MPlug& plug, MDataBlock& data) {
 	// (0 = Normal)
 	// (1 = HasNoEffect/PassThrough)
 	// (2 = Blocking)
-	if (stateData.asShort() == 1) {
+	//
+	// Nodes created while a scene is loaded pass the mesh through as well, endSceneLoad() then generates them together
+	if (stateData.asShort() == 1 || mSceneLoadPending) {
 		MDataHandle inputData = data.inputValue(inMesh, &status);
 		MCheckStatus(status, "ERROR getting inMesh");
 
@@ -88,12 +195,6 @@ MStatus PRTModifierNode::compute(const MPlug& plug, MDataBlock& data) {
 			MDataHandle outputData = data.outputValue(outMesh, &status);
 			MCheckStatus(status, "ERROR getting outMesh");
 
-			MDataHandle rulePkgData = data.inputValue(rulePkg, &status);
-			MCheckStatus(status, "ERROR getting rulePkg");
-
-			MDataHandle currentRulePkgData = data.inputValue(currentRulePkg, &status);
-			MCheckStatus(status, "ERROR getting currentRulePkg");
-
 			// Copy the inMesh to the outMesh, so you can
 			// perform operations directly on outMesh
 			//
@@ -102,23 +203,40 @@ MStatus PRTModifierNode::compute(const MPlug& plug, MDataBlock& data) {
 			MObject oMesh = outputData.asMesh();
 
 			// Set the mesh object and component List on the factory
-			fPRTModifierAction.setMesh(iMesh, oMesh);
+			status = updateActionMesh(data, iMesh, oMesh);
+			if (status != MStatus::kSuccess)
+				return status;
 
-			if (rulePkgData.asString() != currentRulePkgData.asString()) {
-				fPRTModifierAction.updateRuleFiles(thisMObject(), rulePkgData.asString());
+			// the mesh is passed through until the rule package has been loaded on the main thread
+			if (mRuleFilesUpdateScheduled) {
+				outputData.setClean();
+				return MS::kSuccess;
 			}
 
-			status = fPRTModifierAction.fillAttributesFromNode(thisMObject());
+			// while regenerate() collects the inputs of all nodes, the mesh is passed through as well
+			const RegenerateStep regenerateStep = mRegenerateStep;
+			if (regenerateStep == RegenerateStep::READ_MESH) {
+				mRegenerateStepDone = true;
+				outputData.setClean();
+				return MS::kSuccess;
+			}
+
+			status = updateActionAttributes(data);
 			if (status != MStatus::kSuccess)
 				return status;
 
-			MDataHandle randomSeed = data.inputValue(mRandomSeed, &status);
-			fPRTModifierAction.setRandomSeed(randomSeed.asInt());
+			if (regenerateStep == RegenerateStep::READ_ATTRIBUTES) {
+				mRegenerateStepDone = true;
+				outputData.setClean();
+				return MS::kSuccess;
+			}
 
 			// Now, perform the PRT
 			status = fPRTModifierAction.doIt();
+			updateStatisticsAttributes(data);
 
-			currentRulePkgData.setString(rulePkgData.asString());
+			// also needed if scene occlusion was just disabled, the occluders of this node need to be removed
+			scheduleSceneOcclusionUpdate();
 
 			// Mark the output mesh as clean
 			outputData.setClean();
@@ -131,6 +249,254 @@ MStatus PRTModifierNode::compute(const MPlug& plug, MDataBlock& data) {
 	return status;
 }
 
+// the node inputs are transferred to the action in two steps, so batched regeneration can evaluate the default rule
+// attribute values of all nodes in between
+MStatus PRTModifierNode::updateActionMesh(MDataBlock& data, MObject& iMesh, MObject& oMesh) {
+	MStatus status;
+	MDataHandle rulePkgData = data.inputValue(rulePkg, &status);
+	MCheckStatus(status, "ERROR getting rulePkg");
+
+	MDataHandle currentRulePkgData = data.inputValue(currentRulePkg, &status);
+	MCheckStatus(status, "ERROR getting currentRulePkg");
+
+	fPRTModifierAction.setMesh(iMesh, oMesh);
+
+	MDataHandle randomSeed = data.inputValue(mRandomSeed, &status);
+	fPRTModifierAction.setRandomSeed(randomSeed.asInt());
+
+	if (rulePkgData.asString() != currentRulePkgData.asString()) {
+		// loading a rule package adds and removes dynamic attributes, which is not allowed during parallel evaluation
+		if (!mu::isMainThread()) {
+			scheduleRuleFilesUpdate();
+			return MStatus::kSuccess;
+		}
+		fPRTModifierAction.updateRuleFiles(thisMObject(), rulePkgData.asString());
+		mRuleFilesUpdateScheduled = false;
+	}
+	else
+		fPRTModifierAction.updateResolveMap();
+
+	return MStatus::kSuccess;
+}
+
+MStatus PRTModifierNode::updateActionAttributes(MDataBlock& data) {
+	MStatus status = fPRTModifierAction.fillAttributesFromNode(thisMObject(), data);
+	if (status != MStatus::kSuccess)
+		return status;
+
+	// only remember the rule package once its attributes are in place, otherwise it is reloaded on the next compute
+	data.inputValue(currentRulePkg).setString(data.inputValue(rulePkg).asString());
+
+	MDataHandle initialShapePerFace = data.inputValue(mInitialShapePerFace, &status);
+	fPRTModifierAction.setInitialShapePerFace(initialShapePerFace.asBool());
+
+	PRTModifierAction::PreviewSettings previewSettings;
+	previewSettings.enabled = isPreviewActive(data);
+	if (previewSettings.enabled) {
+		previewSettings.maxFaces = data.inputValue(mPreviewMaxFaces).asInt();
+		previewSettings.startRule = data.inputValue(mPreviewStartRule).asString().asWChar();
+		previewSettings.lodAttribute = data.inputValue(mPreviewLODAttribute).asString().asWChar();
+		previewSettings.lodValue = data.inputValue(mPreviewLODValue).asString().asWChar();
+	}
+	fPRTModifierAction.setPreviewSettings(previewSettings);
+
+	MDataHandle sceneOcclusion = data.inputValue(mSceneOcclusion, &status);
+	fPRTModifierAction.setSceneOcclusion(sceneOcclusion.asBool());
+
+	return MStatus::kSuccess;
+}
+
+// the statistics do not depend on any input, i.e. they are never dirty and getAttr returns the last written values
+void PRTModifierNode::updateStatisticsAttributes(MDataBlock& data) {
+	const PRTModifierAction::GenerationStats& stats = fPRTModifierAction.getGenerationStats();
+	setOutputValue(data, mLastGenerateMs, stats.generateMs);
+	setOutputValue(data, mLastEncodeMs, stats.encodeMs);
+	setOutputValue(data, mLastMeshBuildMs, stats.meshBuildMs);
+	setOutputValue(data, mOutputFaceCount, stats.faceCount);
+	setOutputValue(data, mOutputVertexCount, stats.vertexCount);
+	setOutputValue(data, mMaterialCount, stats.materialCount);
+	setOutputValue(data, mCacheHit, stats.cacheHit);
+}
+
+void PRTModifierNode::scheduleRuleFilesUpdate() {
+	if (mRuleFilesUpdateScheduled.exchange(true))
+		return;
+	MGlobal::executeTaskOnIdle(updateRuleFilesOnIdle, new MObjectHandle(thisMObject()));
+}
+
+// runs on the main thread while no evaluation is in progress
+void PRTModifierNode::updateRuleFilesOnIdle(void* nodeHandle) {
+	const std::unique_ptr<MObjectHandle> handle(static_cast<MObjectHandle*>(nodeHandle));
+	if (!handle->isValid())
+		return;
+
+	const MObject nodeObj = handle->object();
+	const MFnDependencyNode node(nodeObj);
+	auto* modifierNode = static_cast<PRTModifierNode*>(node.userNode());
+
+	// e.g. regenerate() might have loaded the rule package in the meantime
+	if (!modifierNode->mRuleFilesUpdateScheduled)
+		return;
+
+	const MString rulePkgPath = MPlug(nodeObj, rulePkg).asString();
+	const MStatus status = modifierNode->fPRTModifierAction.updateRuleFiles(nodeObj, rulePkgPath);
+	modifierNode->mRuleFilesUpdateScheduled = false;
+
+	// on failure the mesh stays passed through until the node is evaluated again
+	if (status == MS::kSuccess) {
+		MCHECK(MPlug(nodeObj, currentRulePkg).setValue(rulePkgPath));
+		MCHECK(MGlobal::executeCommand("dgdirty " + node.name()));
+	}
+}
+
+void PRTModifierNode::beginSceneLoad() {
+	if (sNodeAddedCallbackId != 0)
+		return;
+
+	MStatus status;
+	sNodeAddedCallbackId = MDGMessage::addNodeAddedCallback(nodeAddedDuringSceneLoad, "dependNode", nullptr, &status);
+	MCHECK(status);
+
+	// there is no end notification if opening or importing fails, the next idle is after loading in any case
+	MGlobal::executeTaskOnIdle([](void*) { endSceneLoad(); });
+}
+
+void PRTModifierNode::nodeAddedDuringSceneLoad(MObject& nodeObj, void* /*clientData*/) {
+	const MFnDependencyNode node(nodeObj);
+	if (node.typeId() != id)
+		return;
+	static_cast<PRTModifierNode*>(node.userNode())->mSceneLoadPending = true;
+	sSceneLoadNodes.emplace_back(nodeObj);
+}
+
+void PRTModifierNode::endSceneLoad() {
+	if (sNodeAddedCallbackId == 0)
+		return;
+	MCHECK(MMessage::removeCallback(sNodeAddedCallbackId));
+	sNodeAddedCallbackId = 0;
+
+	std::vector<MObject> nodes;
+	for (const MObjectHandle& handle : sSceneLoadNodes) {
+		if (!handle.isValid())
+			continue;
+		const MObject nodeObj = handle.object();
+		static_cast<PRTModifierNode*>(MFnDependencyNode(nodeObj).userNode())->mSceneLoadPending = false;
+		nodes.push_back(nodeObj);
+	}
+	sSceneLoadNodes.clear();
+
+	if (DBG)
+		LOG_DBG << "scene loaded, generating " << nodes.size() << " serlio nodes";
+	MCHECK(regenerate(nodes));
+}
+
+MStatus PRTModifierNode::regenerate(const std::vector<MObject>& nodes) {
+	std::vector<PRTModifierNode*> modifierNodes;
+	MString nodeNames;
+	for (const MObject& nodeObj : nodes) {
+		const MFnDependencyNode node(nodeObj);
+		if (node.typeId() != id)
+			continue;
+		modifierNodes.push_back(static_cast<PRTModifierNode*>(node.userNode()));
+		nodeNames += " " + node.name();
+	}
+	if (modifierNodes.empty())
+		return MStatus::kSuccess;
+
+	// node inputs may only be read inside compute, so each step dirties all nodes and pulls their output meshes.
+	// Returns the actions of the nodes which completed the step.
+	auto evaluate = [&modifierNodes, &nodeNames](RegenerateStep step) {
+		for (PRTModifierNode* modifierNode : modifierNodes) {
+			modifierNode->mRegenerateStep = step;
+			modifierNode->mRegenerateStepDone = false;
+		}
+		MCHECK(MGlobal::executeCommand("dgdirty" + nodeNames));
+
+		std::vector<PRTModifierAction*> actions;
+		for (PRTModifierNode* modifierNode : modifierNodes) {
+			MObject outMeshData;
+			MCHECK(MPlug(modifierNode->thisMObject(), outMesh).getValue(outMeshData));
+			if (modifierNode->mRegenerateStepDone)
+				actions.push_back(&modifierNode->fPRTModifierAction);
+		}
+		return actions;
+	};
+
+	PRTModifierAction::evaluateDefaultAttributesBatch(evaluate(RegenerateStep::READ_MESH));
+	PRTModifierAction::generateBatch(evaluate(RegenerateStep::READ_ATTRIBUTES));
+
+	// the nodes now only need to fetch their results from the generation cache
+	evaluate(RegenerateStep::NONE);
+
+	return MStatus::kSuccess;
+}
+
+// the cheaper preview configuration is only used while the user is interactively editing the scene,
+// batch sessions and renders always get the full quality geometry. Besides the render state reported by maya (which
+// misses most renderers), renders are detected by the maya software render callbacks and the serlioRenderQuality
+// command, which users of other renderers can call from their pre and post render scripts.
+bool PRTModifierNode::isPreviewActive(MDataBlock& data) const {
+	if (sForceFullQuality)
+		return false;
+	if (MGlobal::mayaState() != MGlobal::kInteractive)
+		return false;
+	if (MRenderUtil::mayaRenderState() != MRenderUtil::kNotRendering)
+		return false;
+	return data.inputValue(mPreview).asBool();
+}
+
+void PRTModifierNode::setForceFullQuality(bool forceFullQuality) {
+	if (sForceFullQuality.exchange(forceFullQuality) == forceFullQuality)
+		return;
+
+	// only nodes with enabled preview produce different geometry in full quality mode
+	MStatus status;
+	MItDependencyNodes nodeIt(MFn::kPluginDependNode, &status);
+	MCHECK(status);
+	MString dirtyNodes;
+	for (const auto& nodeObj : MItDependencyNodesWrapper(nodeIt)) {
+		const MFnDependencyNode node(nodeObj);
+		if (node.typeId() != id)
+			continue;
+		const MPlug previewPlug(nodeObj, mPreview);
+		if (previewPlug.asBool())
+			dirtyNodes += " " + node.name();
+	}
+	if (dirtyNodes.length() > 0)
+		MCHECK(MGlobal::executeCommand("dgdirty" + dirtyNodes));
+}
+
+// the occluders of all changed nodes are generated together, so we wait until the current evaluation is done
+void PRTModifierNode::scheduleSceneOcclusionUpdate() {
+	if (!PRTContext::get().mOcclusionManager->isDirty() || sSceneOcclusionUpdateScheduled.exchange(true))
+		return;
+	MGlobal::executeTaskOnIdle([](void*) { updateSceneOcclusion(); });
+}
+
+void PRTModifierNode::updateSceneOcclusion() {
+	sSceneOcclusionUpdateScheduled = false;
+
+	OcclusionManager& occlusionManager = *PRTContext::get().mOcclusionManager;
+	if (occlusionManager.isDirty()) {
+		// occluder generation does not run any encoder, i.e. there are no per shape results
+		MayaCallbacks callbacks(0);
+		occlusionManager.rebuild(&callbacks, PRTContext::get().theCache.get());
+	}
+
+	MStatus status;
+	MItDependencyNodes nodeIt(MFn::kPluginDependNode, &status);
+	MCHECK(status);
+	for (const auto& nodeObj : MItDependencyNodesWrapper(nodeIt)) {
+		const MFnDependencyNode node(nodeObj);
+		if (node.typeId() != id)
+			continue;
+		const auto* modifierNode = static_cast<const PRTModifierNode*>(node.userNode());
+		const PRTModifierAction& action = modifierNode->fPRTModifierAction;
+		if (action.usesSceneOcclusion() && action.getOcclusionEpoch() != occlusionManager.getEpoch(&action))
+			MCHECK(MGlobal::executeCommand("dgdirty " + node.name()));
+	}
+}
+
 MStatus PRTModifierNode::initialize()
 // Description:
 //  This method is called to create and initialize all of the attributes
@@ -143,6 +509,9 @@ MStatus PRTModifierNode::initialize()
 {
 	MStatus status;
 
+	// node types are registered on the main thread
+	mu::setMainThread();
+
 	MFnTypedAttribute attrFn;
 	MFnEnumAttribute enumFn;
 
@@ -192,6 +561,54 @@ MStatus PRTModifierNode::initialize()
 	MCHECK(addAttribute(mRandomSeed));
 	MCHECK(attributeAffects(mRandomSeed, outMesh));
 
+	mInitialShapePerFace =
+	        nAttr.create(NAME_INITIAL_SHAPE_PER_FACE, "initialShapePerFace", MFnNumericData::kBoolean, 0, &stat);
+	MCHECK(stat);
+	MCHECK(nAttr.setCached(true));
+	MCHECK(nAttr.setStorable(true));
+	MCHECK(nAttr.setNiceNameOverride(MString("Initial Shape per Face")));
+	MCHECK(addAttribute(mInitialShapePerFace));
+	MCHECK(attributeAffects(mInitialShapePerFace, outMesh));
+
+	mPreview = nAttr.create(NAME_PREVIEW, "preview", MFnNumericData::kBoolean, 0, &stat);
+	MCHECK(stat);
+	MCHECK(nAttr.setCached(true));
+	MCHECK(nAttr.setStorable(true));
+	MCHECK(nAttr.setNiceNameOverride(MString("Preview")));
+	MCHECK(addAttribute(mPreview));
+	MCHECK(attributeAffects(mPreview, outMesh));
+
+	mPreviewMaxFaces = nAttr.create(NAME_PREVIEW_MAX_FACES, "previewMaxFaces", MFnNumericData::kInt,
+	                                PREVIEW_MAX_FACES_DEFAULT, &stat);
+	MCHECK(stat);
+	MCHECK(nAttr.setMin(0));
+	MCHECK(nAttr.setCached(true));
+	MCHECK(nAttr.setStorable(true));
+	MCHECK(nAttr.setNiceNameOverride(MString("Preview Max Faces")));
+	MCHECK(addAttribute(mPreviewMaxFaces));
+	MCHECK(attributeAffects(mPreviewMaxFaces, outMesh));
+
+	mPreviewStartRule = createStringAttribute(NAME_PREVIEW_START_RULE, "previewStartRule", "Preview Start Rule");
+	MCHECK(addAttribute(mPreviewStartRule));
+	MCHECK(attributeAffects(mPreviewStartRule, outMesh));
+
+	mPreviewLODAttribute =
+	        createStringAttribute(NAME_PREVIEW_LOD_ATTRIBUTE, "previewLODAttribute", "Preview LOD Attribute");
+	MCHECK(addAttribute(mPreviewLODAttribute));
+	MCHECK(attributeAffects(mPreviewLODAttribute, outMesh));
+
+	mPreviewLODValue = createStringAttribute(NAME_PREVIEW_LOD_VALUE, "previewLODValue", "Preview LOD Value");
+	MCHECK(addAttribute(mPreviewLODValue));
+	MCHECK(attributeAffects(mPreviewLODValue, outMesh));
+
+	mSceneOcclusion = nAttr.create(NAME_SCENE_OCCLUSION, "sceneOcclusion", MFnNumericData::kBoolean, 0, &stat);
+	MCHECK(stat);
+	MCHECK(nAttr.setCached(true));
+	MCHECK(nAttr.setStorable(true));
+	MCHECK(nAttr.setNiceNameOverride(MString("Scene Occlusion")));
+	MCHECK(addAttribute(mSceneOcclusion));
+	MCHECK(attributeAffects(mSceneOcclusion, outMesh));
+
 	currentRulePkg = fAttr.create("current" + NAME_RULE_PKG, "currentRulePkg", MFnData::kString,
 	                              stringData.create(&stat2), &stat);
 	MCHECK(stat2);
@@ -202,6 +619,27 @@ MStatus PRTModifierNode::initialize()
 	MCHECK(fAttr.setConnectable(false));
 	MCHECK(addAttribute(currentRulePkg));
 
+	mLastGenerateMs = createStatisticsAttribute(NAME_LAST_GENERATE_MS, "lastGenerateMs", "Last Generate (ms)",
+	                                            MFnNumericData::kDouble);
+	MCHECK(addAttribute(mLastGenerateMs));
+	mLastEncodeMs =
+	        createStatisticsAttribute(NAME_LAST_ENCODE_MS, "lastEncodeMs", "Last Encode (ms)", MFnNumericData::kDouble);
+	MCHECK(addAttribute(mLastEncodeMs));
+	mLastMeshBuildMs = createStatisticsAttribute(NAME_LAST_MESH_BUILD_MS, "lastMeshBuildMs", "Last Mesh Build (ms)",
+	                                             MFnNumericData::kDouble);
+	MCHECK(addAttribute(mLastMeshBuildMs));
+	mOutputFaceCount = createStatisticsAttribute(NAME_OUTPUT_FACE_COUNT, "outputFaceCount", "Output Face Count",
+	                                             MFnNumericData::kInt);
+	MCHECK(addAttribute(mOutputFaceCount));
+	mOutputVertexCount = createStatisticsAttribute(NAME_OUTPUT_VERTEX_COUNT, "outputVertexCount",
+	                                               "Output Vertex Count", MFnNumericData::kInt);
+	MCHECK(addAttribute(mOutputVertexCount));
+	mMaterialCount =
+	        createStatisticsAttribute(NAME_MATERIAL_COUNT, "materialCount", "Material Count", MFnNumericData::kInt);
+	MCHECK(addAttribute(mMaterialCount));
+	mCacheHit = createStatisticsAttribute(NAME_CACHE_HIT, "cacheHit", "Cache Hit", MFnNumericData::kBoolean);
+	MCHECK(addAttribute(mCacheHit));
+
 	// Set up a dependency between the input and the output.  This will cause
 	// the output to be marked dirty when the input changes.  The output will
 	// then be recomputed the next time the value of the output is requested.
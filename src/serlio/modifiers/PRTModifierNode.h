@@ -24,23 +24,95 @@
 
 #include "PRTContext.h"
 
+#include "maya/MMessage.h"
+#include "maya/MNodeMessage.h"
 #include "maya/MObject.h"
+#include "maya/MObjectHandle.h"
 #include "maya/MStatus.h"
 #include "maya/MTypeId.h"
 
+#include <atomic>
+#include <vector>
+
 class PRTModifierNode : public polyModifierNode {
 public:
+	~PRTModifierNode() override;
+
+	void postConstructor() override;
 	MStatus compute(const MPlug& plug, MDataBlock& data) override;
 	MStatus setDependentsDirty(const MPlug& plugBeingDirtied, MPlugArray& affectedPlugs) override;
 
+	// compute only touches the state of its own node and the thread-safe caches of PRTContext, changes to the graph
+	// (i.e. loading a rule package) and scene-wide updates are deferred to the main thread
+	MPxNode::SchedulingType schedulingType() const noexcept override {
+		return SchedulingType::kParallel;
+	}
+
 	static MStatus initialize();
 
+	// forces full quality generation on all serlio nodes with enabled preview (e.g. while rendering)
+	static void setForceFullQuality(bool forceFullQuality);
+
+	// updates the shared occlusion set if needed and dirties the serlio nodes which saw outdated occluders of others
+	static void updateSceneOcclusion();
+
+	// generates the given serlio nodes with batched prt::generate calls and updates their output meshes
+	static MStatus regenerate(const std::vector<MObject>& nodes);
+
+	// suspends the evaluation of the serlio nodes created while a scene is opened or imported, then generates them in
+	// one batch. Ends on the next idle at the latest, e.g. if loading failed and there is no end notification.
+	static void beginSceneLoad();
+	static void endSceneLoad();
+
 public:
 	// non-dynamic node attributes
 	static MObject rulePkg;
 	static MObject currentRulePkg;
 	static MTypeId id;
 	static MObject mRandomSeed;
+	static MObject mInitialShapePerFace;
+	static MObject mPreview;
+	static MObject mPreviewMaxFaces;
+	static MObject mPreviewStartRule;
+	static MObject mPreviewLODAttribute;
+	static MObject mPreviewLODValue;
+	static MObject mSceneOcclusion;
+
+	// read-only statistics of the last generation
+	static MObject mLastGenerateMs;
+	static MObject mLastEncodeMs;
+	static MObject mLastMeshBuildMs;
+	static MObject mOutputFaceCount;
+	static MObject mOutputVertexCount;
+	static MObject mMaterialCount;
+	static MObject mCacheHit;
 
 	PRTModifierAction fPRTModifierAction;
+
+private:
+	MStatus updateActionMesh(MDataBlock& data, MObject& iMesh, MObject& oMesh);
+	MStatus updateActionAttributes(MDataBlock& data);
+	void updateStatisticsAttributes(MDataBlock& data);
+	bool isPreviewActive(MDataBlock& data) const;
+
+	static void attributeChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
+	static void nodeAddedDuringSceneLoad(MObject& node, void* clientData);
+
+	static void scheduleSceneOcclusionUpdate();
+	void scheduleRuleFilesUpdate();
+	static void updateRuleFilesOnIdle(void* nodeHandle);
+
+	static std::atomic<bool> sForceFullQuality;
+	static std::atomic<bool> sSceneOcclusionUpdateScheduled;
+	static MCallbackId sNodeAddedCallbackId; // only registered while a scene is loaded
+	static std::vector<MObjectHandle> sSceneLoadNodes;
+
+	MCallbackId mAttributeChangedCallbackId = 0;
+	std::atomic<bool> mRuleFilesUpdateScheduled{false};
+	std::atomic<bool> mSceneLoadPending{false};
+
+	// regenerate() reads the inputs of all nodes in separate compute calls before generating them together
+	enum class RegenerateStep { NONE, READ_MESH, READ_ATTRIBUTES };
+	std::atomic<RegenerateStep> mRegenerateStep{RegenerateStep::NONE};
+	bool mRegenerateStepDone = false;
 };
@@ -0,0 +1,58 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/PreloadCommand.h"
+
+#include "PRTContext.h"
+
+#include "utils/LogHandler.h"
+
+#include "maya/MArgDatabase.h"
+#include "maya/MStringArray.h"
+
+#include <string>
+#include <vector>
+
+MSyntax PreloadCommand::newSyntax() {
+	MSyntax syntax;
+	syntax.setObjectType(MSyntax::kStringObjects, 1);
+	return syntax;
+}
+
+MStatus PreloadCommand::doIt(const MArgList& args) {
+	MStatus status;
+	const MArgDatabase argData(syntax(), args, &status);
+	if (status != MS::kSuccess)
+		return status;
+
+	MStringArray rulePkgs;
+	status = argData.getObjects(rulePkgs);
+	if (status != MS::kSuccess)
+		return status;
+
+	std::vector<std::wstring> rpks;
+	for (unsigned int i = 0; i < rulePkgs.length(); i++)
+		rpks.emplace_back(rulePkgs[i].asWChar());
+
+	const size_t preloaded = PRTContext::get().preloadRulePackages(rpks);
+	LOG_INF << "preloaded " << preloaded << " of " << rpks.size() << " rule packages";
+
+	setResult(static_cast<int>(preloaded));
+	return MS::kSuccess;
+}
@@ -0,0 +1,35 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "maya/MArgList.h"
+#include "maya/MPxCommand.h"
+#include "maya/MStatus.h"
+#include "maya/MSyntax.h"
+
+constexpr const char* CMD_PRELOAD = "serlioPreload";
+
+// serlioPreload "a.rpk" "b.rpk" ...: unpacks the rule packages and reads their rules in parallel, e.g. at pipeline
+// startup, so the first assignment does not wait for it. Returns the number of rule packages preloaded successfully.
+class PreloadCommand : public MPxCommand {
+public:
+	static MSyntax newSyntax();
+	MStatus doIt(const MArgList& args) override;
+};
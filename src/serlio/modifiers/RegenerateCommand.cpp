@@ -0,0 +1,53 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/RegenerateCommand.h"
+#include "modifiers/PRTModifierNode.h"
+
+#include "utils/MItDependencyNodesWrapper.h"
+
+#include "maya/MFnDependencyNode.h"
+#include "maya/MGlobal.h"
+#include "maya/MItDependencyNodes.h"
+#include "maya/MItSelectionList.h"
+#include "maya/MSelectionList.h"
+
+#include <vector>
+
+MStatus RegenerateCommand::doIt(const MArgList&) {
+	std::vector<MObject> nodes;
+
+	MSelectionList selection;
+	MGlobal::getActiveSelectionList(selection);
+	for (MItSelectionList it(selection); !it.isDone(); it.next()) {
+		MObject node;
+		if (it.getDependNode(node) == MStatus::kSuccess && MFnDependencyNode(node).typeId() == PRTModifierNode::id)
+			nodes.push_back(node);
+	}
+
+	if (nodes.empty()) {
+		MItDependencyNodes nodeIt(MFn::kPluginDependNode);
+		for (const auto& node : MItDependencyNodesWrapper(nodeIt)) {
+			if (MFnDependencyNode(node).typeId() == PRTModifierNode::id)
+				nodes.push_back(node);
+		}
+	}
+
+	return PRTModifierNode::regenerate(nodes);
+}
@@ -0,0 +1,53 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/RenderQualityCommand.h"
+#include "modifiers/PRTModifierNode.h"
+
+#include "maya/MArgDatabase.h"
+
+namespace {
+
+constexpr const char* FLAG_BEGIN_RENDER = "-b";
+constexpr const char* FLAG_BEGIN_RENDER_LONG = "-beginRender";
+constexpr const char* FLAG_END_RENDER = "-e";
+constexpr const char* FLAG_END_RENDER_LONG = "-endRender";
+
+} // namespace
+
+MSyntax RenderQualityCommand::newSyntax() {
+	MSyntax syntax;
+	syntax.addFlag(FLAG_BEGIN_RENDER, FLAG_BEGIN_RENDER_LONG);
+	syntax.addFlag(FLAG_END_RENDER, FLAG_END_RENDER_LONG);
+	return syntax;
+}
+
+MStatus RenderQualityCommand::doIt(const MArgList& args) {
+	MStatus status;
+	const MArgDatabase argData(syntax(), args, &status);
+	if (status != MS::kSuccess)
+		return status;
+
+	if (argData.isFlagSet(FLAG_BEGIN_RENDER))
+		PRTModifierNode::setForceFullQuality(true);
+	else if (argData.isFlagSet(FLAG_END_RENDER))
+		PRTModifierNode::setForceFullQuality(false);
+
+	return MS::kSuccess;
+}
@@ -55,6 +55,55 @@ std::wstring getNiceName(const std::wstring& fqAttrName) {
 	return cleanForMaya(prtu::removeImport(prtu::removeStyle(fqAttrName)));
 }
 
+std::wstring getFileFilter(const prt::Annotation* an) {
+	std::wstring exts;
+	for (size_t arg = 0; arg < an->getNumArguments(); arg++) {
+		if (an->getArgument(arg)->getType() == prt::AAT_STR) {
+			exts += an->getArgument(arg)->getStr();
+			exts += L" (*.";
+			exts += an->getArgument(arg)->getStr();
+			exts += L");";
+		}
+	}
+	exts += L"All Files (*.*)";
+	return exts;
+}
+
+void parseRangeAnnotation(const prt::Annotation* an, RuleAttribute& p) {
+	for (int argIdx = 0; argIdx < an->getNumArguments(); argIdx++) {
+		const prt::AnnotationArgument* arg = an->getArgument(argIdx);
+		const wchar_t* key = arg->getKey();
+		if (std::wcscmp(key, ANNOT_RANGE_MIN_KEY) == 0)
+			p.rangeMin = arg->getFloat();
+		else if (std::wcscmp(key, ANNOT_RANGE_MAX_KEY) == 0)
+			p.rangeMax = arg->getFloat();
+	}
+}
+
+// the first trait annotation wins
+void detectAttributeTrait(const prt::Annotation* an, RuleAttribute& p) {
+	if (p.trait != AttributeTrait::PLAIN)
+		return;
+
+	const wchar_t* anName = an->getName();
+	if (std::wcscmp(anName, ANNOT_ENUM) == 0) {
+		p.trait = AttributeTrait::ENUM;
+		p.enumAnnotation = an;
+	}
+	else if (std::wcscmp(anName, ANNOT_RANGE) == 0) {
+		p.trait = AttributeTrait::RANGE;
+		parseRangeAnnotation(an, p);
+	}
+	else if (std::wcscmp(anName, ANNOT_COLOR) == 0)
+		p.trait = AttributeTrait::COLOR;
+	else if (std::wcscmp(anName, ANNOT_DIR) == 0)
+		p.trait = AttributeTrait::DIR;
+	else if (std::wcscmp(anName, ANNOT_FILE) == 0) {
+		p.trait = AttributeTrait::FILE;
+		p.fileFilter = getFileFilter(an);
+	}
+}
+
 } // namespace
 
 RuleAttributes getRuleAttributes(const std::wstring& ruleFile, const prt::RuleFileInfo* ruleFileInfo) {
@@ -95,6 +144,8 @@ RuleAttributes getRuleAttributes(const std::wstring& ruleFile, const prt::RuleFi
 		bool hidden = false;
 		for (size_t a = 0; a < attr->getNumAnnotations(); a++) {
 			const prt::Annotation* an = attr->getAnnotation(a);
+			detectAttributeTrait(an, p);
+
 			const wchar_t* anName = an->getName();
 			if (!(std::wcscmp(anName, ANNOT_HIDDEN)))
 				hidden = true;
@@ -130,6 +181,26 @@ RuleAttributes getRuleAttributes(const std::wstring& ruleFile, const prt::RuleFi
 	return ra;
 }
 
+RuleAttributeRegistry::RuleAttributeRegistry(RuleAttributes attributes, RuleFileInfoUPtr ruleFileInfo)
+    : mRuleFileInfo(std::move(ruleFileInfo)), mAttributes(std::move(attributes)) {
+	mMayaFullNameIndex.reserve(mAttributes.size());
+	mFqNameIndex.reserve(mAttributes.size());
+	for (size_t i = 0; i < mAttributes.size(); i++) {
+		mMayaFullNameIndex.emplace(mAttributes[i].mayaFullName, i);
+		mFqNameIndex.emplace(mAttributes[i].fqName, i);
+	}
+}
+
+const RuleAttribute* RuleAttributeRegistry::findByMayaFullName(const std::wstring& mayaFullName) const {
+	const auto it = mMayaFullNameIndex.find(mayaFullName);
+	return (it != mMayaFullNameIndex.end()) ? &mAttributes[it->second] : nullptr;
+}
+
+const RuleAttribute* RuleAttributeRegistry::findByFqName(const std::wstring& fqName) const {
+	const auto it = mFqNameIndex.find(fqName);
+	return (it != mFqNameIndex.end()) ? &mAttributes[it->second] : nullptr;
+}
+
 AttributeGroupOrder getGlobalGroupOrder(const RuleAttributes& ruleAttributes) {
 	AttributeGroupOrder globalGroupOrder;
 	for (const auto& attribute : ruleAttributes) {
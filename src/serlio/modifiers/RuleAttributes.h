@@ -21,11 +21,14 @@
 
 #include "serlioPlugin.h"
 
+#include "utils/Utilities.h"
+
 #include "prt/Annotation.h"
 
 #include <limits>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace prt {
@@ -41,12 +44,18 @@ constexpr const wchar_t* ANNOT_FILE = L"@File";
 constexpr const wchar_t* ANNOT_ORDER = L"@Order";
 constexpr const wchar_t* ANNOT_GROUP = L"@Group";
 
+constexpr const wchar_t* ANNOT_RANGE_MIN_KEY = L"min";
+constexpr const wchar_t* ANNOT_RANGE_MAX_KEY = L"max";
+
 constexpr int ORDER_FIRST = std::numeric_limits<int>::min();
 constexpr int ORDER_NONE = std::numeric_limits<int>::max();
 
 using AttributeGroup = std::vector<std::wstring>;
 using AttributeGroupOrder = std::map<AttributeGroup, int>;
 
+// determines the maya attribute type, derived from the first matching annotation
+enum class AttributeTrait { ENUM, RANGE, FILE, DIR, COLOR, PLAIN };
+
 struct RuleAttribute {
 	std::wstring fqName;        // fully qualified rule name (i.e. including style prefix)
 	std::wstring mayaBriefName; // see Maya MFnAttribute create() method
@@ -60,10 +69,40 @@ struct RuleAttribute {
 
 	std::wstring ruleFile;
 	bool memberOfStartRuleFile = false;
+
+	AttributeTrait trait = AttributeTrait::PLAIN;
+	const prt::Annotation* enumAnnotation = nullptr; // owned by the rule file info, see RuleAttributeRegistry
+	double rangeMin = std::numeric_limits<double>::quiet_NaN();
+	double rangeMax = std::numeric_limits<double>::quiet_NaN();
+	std::wstring fileFilter; // maya file dialog filter for the FILE trait
 };
 
 using RuleAttributes = std::vector<RuleAttribute>;
 
+/**
+ * Sorted rule attributes of a rule file, indexed by maya full name and by fully qualified name.
+ * Keeps the rule file info alive because the attributes refer to its annotations.
+ */
+class SRL_TEST_EXPORTS_API RuleAttributeRegistry {
+public:
+	RuleAttributeRegistry() = default;
+	explicit RuleAttributeRegistry(RuleAttributes attributes, RuleFileInfoUPtr ruleFileInfo = {});
+
+	const RuleAttributes& getAttributes() const {
+		return mAttributes;
+	}
+
+	// nullptr if not found
+	const RuleAttribute* findByMayaFullName(const std::wstring& mayaFullName) const;
+	const RuleAttribute* findByFqName(const std::wstring& fqName) const;
+
+private:
+	RuleFileInfoUPtr mRuleFileInfo;
+	RuleAttributes mAttributes;
+	std::unordered_map<std::wstring, size_t> mMayaFullNameIndex;
+	std::unordered_map<std::wstring, size_t> mFqNameIndex;
+};
+
 SRL_TEST_EXPORTS_API RuleAttributes getRuleAttributes(const std::wstring& ruleFile,
                                                       const prt::RuleFileInfo* ruleFileInfo);
 AttributeGroupOrder getGlobalGroupOrder(const RuleAttributes& ruleAttributes);
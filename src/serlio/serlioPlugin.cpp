@@ -20,14 +20,24 @@
 #include "serlioPlugin.h"
 #include "PRTContext.h"
 
+#include "modifiers/CacheCommand.h"
 #include "modifiers/PRTModifierCommand.h"
 #include "modifiers/PRTModifierNode.h"
+#include "modifiers/PreloadCommand.h"
+#include "modifiers/RegenerateCommand.h"
+#include "modifiers/RenderQualityCommand.h"
+#include "modifiers/SceneOcclusionCommand.h"
 
 #include "materials/ArnoldMaterialNode.h"
+#include "materials/MaterialIndex.h"
 #include "materials/StingrayMaterialNode.h"
 
+#include "utils/LogHandler.h"
+#include "utils/MELScriptBuilder.h"
 #include "utils/MayaUtilities.h"
+#include "utils/RPKUnpackStore.h"
 
+#include "maya/MCallbackIdArray.h"
 #include "maya/MFnPlugin.h"
 #include "maya/MGlobal.h"
 #include "maya/MSceneMessage.h"
@@ -46,8 +56,18 @@ constexpr const char* CMD_ASSIGN = "serlioAssign";
 constexpr const char* MEL_PROC_CREATE_UI = "serlioCreateUI";
 constexpr const char* MEL_PROC_DELETE_UI = "serlioDeleteUI";
 constexpr const char* SERLIO_VENDOR = "Esri R&D Center Zurich";
+constexpr const char* OPTION_VAR_GENERATION_CACHE_SIZE = "serlioGenerationCacheSize";   // in MB
+constexpr const char* OPTION_VAR_DISK_CACHE_DIRECTORY = "serlioDiskCacheDirectory";     // empty to disable
+constexpr const char* OPTION_VAR_DISK_CACHE_SIZE = "serlioDiskCacheSize";               // in MB
+constexpr const char* OPTION_VAR_PRT_CACHE_SIZE = "serlioPRTCacheSize";                 // in MB
+constexpr const char* OPTION_VAR_UNPACK_STORE_DIRECTORY = "serlioUnpackStoreDirectory"; // empty to disable
+constexpr const char* OPTION_VAR_UNPACK_STORE_SIZE = "serlioUnpackStoreSize";           // in MB
+constexpr const char* OPTION_VAR_ZERO_EXTRACT = "serlioZeroExtract";                    // 1 to read assets from rpks
+constexpr const char* OPTION_VAR_RPK_CACHE_ENTRIES = "serlioRPKCacheEntries";            // number of rpks
+constexpr const char* OPTION_VAR_RPK_CACHE_SIZE = "serlioRPKCacheSize";                  // in MB of rpk files
 
 std::once_flag callbackRegisterFlag;
+MCallbackIdArray sceneCallbackIds;
 
 } // namespace
 
@@ -66,11 +86,100 @@ MStatus initializePlugin(MObject obj) {
 		MCHECK(mayaStatus);
 	});
 
+	bool hasGenerationCacheSize = false;
+	const int generationCacheSize =
+	        MGlobal::optionVarIntValue(OPTION_VAR_GENERATION_CACHE_SIZE, &hasGenerationCacheSize);
+	if (hasGenerationCacheSize && generationCacheSize >= 0) {
+		const size_t budget = static_cast<size_t>(generationCacheSize) * 1024 * 1024;
+		PRTContext::get().mGenerationCache->setMemoryBudget(budget);
+		if (DBG)
+			LOG_DBG << "generation cache budget set to " << generationCacheSize << " MB";
+	}
+
+	bool hasPRTCacheSize = false;
+	const int prtCacheSize = MGlobal::optionVarIntValue(OPTION_VAR_PRT_CACHE_SIZE, &hasPRTCacheSize);
+	if (hasPRTCacheSize && prtCacheSize >= 0) {
+		const size_t budget = static_cast<size_t>(prtCacheSize) * 1024 * 1024;
+		PRTContext::get().mPRTCacheManager->setMemoryBudget(budget);
+		if (DBG)
+			LOG_DBG << "prt cache budget set to " << prtCacheSize << " MB";
+	}
+
+	const MString diskCacheDirectory = MGlobal::optionVarStringValue(OPTION_VAR_DISK_CACHE_DIRECTORY);
+	if (diskCacheDirectory.length() > 0) {
+		bool hasDiskCacheSize = false;
+		const int diskCacheSize = MGlobal::optionVarIntValue(OPTION_VAR_DISK_CACHE_SIZE, &hasDiskCacheSize);
+		const uint64_t budget = (hasDiskCacheSize && diskCacheSize >= 0)
+		                                ? static_cast<uint64_t>(diskCacheSize) * 1024 * 1024
+		                                : DiskGenerationCache::DEFAULT_SIZE_BUDGET;
+		PRTContext::get().mDiskGenerationCache =
+		        std::make_unique<DiskGenerationCache>(diskCacheDirectory.asWChar(), budget);
+
+		// cached results refer to the textures extracted from rpks, they have to outlive the session as well
+		const std::wstring textureRoot =
+		        std::wstring(diskCacheDirectory.asWChar()) + prtu::getDirSeparator<wchar_t>() + L"textures";
+		PRTContext::get().mResolveMapCache->setTextureRoot(textureRoot);
+		if (DBG)
+			LOG_DBG << "disk generation cache enabled in " << diskCacheDirectory.asWChar();
+	}
+
+	const MString unpackStoreDirectory = MGlobal::optionVarStringValue(OPTION_VAR_UNPACK_STORE_DIRECTORY);
+	if (unpackStoreDirectory.length() > 0) {
+		bool hasUnpackStoreSize = false;
+		const int unpackStoreSize = MGlobal::optionVarIntValue(OPTION_VAR_UNPACK_STORE_SIZE, &hasUnpackStoreSize);
+		const uint64_t budget = (hasUnpackStoreSize && unpackStoreSize >= 0)
+		                                ? static_cast<uint64_t>(unpackStoreSize) * 1024 * 1024
+		                                : RPKUnpackStore::DEFAULT_SIZE_BUDGET;
+		PRTContext::get().mResolveMapCache->setUnpackStore(
+		        std::make_shared<RPKUnpackStore>(unpackStoreDirectory.asWChar(), budget));
+		if (DBG)
+			LOG_DBG << "rule package unpack store enabled in " << unpackStoreDirectory.asWChar();
+	}
+
+	bool hasRPKCacheEntries = false;
+	bool hasRPKCacheSize = false;
+	const int rpkCacheEntries = MGlobal::optionVarIntValue(OPTION_VAR_RPK_CACHE_ENTRIES, &hasRPKCacheEntries);
+	const int rpkCacheSize = MGlobal::optionVarIntValue(OPTION_VAR_RPK_CACHE_SIZE, &hasRPKCacheSize);
+	if ((hasRPKCacheEntries && rpkCacheEntries >= 0) || (hasRPKCacheSize && rpkCacheSize >= 0)) {
+		const size_t maxEntries = (hasRPKCacheEntries && rpkCacheEntries >= 0) ? static_cast<size_t>(rpkCacheEntries)
+		                                                                       : ResolveMapCache::DEFAULT_MAX_ENTRIES;
+		const uint64_t maxSize = (hasRPKCacheSize && rpkCacheSize >= 0)
+		                                 ? static_cast<uint64_t>(rpkCacheSize) * 1024 * 1024
+		                                 : ResolveMapCache::DEFAULT_MAX_SIZE;
+		PRTContext::get().mResolveMapCache->setLimits(maxEntries, maxSize);
+		if (DBG)
+			LOG_DBG << "rule package cache limited to " << maxEntries << " rpks and " << maxSize << " bytes";
+	}
+
+	if (MGlobal::optionVarIntValue(OPTION_VAR_ZERO_EXTRACT) != 0) {
+		PRTContext::get().mResolveMapCache->setZeroExtract(true);
+		if (DBG)
+			LOG_DBG << "rule packages are read without unpacking";
+	}
+
 	MFnPlugin plugin(obj, SERLIO_VENDOR, SRL_VERSION);
 
 	auto createModifierCommand = []() { return (void*)new PRTModifierCommand(); };
 	MCHECK(plugin.registerCommand(CMD_ASSIGN, createModifierCommand));
 
+	auto createSceneOcclusionCommand = []() { return (void*)new SceneOcclusionCommand(); };
+	MCHECK(plugin.registerCommand(CMD_UPDATE_OCCLUSION, createSceneOcclusionCommand));
+
+	auto createRegenerateCommand = []() { return (void*)new RegenerateCommand(); };
+	MCHECK(plugin.registerCommand(CMD_REGENERATE, createRegenerateCommand));
+
+	auto createRenderQualityCommand = []() { return (void*)new RenderQualityCommand(); };
+	MCHECK(plugin.registerCommand(CMD_RENDER_QUALITY, createRenderQualityCommand, RenderQualityCommand::newSyntax));
+
+	auto createCacheCommand = []() { return (void*)new CacheCommand(); };
+	MCHECK(plugin.registerCommand(CMD_CACHE, createCacheCommand, CacheCommand::newSyntax));
+
+	auto createPreloadCommand = []() { return (void*)new PreloadCommand(); };
+	MCHECK(plugin.registerCommand(CMD_PRELOAD, createPreloadCommand, PreloadCommand::newSyntax));
+
+	auto createScriptCommand = []() { return (void*)new MELScriptCommand(); };
+	MCHECK(plugin.registerCommand(CMD_EXECUTE_SCRIPTS, createScriptCommand));
+
 	auto createModifierNode = []() { return (void*)new PRTModifierNode(); };
 	MCHECK(plugin.registerNode(NODE_MODIFIER, PRTModifierNode::id, createModifierNode, PRTModifierNode::initialize));
 
@@ -84,6 +193,35 @@ MStatus initializePlugin(MObject obj) {
 
 	MCHECK(plugin.registerUI(MEL_PROC_CREATE_UI, MEL_PROC_DELETE_UI));
 
+	// serlio nodes in preview mode must deliver full quality geometry to the renderer
+	auto beforeRenderCallback = [](void*) { PRTModifierNode::setForceFullQuality(true); };
+	// (other renderers are not reported, their pre and post render scripts can call serlioRenderQuality instead)
+	auto afterRenderCallback = [](void*) { PRTModifierNode::setForceFullQuality(false); };
+	MStatus sceneCallbackStatus = MStatus::kFailure;
+	sceneCallbackIds.append(MSceneMessage::addCallback(MSceneMessage::kBeforeSoftwareRender, beforeRenderCallback,
+	                                                   nullptr, &sceneCallbackStatus));
+	MCHECK(sceneCallbackStatus);
+	for (const auto message : {MSceneMessage::kAfterSoftwareRender, MSceneMessage::kSoftwareRenderInterrupted}) {
+		sceneCallbackIds.append(
+		        MSceneMessage::addCallback(message, afterRenderCallback, nullptr, &sceneCallbackStatus));
+		MCHECK(sceneCallbackStatus);
+	}
+
+	// generate all serlio nodes of a scene together after it has been loaded instead of one after the other
+	auto beforeLoadCallback = [](void*) { PRTModifierNode::beginSceneLoad(); };
+	auto afterLoadCallback = [](void*) { PRTModifierNode::endSceneLoad(); };
+	for (const auto message : {MSceneMessage::kBeforeOpen, MSceneMessage::kBeforeImport}) {
+		sceneCallbackIds.append(MSceneMessage::addCallback(message, beforeLoadCallback, nullptr, &sceneCallbackStatus));
+		MCHECK(sceneCallbackStatus);
+	}
+	for (const auto message : {MSceneMessage::kAfterOpen, MSceneMessage::kAfterImport}) {
+		sceneCallbackIds.append(MSceneMessage::addCallback(message, afterLoadCallback, nullptr, &sceneCallbackStatus));
+		MCHECK(sceneCallbackStatus);
+	}
+
+	// lets the material nodes find existing shading engines without scanning the scene
+	MaterialIndex::registerCallbacks(sceneCallbackIds);
+
 	return MStatus::kSuccess;
 }
 
@@ -93,14 +231,27 @@ MStatus uninitializePlugin(MObject obj) {
 	// * maya may unload/load serlio
 	// * PRT only supports initializing once per process life time
 
+	// the material scripts scheduled on idle would run without the plug-in
+	MELScriptCommand::cancelPending();
+
 	MStatus status;
 	if (obj != MObject::kNullObj) { // TODO
 		MFnPlugin plugin(obj);
 		MCHECK(plugin.deregisterCommand(CMD_ASSIGN));
+		MCHECK(plugin.deregisterCommand(CMD_UPDATE_OCCLUSION));
+		MCHECK(plugin.deregisterCommand(CMD_REGENERATE));
+		MCHECK(plugin.deregisterCommand(CMD_RENDER_QUALITY));
+		MCHECK(plugin.deregisterCommand(CMD_CACHE));
+		MCHECK(plugin.deregisterCommand(CMD_PRELOAD));
+		MCHECK(plugin.deregisterCommand(CMD_EXECUTE_SCRIPTS));
 		MCHECK(plugin.deregisterNode(PRTModifierNode::id));
 		MCHECK(plugin.deregisterNode(StingrayMaterialNode::id));
 		MCHECK(plugin.deregisterNode(ArnoldMaterialNode::id));
 	}
+	if (sceneCallbackIds.length() > 0) {
+		MCHECK(MMessage::removeCallbacks(sceneCallbackIds));
+		sceneCallbackIds.clear();
+	}
 	return status;
 }
 
@@ -18,16 +18,58 @@
  */
 
 #include "utils/MELScriptBuilder.h"
+#include "utils/LogHandler.h"
 #include "utils/MayaUtilities.h"
 
 #include "materials/MaterialInfo.h"
 
+#include "maya/MFnDependencyNode.h"
+#include "maya/MIntArray.h"
+#include "maya/MPlugArray.h"
+#include "maya/MSelectionList.h"
+
+#include <algorithm>
 #include <iomanip>
+#include <cwchar>
+#include <map>
+#include <mutex>
+#include <set>
+
+struct MELCommandContext {
+	struct Variable {
+		std::wstring value;
+		MObject node; // the node created into the variable, its name is only final after the modifier ran
+	};
+
+	explicit MELCommandContext(MDGModifier& modifier) : modifier(modifier) {}
+
+	MDGModifier& modifier;
+	bool hasPendingModifications = false;
+
+	std::map<std::wstring, Variable> variables;
+	std::map<std::wstring, int> intVariables;
+	std::map<std::wstring, unsigned int> nextListIndices;
+
+	std::wostringstream melLines;
+
+	MStatus flush();
+	MStatus runMEL();
+	MStatus readBack(const std::vector<std::wstring>& names, const std::wstring& values);
+	MStatus getValue(const MELVariable& var, std::wstring& value);
+	MStatus getNode(const MELVariable& var, MObject& node);
+	MStatus getPlug(const MELVariable& node, const std::wstring& attribute, MPlug& plug);
+};
 
 namespace {
 
+constexpr bool DBG = false;
 constexpr bool MEL_ENABLE_DISPLAY = false;
 
+const MELVariable MEL_VAR_READ_BACK(L"serlioReadBack");
+
+std::mutex pendingScriptsMutex;
+std::vector<std::vector<MELCommand>> pendingScripts;
+
 std::wstring composeAttributeExpression(const MELVariable& node, const std::wstring& attribute) {
 	assert(!attribute.empty() && attribute[0] != L'.'); // to catch refactoring bugs
 	std::wostringstream out;
@@ -35,24 +77,299 @@ std::wstring composeAttributeExpression(const MELVariable& node, const std::wstr
 	return out.str();
 }
 
+MStatus findNode(const std::wstring& name, MObject& node) {
+	MSelectionList selection;
+	MStatus status = selection.add(MString(name.c_str()));
+	if (status != MStatus::kSuccess)
+		return status;
+	return selection.getDependNode(0, node);
+}
+
+MStatus setPlugValue(MELCommandContext& ctx, const MPlug& plug, const bool val) {
+	return ctx.modifier.newPlugValueBool(plug, val);
+}
+
+MStatus setPlugValue(MELCommandContext& ctx, const MPlug& plug, const int val) {
+	return ctx.modifier.newPlugValueInt(plug, val);
+}
+
+MStatus setPlugValue(MELCommandContext& ctx, const MPlug& plug, const double val) {
+	return ctx.modifier.newPlugValueDouble(plug, val);
+}
+
+MStatus setPlugValue(MELCommandContext& ctx, const MPlug& plug, const std::wstring& val) {
+	return ctx.modifier.newPlugValueString(plug, MString(val.c_str()));
+}
+
+template <size_t N>
+MStatus setPlugValue(MELCommandContext& ctx, const MPlug& plug, const std::array<double, N>& val) {
+	if (plug.numChildren() != val.size())
+		return MStatus::kInvalidParameter;
+	for (unsigned int i = 0; i < val.size(); i++) {
+		const MStatus status = ctx.modifier.newPlugValueDouble(plug.child(i), val[i]);
+		if (status != MStatus::kSuccess)
+			return status;
+	}
+	return MStatus::kSuccess;
+}
+
+// like MEL, commands which are not MEL lines first run the MEL lines recorded before them
+template <typename F>
+MELCommand nativeCommand(F&& f) {
+	return [f](MELCommandContext& ctx) {
+		const MStatus status = ctx.runMEL();
+		if (status != MStatus::kSuccess)
+			return status;
+		return f(ctx);
+	};
+}
+
+MELCommand melCommand(const std::wstring& line) {
+	return [line](MELCommandContext& ctx) {
+		ctx.melLines << line << L"\n";
+		return MStatus(MStatus::kSuccess);
+	};
+}
+
+template <typename T>
+MELCommand setAttrCommand(const MELVariable& node, const std::wstring& attribute, const T& val) {
+	return nativeCommand([node, attribute, val](MELCommandContext& ctx) {
+		MPlug plug;
+		MStatus status = ctx.getPlug(node, attribute, plug);
+		if (status != MStatus::kSuccess)
+			return status;
+		status = setPlugValue(ctx, plug, val);
+		if (status != MStatus::kSuccess)
+			LOG_ERR << "failed to set attribute " << plug.name().asWChar();
+		ctx.hasPendingModifications = true;
+		return status;
+	});
+}
+
+MStatus connectToList(MELCommandContext& ctx, const MObject& node, const std::wstring& listNode,
+                      const std::wstring& listAttribute) {
+	MObject listObj;
+	MStatus status = findNode(listNode, listObj);
+	if (status != MStatus::kSuccess)
+		return status;
+
+	MPlug listPlug = MFnDependencyNode(listObj).findPlug(MString(listAttribute.c_str()), true, &status);
+	if (status != MStatus::kSuccess)
+		return status;
+
+	// equivalent of connectAttr -nextAvailable, the pending connections are not visible in the plug yet
+	const std::wstring key = listNode + L'.' + listAttribute;
+	auto nextIndexIt = ctx.nextListIndices.find(key);
+	if (nextIndexIt == ctx.nextListIndices.end()) {
+		MIntArray indices;
+		listPlug.getExistingArrayAttributeIndices(indices);
+		unsigned int nextIndex = 0;
+		for (unsigned int i = 0; i < indices.length(); i++)
+			nextIndex = std::max(nextIndex, static_cast<unsigned int>(indices[i]) + 1);
+		nextIndexIt = ctx.nextListIndices.emplace(key, nextIndex).first;
+	}
+
+	const MPlug messagePlug = MFnDependencyNode(node).findPlug("message", true, &status);
+	if (status != MStatus::kSuccess)
+		return status;
+	return ctx.modifier.connect(messagePlug, listPlug.elementByLogicalIndex(nextIndexIt->second++));
+}
+
+// equivalent of shadingNode -skipSelect, which names the node after the variable value and adds it to the list
+MELCommand createNodeCommand(const std::wstring& nodeType, const MELVariable& nodeName, const std::wstring& listNode,
+                             const std::wstring& listAttribute) {
+	return nativeCommand([nodeType, nodeName, listNode, listAttribute](MELCommandContext& ctx) {
+		std::wstring name;
+		MStatus status = ctx.getValue(nodeName, name);
+		if (status != MStatus::kSuccess)
+			return status;
+
+		const MObject node = ctx.modifier.createNode(MString(nodeType.c_str()), &status);
+		if (status != MStatus::kSuccess) {
+			LOG_ERR << "failed to create node of type " << nodeType;
+			return status;
+		}
+		ctx.hasPendingModifications = true;
+		ctx.variables[nodeName.get()].node = node;
+
+		status = ctx.modifier.renameNode(node, MString(name.c_str())); // note: name might change to be unique
+		if (status != MStatus::kSuccess)
+			return status;
+
+		return connectToList(ctx, node, listNode, listAttribute);
+	});
+}
+
+MStatus run(const std::vector<MELCommand>& commands, MELCommandContext& ctx) {
+	for (const MELCommand& command : commands) {
+		const MStatus status = command(ctx);
+		if (status != MStatus::kSuccess) {
+			// like a MEL script, stop at the first failing command but keep the effects of the previous ones
+			ctx.flush();
+			return status;
+		}
+	}
+
+	const MStatus status = ctx.runMEL();
+	if (status != MStatus::kSuccess)
+		return status;
+
+	return ctx.flush();
+}
+
 } // namespace
 
+MStatus MELCommandContext::flush() {
+	if (!hasPendingModifications)
+		return MStatus::kSuccess;
+	hasPendingModifications = false;
+	return modifier.doIt();
+}
+
+MStatus MELCommandContext::runMEL() {
+	const std::wstring lines = melLines.str();
+	if (lines.empty())
+		return MStatus::kSuccess;
+	melLines.str(std::wstring());
+
+	// the variables MEL can assign are read back, so the next MEL lines and the native commands see their values
+	MStatus status;
+	std::vector<std::wstring> readBackNames;
+	std::wostringstream script;
+	script << "{\n";
+	for (const auto& var : variables) {
+		std::wstring value;
+		status = getValue(MELVariable(var.first), value);
+		if (status != MStatus::kSuccess)
+			return status;
+		script << "string " << MELVariable(var.first).mel() << " = " << MELStringLiteral(value).mel() << ";\n";
+		if (var.second.node.isNull())
+			readBackNames.push_back(var.first);
+	}
+	for (const auto& var : intVariables) {
+		script << "int " << MELVariable(var.first).mel() << " = " << var.second << ";\n";
+		readBackNames.push_back(var.first);
+	}
+	script << lines;
+	if (!readBackNames.empty()) {
+		script << "global string " << MEL_VAR_READ_BACK.mel() << ";\n" << MEL_VAR_READ_BACK.mel() << " = (\"\"";
+		for (const std::wstring& name : readBackNames)
+			script << " + " << MELVariable(name).mel() << " + \"\\n\"";
+		script << ");\n";
+	}
+	script << "}\n";
+
+	// the lines run as part of the modifier, after the nodes created so far, so undo and redo of the modifier cover
+	// them as well, the results are passed through a global variable
+	status = modifier.commandToExecute(MString(script.str().c_str()));
+	if (status != MStatus::kSuccess)
+		return status;
+	hasPendingModifications = true;
+	status = flush();
+	if (status != MStatus::kSuccess || readBackNames.empty())
+		return status;
+
+	std::wostringstream query;
+	query << "global string " << MEL_VAR_READ_BACK.mel() << "; " << MEL_VAR_READ_BACK.mel() << " = "
+	      << MEL_VAR_READ_BACK.mel() << ";";
+	const MString result =
+	        MGlobal::executeCommandStringResult(query.str().c_str(), MEL_ENABLE_DISPLAY, false, &status);
+	if (status != MStatus::kSuccess)
+		return status;
+	return readBack(readBackNames, result.asWChar());
+}
+
+MStatus MELCommandContext::readBack(const std::vector<std::wstring>& names, const std::wstring& values) {
+	std::wistringstream valueStream(values);
+	for (const std::wstring& name : names) {
+		std::wstring value;
+		if (!std::getline(valueStream, value, L'\n')) {
+			LOG_ERR << "failed to read back MEL variable " << MELVariable(name).mel();
+			return MStatus::kFailure;
+		}
+
+		const auto intIt = intVariables.find(name);
+		if (intIt != intVariables.end())
+			intIt->second = static_cast<int>(std::wcstol(value.c_str(), nullptr, 10));
+		else
+			variables[name].value = value;
+	}
+	return MStatus::kSuccess;
+}
+
+MStatus MELCommandContext::getValue(const MELVariable& var, std::wstring& value) {
+	const auto it = variables.find(var.get());
+	if (it == variables.end()) {
+		value.clear();
+		return MStatus::kSuccess;
+	}
+
+	if (it->second.node.isNull()) {
+		value = it->second.value;
+		return MStatus::kSuccess;
+	}
+
+	// the node might still have a pending rename
+	const MStatus status = flush();
+	if (status != MStatus::kSuccess)
+		return status;
+	value = MFnDependencyNode(it->second.node).name().asWChar();
+	return MStatus::kSuccess;
+}
+
+MStatus MELCommandContext::getNode(const MELVariable& var, MObject& node) {
+	const auto it = variables.find(var.get());
+	if (it == variables.end()) {
+		LOG_ERR << "MEL variable " << var.mel() << " is not set";
+		return MStatus::kInvalidParameter;
+	}
+
+	if (!it->second.node.isNull()) {
+		node = it->second.node;
+		return MStatus::kSuccess;
+	}
+
+	// the variable holds the name of an existing node or of a node with a pending rename
+	if (findNode(it->second.value, node) == MStatus::kSuccess)
+		return MStatus::kSuccess;
+	const MStatus status = flush();
+	if (status != MStatus::kSuccess)
+		return status;
+	return findNode(it->second.value, node);
+}
+
+MStatus MELCommandContext::getPlug(const MELVariable& node, const std::wstring& attribute, MPlug& plug) {
+	MObject nodeObj;
+	MStatus status = getNode(node, nodeObj);
+	if (status != MStatus::kSuccess)
+		return status;
+
+	plug = MFnDependencyNode(nodeObj).findPlug(MString(attribute.c_str()), true, &status);
+	if (status != MStatus::kSuccess)
+		LOG_ERR << "node " << MFnDependencyNode(nodeObj).name().asWChar() << " has no attribute " << attribute;
+	return status;
+}
+
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute, const bool val) {
 	commandStream << "setAttr " << composeAttributeExpression(node, attribute) << " " << (val ? 1 : 0) << ";\n";
+	commands.push_back(setAttrCommand(node, attribute, val));
 }
 
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute, const int val) {
 	commandStream << "setAttr " << composeAttributeExpression(node, attribute) << " " << val << ";\n";
+	commands.push_back(setAttrCommand(node, attribute, val));
 }
 
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute, const double val) {
 	commandStream << "setAttr " << composeAttributeExpression(node, attribute) << " " << val << ";\n";
+	commands.push_back(setAttrCommand(node, attribute, val));
 }
 
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute, const double val1,
                                const double val2) {
 	commandStream << "setAttr -type double2 " << composeAttributeExpression(node, attribute) << " " << val1 << " "
 	              << val2 << ";\n";
+	commands.push_back(setAttrCommand(node, attribute, std::array<double, 2>{val1, val2}));
 }
 
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute,
@@ -64,6 +381,7 @@ void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attr
                                const double val2, const double val3) {
 	commandStream << "setAttr -type double3 " << composeAttributeExpression(node, attribute) << " " << val1 << " "
 	              << val2 << " " << val3 << ";\n";
+	commands.push_back(setAttrCommand(node, attribute, std::array<double, 3>{val1, val2, val3}));
 }
 
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute,
@@ -74,11 +392,19 @@ void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attr
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute, const MELVariable& val) {
 	commandStream << "setAttr -type \"string\" " << composeAttributeExpression(node, attribute) << " " << val.mel()
 	              << ";\n";
+	commands.push_back(nativeCommand([node, attribute, val](MELCommandContext& ctx) {
+		std::wstring value;
+		const MStatus status = ctx.getValue(val, value);
+		if (status != MStatus::kSuccess)
+			return status;
+		return setAttrCommand(node, attribute, value)(ctx);
+	}));
 }
 
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute, const MELStringLiteral& val) {
 	commandStream << "setAttr -type \"string\" " << composeAttributeExpression(node, attribute) << " " << val.mel()
 	              << ";\n";
+	commands.push_back(setAttrCommand(node, attribute, val.get()));
 }
 
 void MELScriptBuilder::setAttr(const MELVariable& node, const std::wstring& attribute, const MaterialColor& color) {
@@ -89,60 +415,173 @@ void MELScriptBuilder::connectAttr(const MELVariable& srcNode, const std::wstrin
                                    const std::wstring& dstAttr) {
 	commandStream << "connectAttr -force " << composeAttributeExpression(srcNode, srcAttr) << " "
 	              << composeAttributeExpression(dstNode, dstAttr) << ";\n";
+	commands.push_back(nativeCommand([srcNode, srcAttr, dstNode, dstAttr](MELCommandContext& ctx) {
+		MPlug srcPlug;
+		MStatus status = ctx.getPlug(srcNode, srcAttr, srcPlug);
+		if (status != MStatus::kSuccess)
+			return status;
+
+		MPlug dstPlug;
+		status = ctx.getPlug(dstNode, dstAttr, dstPlug);
+		if (status != MStatus::kSuccess)
+			return status;
+
+		// -force: replace an existing incoming connection
+		MPlugArray sources;
+		dstPlug.connectedTo(sources, true, false);
+		for (unsigned int i = 0; i < sources.length(); i++) {
+			status = ctx.modifier.disconnect(sources[i], dstPlug);
+			if (status != MStatus::kSuccess)
+				return status;
+		}
+
+		status = ctx.modifier.connect(srcPlug, dstPlug);
+		if (status != MStatus::kSuccess)
+			LOG_ERR << "failed to connect " << srcPlug.name().asWChar() << " to " << dstPlug.name().asWChar();
+		ctx.hasPendingModifications = true;
+		return status;
+	}));
 }
 
 void MELScriptBuilder::python(const std::wstring& pythonCmd) {
-	commandStream << "python(\"" << pythonCmd << "\");\n";
+	std::wostringstream line;
+	line << "python(\"" << pythonCmd << "\");";
+	commandStream << line.str() << "\n";
+	commands.push_back(melCommand(line.str()));
 }
 
 void MELScriptBuilder::declInt(const MELVariable& varName) {
 	commandStream << "int " << varName.mel() << ";\n";
+	commands.push_back(nativeCommand([varName](MELCommandContext& ctx) {
+		ctx.intVariables[varName.get()] = 0;
+		return MStatus(MStatus::kSuccess);
+	}));
 }
 
 void MELScriptBuilder::declString(const MELVariable& varName) {
 	commandStream << "string " << varName.mel() << ";\n";
+	commands.push_back(nativeCommand([varName](MELCommandContext& ctx) {
+		ctx.variables[varName.get()] = MELCommandContext::Variable();
+		return MStatus(MStatus::kSuccess);
+	}));
 }
 
 void MELScriptBuilder::setVar(const MELVariable& varName, const MELStringLiteral& val) {
 	commandStream << varName.mel() << " = " << val.mel() << ";\n";
+	commands.push_back(nativeCommand([varName, val](MELCommandContext& ctx) {
+		ctx.variables[varName.get()] = {val.get(), MObject()};
+		return MStatus(MStatus::kSuccess);
+	}));
 }
 
 void MELScriptBuilder::setsCreate(const MELVariable& setName) {
+	// the sets command also takes care of the render partition and light linking
 	const auto mel = setName.mel();
-	commandStream << mel << "= `sets -empty -renderable true -noSurfaceShader true -name " << mel << "`;\n";
+	std::wostringstream line;
+	line << mel << "= `sets -empty -renderable true -noSurfaceShader true -name " << mel << "`;";
+	commandStream << line.str() << "\n";
+	// the set name is read back into the variable after the MEL ran
+	commands.push_back(nativeCommand([setName, line = line.str()](MELCommandContext& ctx) {
+		ctx.variables.emplace(setName.get(), MELCommandContext::Variable());
+		ctx.melLines << line << L"\n";
+		return ctx.runMEL();
+	}));
 }
 
 void MELScriptBuilder::setsAddFaceRange(const std::wstring& setName, const std::wstring& meshName, const int faceStart,
                                         const int faceEnd) {
-	commandStream << "sets -forceElement " << setName << " " << meshName << ".f[" << faceStart << ":" << faceEnd
-	              << "];\n";
+	std::wostringstream line;
+	line << "sets -forceElement " << setName << " " << meshName << ".f[" << faceStart << ":" << faceEnd << "];";
+	commandStream << line.str() << "\n";
+
+	// only refers to existing nodes, so it can run with the modifier instead of splitting it
+	commands.push_back(nativeCommand([line = line.str()](MELCommandContext& ctx) {
+		ctx.hasPendingModifications = true;
+		return ctx.modifier.commandToExecute(MString(line.c_str()));
+	}));
 }
 
 void MELScriptBuilder::createShader(const std::wstring& shaderType, const MELVariable& nodeName) {
 	const auto mel = nodeName.mel();
 	commandStream << mel << " = `shadingNode -asShader -skipSelect -name " << mel << " " << shaderType << "`;\n";
+	commands.push_back(createNodeCommand(shaderType, nodeName, L"defaultShaderList1", L"shaders"));
 }
 
 void MELScriptBuilder::createTextureShadingNode(const MELVariable& nodeName) {
 	const auto mel = nodeName.mel();
 	commandStream << mel << "= `shadingNode -asTexture -skipSelect -name " << mel << " file`;\n";
+	commands.push_back(createNodeCommand(L"file", nodeName, L"defaultTextureList1", L"textures"));
 }
 
 void MELScriptBuilder::addCmdLine(const std::wstring& line) {
 	commandStream << line << L"\n";
+	commands.push_back(melCommand(line));
 }
 
-MStatus MELScriptBuilder::executeSync(std::wstring& output) {
-	MStatus status;
-	MString result =
-	        MGlobal::executeCommandStringResult(commandStream.str().c_str(), MEL_ENABLE_DISPLAY, false, &status);
-	commandStream.clear();
-	output.assign(result.asWChar());
-	return status;
+MStatus MELScriptBuilder::executeSync(const MELVariable& resultVariable, std::wstring& result) {
+	if (DBG)
+		LOG_DBG << "executing script:\n" << commandStream.str();
+	MDGModifier modifier;
+	MELCommandContext ctx(modifier);
+	MStatus status = run(commands, ctx);
+	commands.clear();
+	commandStream.str(std::wstring());
+	if (status != MStatus::kSuccess)
+		return status;
+	return ctx.getValue(resultVariable, result);
 }
 
 MStatus MELScriptBuilder::execute() {
-	MStatus status = MGlobal::executeCommandOnIdle(commandStream.str().c_str(), MEL_ENABLE_DISPLAY);
-	commandStream.clear();
-	return status;
+	if (DBG)
+		LOG_DBG << "scheduling script:\n" << commandStream.str();
+	bool isScheduled = false;
+	{
+		std::lock_guard<std::mutex> lock(pendingScriptsMutex);
+		isScheduled = !pendingScripts.empty();
+		pendingScripts.push_back(std::move(commands));
+	}
+	commands.clear();
+	commandStream.str(std::wstring());
+	if (isScheduled)
+		return MStatus::kSuccess; // the pending command picks up this script too
+
+	// does nothing if the plug-in got unloaded in the meantime
+	const MString command = MString("if (`exists ") + CMD_EXECUTE_SCRIPTS + "`) " + CMD_EXECUTE_SCRIPTS + ";";
+	return MGlobal::executeCommandOnIdle(command, MEL_ENABLE_DISPLAY);
+}
+
+void MELScriptCommand::cancelPending() {
+	std::lock_guard<std::mutex> lock(pendingScriptsMutex);
+	if (DBG && !pendingScripts.empty())
+		LOG_DBG << "dropping " << pendingScripts.size() << " pending scripts";
+	pendingScripts.clear();
+}
+
+MStatus MELScriptCommand::doIt(const MArgList& /*args*/) {
+	{
+		std::lock_guard<std::mutex> lock(pendingScriptsMutex);
+		mScripts.swap(pendingScripts);
+	}
+
+	mModifier = std::make_unique<MDGModifier>();
+	for (const std::vector<MELCommand>& script : mScripts) {
+		MELCommandContext ctx(*mModifier);
+		const MStatus status = run(script, ctx);
+		if (status != MStatus::kSuccess) // the effects of the previous commands stay undoable
+			LOG_ERR << "failed to execute script: " << status.errorString().asWChar();
+	}
+	return MStatus::kSuccess;
+}
+
+MStatus MELScriptCommand::redoIt() {
+	// the modifier recorded the native commands and the MEL lines, redo replays them without running the scripts
+	if (!mModifier)
+		return MStatus::kSuccess;
+	return mModifier->doIt();
+}
+
+MStatus MELScriptCommand::undoIt() {
+	if (!mModifier)
+		return MStatus::kSuccess;
+	return mModifier->undoIt();
 }
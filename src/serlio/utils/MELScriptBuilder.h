@@ -21,14 +21,22 @@
 
 #include "utils/MayaUtilities.h"
 
+#include "maya/MDGModifier.h"
 #include "maya/MGlobal.h"
+#include "maya/MPxCommand.h"
 
 #include <array>
 #include <cassert>
+#include <functional>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 class MaterialColor;
+struct MELCommandContext;
+
+using MELCommand = std::function<MStatus(MELCommandContext&)>;
 
 class MELVariable : public mu::NamedType<std::wstring, MELVariable> {
 public:
@@ -47,6 +55,12 @@ public:
 	}
 };
 
+/**
+ * Records shading network commands and executes them natively: nodes are created, plugs set and connected in a
+ * single MDGModifier. Only shaderfx, python and set commands are still run as MEL, through the same modifier, so they
+ * need to be undoable. The MEL equivalent of all commands is kept as a debug dump. Scripts executed on idle are undone
+ * and redone as one step by MELScriptCommand.
+ */
 class MELScriptBuilder {
 public:
 	void setAttr(const MELVariable& node, const std::wstring& attribute, bool val);
@@ -80,9 +94,36 @@ public:
 	void python(const std::wstring& pythonCmd);
 	void addCmdLine(const std::wstring& line);
 
-	MStatus executeSync(std::wstring& output);
-	MStatus execute();
+	// result receives the value of resultVariable after the commands ran
+	MStatus executeSync(const MELVariable& resultVariable, std::wstring& result);
+	MStatus execute(); // executes the commands on idle, as one undoable command
+
+	std::wstring getScript() const {
+		return commandStream.str();
+	}
 
 private:
 	std::wstringstream commandStream;
+	std::vector<MELCommand> commands;
+};
+
+constexpr const char* CMD_EXECUTE_SCRIPTS = "serlioExecuteScripts";
+
+// serlioExecuteScripts: runs all scripts scheduled by MELScriptBuilder::execute() so far, invoked on idle. The
+// native commands and the MEL lines of the scripts are all recorded in the modifier owned by the command, which
+// makes them undoable and redoable as one step.
+class MELScriptCommand : public MPxCommand {
+public:
+	static void cancelPending(); // drops the scheduled scripts, e.g. before the plug-in gets unloaded
+
+	MStatus doIt(const MArgList& args) override;
+	MStatus redoIt() override;
+	MStatus undoIt() override;
+	bool isUndoable() const override {
+		return !mScripts.empty();
+	}
+
+private:
+	std::vector<std::vector<MELCommand>> mScripts;
+	std::unique_ptr<MDGModifier> mModifier;
 };
@@ -15,10 +15,13 @@
 namespace mu {
 
 int32_t computeSeed(const MFloatPointArray& vertices);
-int32_t computeSeed(const double* vertices, size_t count);
 
 void statusCheck(const MStatus& status, const char* file, int line);
 
+// the thread which registered the plugin, only there the graph may be changed and user input can be polled
+void setMainThread();
+bool isMainThread();
+
 template <typename F>
 void forAllAttributes(const MFnDependencyNode& node, F func) {
 	for (unsigned int i = 0; i < node.attributeCount(); i++) {
@@ -0,0 +1,120 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/PRTCacheManager.h"
+#include "utils/LogHandler.h"
+
+#include <iterator>
+
+namespace {
+
+constexpr bool DBG = false;
+
+// the prt cache uses the URIs of the resolve map as keys for rule files, assets and textures
+void flushResolveMap(prt::Cache& cache, const prt::ResolveMap& resolveMap) {
+	size_t keyCount = 0;
+	wchar_t const* const* keys = resolveMap.getKeys(&keyCount);
+	for (size_t k = 0; k < keyCount; k++) {
+		const wchar_t* uri = resolveMap.getString(keys[k]);
+		if (uri != nullptr)
+			cache.flushEntry(uri);
+	}
+}
+
+} // namespace
+
+void PRTCacheManager::touch(const std::wstring& rpk, const ResolveMapSPtr& resolveMap) {
+	if (!resolveMap)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto it = mIndex.find(rpk);
+	if (it != mIndex.end() && it->second->mResolveMap == resolveMap) {
+		mEntries.splice(mEntries.begin(), mEntries, it->second);
+		mStats.hits++;
+		return;
+	}
+
+	// a different resolve map for a known rpk means the rpk has been reloaded
+	if (it != mIndex.end())
+		flushEntry(it->second);
+
+	mStats.misses++;
+	const int64_t size = prtu::getFileSize(rpk);
+	mEntries.push_front({rpk, resolveMap, (size > 0) ? static_cast<size_t>(size) : 0});
+	mIndex[rpk] = mEntries.begin();
+	mMemorySize += mEntries.front().mMemorySize;
+
+	evict(&mEntries.front());
+}
+
+void PRTCacheManager::flush(const std::wstring& rpk, const ResolveMapSPtr& resolveMap) {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto it = mIndex.find(rpk);
+	if (it != mIndex.end())
+		flushEntry(it->second);
+	else if (resolveMap) {
+		flushResolveMap(mCache, *resolveMap);
+		mStats.flushes++;
+	}
+}
+
+void PRTCacheManager::flushAll() {
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mCache.flushAll();
+	mStats.flushes += mEntries.size();
+	mEntries.clear();
+	mIndex.clear();
+	mMemorySize = 0;
+}
+
+void PRTCacheManager::setMemoryBudget(size_t memoryBudget) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMemoryBudget = memoryBudget;
+	evict(nullptr);
+}
+
+PRTCacheManager::Stats PRTCacheManager::getStats() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	Stats stats = mStats;
+	stats.rulePackages = mEntries.size();
+	stats.memorySize = mMemorySize;
+	stats.memoryBudget = mMemoryBudget;
+	return stats;
+}
+
+// expects mMutex to be locked
+void PRTCacheManager::flushEntry(EntryList::iterator it) {
+	if (DBG)
+		LOG_DBG << "flushing prt cache entries of " << it->mRPK;
+	flushResolveMap(mCache, *it->mResolveMap);
+	mStats.flushes++;
+	mMemorySize -= it->mMemorySize;
+	mIndex.erase(it->mRPK);
+	mEntries.erase(it);
+}
+
+// expects mMutex to be locked, never evicts the entry in use
+void PRTCacheManager::evict(const Entry* keep) {
+	while (mMemorySize > mMemoryBudget && !mEntries.empty() && &mEntries.back() != keep)
+		flushEntry(std::prev(mEntries.end()));
+}
@@ -0,0 +1,84 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Utilities.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * Bounds the PRT cache, which otherwise keeps the rule files, assets and textures of every rule package ever used in
+ * the session. PRT does not report the size of its cache, therefore each rule package is accounted with the size of
+ * its rpk file. If the budget is exceeded, the entries of the least recently used rule packages are flushed.
+ */
+class SRL_TEST_EXPORTS_API PRTCacheManager {
+public:
+	struct Stats {
+		size_t rulePackages = 0;
+		size_t memorySize = 0; // estimated, in bytes
+		size_t memoryBudget = 0;
+		size_t hits = 0;   // uses of a rule package which was still cached
+		size_t misses = 0; // first uses and uses after a flush
+		size_t flushes = 0;
+	};
+
+	PRTCacheManager(prt::Cache& cache, size_t memoryBudget) : mCache(cache), mMemoryBudget(memoryBudget) {}
+	PRTCacheManager(const PRTCacheManager&) = delete;
+	PRTCacheManager(PRTCacheManager&&) = delete;
+	PRTCacheManager& operator=(PRTCacheManager const&) = delete;
+	PRTCacheManager& operator=(PRTCacheManager&&) = delete;
+	~PRTCacheManager() = default;
+
+	// call whenever a rule package is used for generation
+	void touch(const std::wstring& rpk, const ResolveMapSPtr& resolveMap);
+
+	// removes all entries of the rule package from the prt cache, e.g. because the rpk changed on disk
+	void flush(const std::wstring& rpk, const ResolveMapSPtr& resolveMap);
+	void flushAll();
+
+	// in bytes, a budget of 0 flushes every rule package as soon as another one is used
+	void setMemoryBudget(size_t memoryBudget);
+	Stats getStats() const;
+
+private:
+	struct Entry {
+		std::wstring mRPK;
+		ResolveMapSPtr mResolveMap;
+		size_t mMemorySize;
+	};
+	using EntryList = std::list<Entry>; // most recently used first
+
+	void flushEntry(EntryList::iterator it);
+	void evict(const Entry* keep);
+
+	prt::Cache& mCache;
+	size_t mMemoryBudget;
+	size_t mMemorySize = 0;
+	EntryList mEntries;
+	std::map<std::wstring, EntryList::iterator> mIndex;
+	Stats mStats;
+	mutable std::mutex mMutex;
+};
+
+using PRTCacheManagerUPtr = std::unique_ptr<PRTCacheManager>;
@@ -0,0 +1,341 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/RPKUnpackStore.h"
+#include "utils/LogHandler.h"
+
+#ifdef _WIN32
+// workaround for  "combaseapi.h(229): error C2187: syntax error: 'identifier' was unexpected here" when using
+// /permissive-
+struct IUnknown;
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/file.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+constexpr bool DBG = false;
+
+constexpr const char* RESOLVE_MAP_HEADER = "SRLR 1"; // format version 1
+constexpr const wchar_t* RESOLVE_MAP_EXTENSION = L".srlrmap";
+constexpr const wchar_t* LOCK_EXTENSION = L".lock";
+
+// advisory lock on a file, also between processes. it is released when the object is destroyed.
+class FileLock {
+public:
+	explicit FileLock(const std::wstring& path) : mPath(path) {
+#ifdef _WIN32
+		mFile = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		                    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+		mFile = open(prtu::toOSNarrowFromUTF16(path).c_str(), O_RDWR | O_CREAT, 0666);
+#endif
+	}
+
+	FileLock(const FileLock&) = delete;
+	FileLock& operator=(const FileLock&) = delete;
+
+	~FileLock() {
+#ifdef _WIN32
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+#else
+		if (mFile >= 0)
+			close(mFile);
+#endif
+	}
+
+	bool lockExclusive(bool wait) {
+#ifdef _WIN32
+		OVERLAPPED overlapped = {};
+		const DWORD flags = LOCKFILE_EXCLUSIVE_LOCK | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+		return mFile != INVALID_HANDLE_VALUE && LockFileEx(mFile, flags, 0, 1, 0, &overlapped) != 0;
+#else
+		return mFile >= 0 && setLock(F_WRLCK, wait);
+#endif
+	}
+
+	// keeps other sessions from removing the entry while still allowing them to use it, without ever unlocking it
+	void downgradeToShared() {
+#ifdef _WIN32
+		// a handle may hold both locks on the same range, the first unlock releases the exclusive one
+		OVERLAPPED overlapped = {};
+		LockFileEx(mFile, 0, 0, 1, 0, &overlapped);
+		overlapped = {};
+		UnlockFileEx(mFile, 0, 1, 0, &overlapped);
+#else
+		setLock(F_RDLCK, true);
+#endif
+	}
+
+	// false if the lock file was removed (together with its entry) while we waited for the lock
+	bool isLinked() const {
+#ifdef _WIN32
+		// lock files are only removed while no other session has them open, see remove()
+		return true;
+#else
+		struct stat opened, current;
+		return fstat(mFile, &opened) == 0 && stat(prtu::toOSNarrowFromUTF16(mPath).c_str(), &current) == 0 &&
+		       opened.st_dev == current.st_dev && opened.st_ino == current.st_ino;
+#endif
+	}
+
+	// removes the lock file of a removed entry and releases the lock
+	void remove() {
+#ifdef _WIN32
+		// fails if another session opened the file in the meantime, it then simply keeps using it
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+		DeleteFileW(mPath.c_str());
+#else
+		// sessions already waiting for the lock notice the removal with isLinked() and retry with a new file
+		unlink(prtu::toOSNarrowFromUTF16(mPath).c_str());
+		close(mFile);
+		mFile = -1;
+#endif
+	}
+
+	// the modification time of the lock file records the last use of the entry
+	void touch() {
+#ifdef _WIN32
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		SetFileTime(mFile, nullptr, nullptr, &now);
+#else
+		futimens(mFile, nullptr);
+#endif
+	}
+
+private:
+#ifndef _WIN32
+	// open file description locks (unlike flock) convert atomically between exclusive and shared and (unlike
+	// classic fcntl locks) also conflict between descriptors of the same process
+	bool setLock(short type, bool wait) {
+#	ifdef F_OFD_SETLK
+		struct flock range = {};
+		range.l_type = type;
+		range.l_whence = SEEK_SET;
+		range.l_len = 1;
+		return fcntl(mFile, wait ? F_OFD_SETLKW : F_OFD_SETLK, &range) == 0;
+#	else
+		// no atomic conversion available (e.g. macOS), another session might briefly grab the lock in between
+		return flock(mFile, (type == F_WRLCK ? LOCK_EX : LOCK_SH) | (wait ? 0 : LOCK_NB)) == 0;
+#	endif
+	}
+#endif
+
+	const std::wstring mPath;
+#ifdef _WIN32
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+#else
+	int mFile = -1;
+#endif
+};
+
+using FileLockSPtr = std::shared_ptr<FileLock>;
+
+std::wstring getEntryName(uint64_t fingerprint) {
+	wchar_t name[17];
+	std::swprintf(name, 17, L"%016llx", static_cast<unsigned long long>(fingerprint));
+	return name;
+}
+
+bool endsWith(const std::wstring& s, const std::wstring& suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// header line, then one line per entry with key and URI separated by a tab, both UTF-8 encoded
+void writeResolveMap(const std::wstring& path, const prt::ResolveMap& resolveMap, int64_t rpkSize) {
+	const std::string narrowPath = prtu::toOSNarrowFromUTF16(path);
+	const std::string tmpPath = narrowPath + ".tmp";
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		out << RESOLVE_MAP_HEADER << '\t' << rpkSize << '\n';
+
+		size_t keyCount = 0;
+		const wchar_t* const* keys = resolveMap.getKeys(&keyCount);
+		for (size_t k = 0; k < keyCount; k++) {
+			const wchar_t* value = resolveMap.getString(keys[k]);
+			if (value != nullptr)
+				out << prtu::toUTF8FromUTF16(keys[k]) << '\t' << prtu::toUTF8FromUTF16(value) << '\n';
+		}
+
+		if (!out) {
+			LOG_WRN << "failed to write resolve map " << path;
+			out.close();
+			std::remove(tmpPath.c_str());
+			return;
+		}
+	}
+
+	// the resolve map file marks the entry as complete, so it must never be seen partially written
+	std::remove(narrowPath.c_str());
+	if (std::rename(tmpPath.c_str(), narrowPath.c_str()) != 0)
+		std::remove(tmpPath.c_str());
+}
+
+std::istream& readHeader(std::istream& in, int64_t& rpkSize) {
+	std::string line;
+	if (!std::getline(in, line))
+		return in;
+	std::istringstream header(line);
+	std::string magic, version;
+	if (!(header >> magic >> version >> rpkSize) || (magic + ' ' + version) != RESOLVE_MAP_HEADER)
+		in.setstate(std::ios::failbit);
+	return in;
+}
+
+ResolveMapSPtr readResolveMap(const std::wstring& path) {
+	std::ifstream in(prtu::toOSNarrowFromUTF16(path), std::ios::binary);
+	int64_t rpkSize = 0;
+	if (!readHeader(in, rpkSize))
+		return {};
+
+	ResolveMapBuilderUPtr builder(prt::ResolveMapBuilder::create());
+	std::string line;
+	while (std::getline(in, line)) {
+		const size_t tab = line.find('\t');
+		if (tab == std::string::npos)
+			return {};
+		const std::wstring key = prtu::toUTF16FromUTF8(line.substr(0, tab));
+		const std::wstring value = prtu::toUTF16FromUTF8(line.substr(tab + 1));
+		builder->addEntry(key.c_str(), value.c_str());
+	}
+	if (in.bad())
+		return {};
+	return ResolveMapSPtr(builder->createResolveMap(), PRTDestroyer());
+}
+
+int64_t readRPKSize(const std::wstring& path) {
+	std::ifstream in(prtu::toOSNarrowFromUTF16(path), std::ios::binary);
+	int64_t rpkSize = 0;
+	return readHeader(in, rpkSize) ? rpkSize : 0;
+}
+
+} // namespace
+
+RPKUnpackStore::RPKUnpackStore(const std::wstring& directory, uint64_t sizeBudget)
+    : mDirectory(directory), mSizeBudget(sizeBudget) {
+	if (!prtu::create_directory(mDirectory))
+		LOG_WRN << "cannot create the rule package unpack store " << mDirectory;
+}
+
+ResolveMapSPtr RPKUnpackStore::getResolveMap(const std::wstring& rpk, uint64_t fingerprint) const {
+	if (fingerprint == 0)
+		return {};
+
+	const std::wstring entryPath = mDirectory + prtu::getDirSeparator<wchar_t>() + getEntryName(fingerprint);
+	const std::wstring resolveMapPath = entryPath + RESOLVE_MAP_EXTENSION;
+
+	// waits while another session unpacks the same rpk
+	FileLockSPtr lock;
+	do {
+		lock = std::make_shared<FileLock>(entryPath + LOCK_EXTENSION);
+		if (!lock->lockExclusive(true)) {
+			LOG_WRN << "cannot lock rule package unpack store entry " << entryPath;
+			return {};
+		}
+	} while (!lock->isLinked());
+
+	ResolveMapSPtr resolveMap;
+	if (prtu::getFileModificationTime(entryPath) != -1)
+		resolveMap = readResolveMap(resolveMapPath);
+
+	const bool unpacked = !resolveMap;
+	if (!unpacked) {
+		if (DBG)
+			LOG_DBG << "reusing unpacked rpk " << rpk << " from " << entryPath;
+	}
+	else {
+		// there might be leftovers of an interrupted unpack
+		std::remove(prtu::toOSNarrowFromUTF16(resolveMapPath).c_str());
+		prtu::remove_all(entryPath);
+
+		const std::wstring rpkURI = prtu::toFileURI(rpk);
+		prt::Status status = prt::STATUS_UNSPECIFIED_ERROR;
+		resolveMap.reset(prt::createResolveMap(rpkURI.c_str(), entryPath.c_str(), &status), PRTDestroyer());
+		if (!resolveMap || status != prt::STATUS_OK)
+			return {};
+
+		writeResolveMap(resolveMapPath, *resolveMap, std::max<int64_t>(prtu::getFileSize(rpk), 0));
+		if (DBG)
+			LOG_DBG << "unpacked rpk " << rpk << " to " << entryPath;
+	}
+
+	lock->touch();
+	lock->downgradeToShared();
+
+	// other sessions skip this entry during cleanup as long as the resolve map (and therefore the lock) is alive.
+	// only a new unpack can exceed the budget, so reusing an entry does not scan the whole store.
+	if (unpacked)
+		removeLeastRecentlyUsed();
+	return ResolveMapSPtr(resolveMap.get(), [resolveMap, lock](const prt::ResolveMap*) {});
+}
+
+void RPKUnpackStore::removeLeastRecentlyUsed() const {
+	struct Entry {
+		std::wstring path;
+		time_t lastUse;
+		int64_t size;
+	};
+	std::vector<Entry> entries;
+	uint64_t totalSize = 0;
+
+	const std::wstring extension = RESOLVE_MAP_EXTENSION;
+	for (const std::wstring& name : prtu::list_directory(mDirectory)) {
+		if (!endsWith(name, extension))
+			continue;
+		const std::wstring path =
+		        mDirectory + prtu::getDirSeparator<wchar_t>() + name.substr(0, name.size() - extension.size());
+		const int64_t size = readRPKSize(path + extension);
+		entries.push_back({path, prtu::getFileModificationTime(path + LOCK_EXTENSION), size});
+		totalSize += static_cast<uint64_t>(size);
+	}
+	if (totalSize <= mSizeBudget)
+		return;
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+	for (const Entry& entry : entries) {
+		if (totalSize <= mSizeBudget)
+			break;
+
+		// entries still in use by any session (including this one) hold a shared lock
+		// (a lock file which is not linked anymore belongs to an entry another session removed in the meantime)
+		FileLock lock(entry.path + LOCK_EXTENSION);
+		if (!lock.lockExclusive(false) || !lock.isLinked())
+			continue;
+
+		std::remove(prtu::toOSNarrowFromUTF16(entry.path + extension).c_str());
+		prtu::remove_all(entry.path);
+		lock.remove();
+		totalSize -= static_cast<uint64_t>(entry.size);
+		if (DBG)
+			LOG_DBG << "removed unpacked rpk " << entry.path << " from the unpack store";
+	}
+}
@@ -0,0 +1,60 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Utilities.h"
+
+#include <memory>
+#include <string>
+
+/**
+ * Optional persistent store of unpacked rule packages, shared by all sessions (and processes) using the same
+ * directory. Each rpk is unpacked once into a subdirectory named after its content fingerprint, its resolve map is
+ * written next to it so later sessions can rebuild it without unpacking again. Entries are protected by file locks:
+ * exclusive while unpacking, shared as long as a resolve map of the entry is alive. Like the PRT cache manager, the
+ * size of an entry is estimated by the size of its rpk file. Entries exceeding the budget are removed least recently
+ * used first, unless another session still uses them.
+ */
+class SRL_TEST_EXPORTS_API RPKUnpackStore {
+public:
+	static constexpr uint64_t DEFAULT_SIZE_BUDGET = 10ull * 1024 * 1024 * 1024;
+
+	RPKUnpackStore(const std::wstring& directory, uint64_t sizeBudget);
+	RPKUnpackStore(const RPKUnpackStore&) = delete;
+	RPKUnpackStore(RPKUnpackStore&&) = delete;
+	RPKUnpackStore& operator=(RPKUnpackStore const&) = delete;
+	RPKUnpackStore& operator=(RPKUnpackStore&&) = delete;
+	~RPKUnpackStore() = default;
+
+	// unpacks the rpk unless a previous session already did, nullptr on failure
+	ResolveMapSPtr getResolveMap(const std::wstring& rpk, uint64_t fingerprint) const;
+
+	const std::wstring& getDirectory() const {
+		return mDirectory;
+	}
+
+private:
+	void removeLeastRecentlyUsed() const;
+
+	const std::wstring mDirectory;
+	const uint64_t mSizeBudget; // in bytes
+};
+
+using RPKUnpackStoreSPtr = std::shared_ptr<RPKUnpackStore>;
@@ -21,7 +21,12 @@
 #include "utils/LogHandler.h"
 #include "utils/Utilities.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
 #include <mutex>
+#include <shared_mutex>
 
 namespace {
 
@@ -29,67 +34,489 @@ constexpr bool DBG = false;
 
 const ResolveMapSPtr RESOLVE_MAP_NONE;
 const ResolveMapCache::LookupResult LOOKUP_FAILURE = {RESOLVE_MAP_NONE, ResolveMapCache::CacheStatus::MISS};
-std::mutex resolveMapCacheMutex;
+
+// rpks on network shares are expensive to stat, so each rpk is checked for changes at most once per interval
+constexpr std::chrono::seconds RPK_CHANGE_CHECK_INTERVAL(1);
+
+template <typename T>
+bool isReady(const std::shared_future<T>& f) {
+	return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+	const auto duration = std::chrono::steady_clock::now() - start;
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+double toMilliseconds(uint64_t nanoseconds) {
+	return static_cast<double>(nanoseconds) / 1e6;
+}
+
+using SharedLock = std::shared_lock<std::shared_timed_mutex>;
+using UniqueLock = std::unique_lock<std::shared_timed_mutex>;
+
+// adds the time spent waiting for the lock to waitTime
+template <typename Lock>
+Lock acquire(std::shared_timed_mutex& mutex, std::atomic<uint64_t>& waitTime) {
+	const auto start = std::chrono::steady_clock::now();
+	Lock lock(mutex);
+	waitTime += nanosecondsSince(start);
+	return lock;
+}
+
+// rpks are either zip or 7z archives. Record signatures and sizes, see the PKWARE APPNOTE and the 7z format docs.
+constexpr uint32_t ZIP_EOCD_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP64_EOCD_LOCATOR_SIGNATURE = 0x07064b50;
+constexpr uint32_t ZIP64_EOCD_SIGNATURE = 0x06064b50;
+constexpr std::streamoff ZIP_EOCD_SIZE = 22;
+constexpr std::streamoff ZIP64_EOCD_LOCATOR_SIZE = 20;
+constexpr std::streamoff ZIP64_EOCD_SIZE = 56;
+constexpr std::streamoff ZIP_MAX_COMMENT_SIZE = 0xFFFF;
+constexpr char SEVENZIP_SIGNATURE[] = {'7', 'z', '\xBC', '\xAF', '\x27', '\x1C'};
+constexpr std::streamoff SEVENZIP_START_HEADER_SIZE = 32;
+
+uint32_t readLE32(const char* p) {
+	const auto* b = reinterpret_cast<const unsigned char*>(p);
+	return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) | (static_cast<uint32_t>(b[2]) << 16) |
+	       (static_cast<uint32_t>(b[3]) << 24);
+}
+
+uint64_t readLE64(const char* p) {
+	return static_cast<uint64_t>(readLE32(p)) | (static_cast<uint64_t>(readLE32(p + 4)) << 32);
+}
+
+// the 7z header at the end of the archive lists the files with their size and crc32, like the zip central directory
+bool findSevenZipHeader(std::istream& in, std::streamoff fileSize, std::streamoff& offset, std::streamoff& size) {
+	char startHeader[SEVENZIP_START_HEADER_SIZE];
+	in.seekg(0);
+	if (fileSize < SEVENZIP_START_HEADER_SIZE || !in.read(startHeader, SEVENZIP_START_HEADER_SIZE) ||
+	    !std::equal(std::begin(SEVENZIP_SIGNATURE), std::end(SEVENZIP_SIGNATURE), startHeader))
+		return false;
+
+	offset = SEVENZIP_START_HEADER_SIZE + static_cast<std::streamoff>(readLE64(startHeader + 12));
+	size = static_cast<std::streamoff>(readLE64(startHeader + 20));
+	return offset >= SEVENZIP_START_HEADER_SIZE && size >= 0 && offset + size <= fileSize;
+}
+
+bool findZipCentralDirectory(std::istream& in, std::streamoff fileSize, std::streamoff& offset,
+                             std::streamoff& size) {
+	// the end of central directory record closes the archive, only followed by a comment of up to 64k
+	const std::streamoff tailSize = std::min(fileSize, ZIP_EOCD_SIZE + ZIP_MAX_COMMENT_SIZE);
+	std::vector<char> tail(static_cast<size_t>(tailSize));
+	in.seekg(fileSize - tailSize);
+	if (!in.read(tail.data(), tailSize))
+		return false;
+
+	std::streamoff eocd = tailSize - ZIP_EOCD_SIZE;
+	while (eocd >= 0 && readLE32(tail.data() + eocd) != ZIP_EOCD_SIGNATURE)
+		eocd--;
+	if (eocd < 0)
+		return false;
+
+	size = readLE32(tail.data() + eocd + 12);
+	offset = readLE32(tail.data() + eocd + 16);
+	if (size == 0xFFFFFFFF || offset == 0xFFFFFFFF) {
+		// zip64: the locator in front of the record points to the zip64 end of central directory record
+		if (eocd < ZIP64_EOCD_LOCATOR_SIZE)
+			return false;
+		const char* locator = tail.data() + eocd - ZIP64_EOCD_LOCATOR_SIZE;
+		if (readLE32(locator) != ZIP64_EOCD_LOCATOR_SIGNATURE)
+			return false;
+
+		char record[ZIP64_EOCD_SIZE];
+		in.seekg(static_cast<std::streamoff>(readLE64(locator + 8)));
+		if (!in.read(record, ZIP64_EOCD_SIZE) || readLE32(record) != ZIP64_EOCD_SIGNATURE)
+			return false;
+		size = static_cast<std::streamoff>(readLE64(record + 40));
+		offset = static_cast<std::streamoff>(readLE64(record + 48));
+	}
+	return offset >= 0 && size >= 0 && offset + size <= fileSize;
+}
+
+// size of the rpk and hash of its archive directory, which lists name, size and crc32 of every file. Only reads a
+// small part of the rpk instead of the whole archive. Stable across sessions, 0 if the rpk cannot be read.
+uint64_t fingerprintRPK(const std::wstring& rpk) {
+	std::ifstream in(prtu::toOSNarrowFromUTF16(rpk), std::ios::binary);
+	if (!in)
+		return 0;
+
+	in.seekg(0, std::ios::end);
+	const std::streamoff fileSize = in.tellg();
+	if (fileSize <= 0)
+		return 0;
+
+	std::streamoff offset = 0;
+	std::streamoff size = fileSize;
+	if (!findSevenZipHeader(in, fileSize, offset, size)) {
+		in.clear();
+		if (!findZipCentralDirectory(in, fileSize, offset, size)) {
+			in.clear(); // unknown format, hash all of it
+			offset = 0;
+			size = fileSize;
+		}
+	}
+
+	uint64_t h = prtu::hashCombine(prtu::HASH_OFFSET_BASIS, static_cast<uint64_t>(fileSize));
+	std::vector<char> buffer(static_cast<size_t>(std::min<std::streamoff>(size, 1 << 20)));
+	in.seekg(offset);
+	while (size > 0) {
+		const std::streamoff count = std::min<std::streamoff>(size, static_cast<std::streamoff>(buffer.size()));
+		if (!in.read(buffer.data(), count))
+			return 0;
+		h = prtu::hash(buffer.data(), static_cast<size_t>(count), h);
+		size -= count;
+	}
+	return h;
+}
 
 } // namespace
 
+// removes the unpack directories of released resolve maps without blocking the thread releasing them
+struct ResolveMapCache::DirectoryRemover {
+	std::vector<std::shared_future<void>> mRemovals; // joined on destruction
+	std::mutex mMutex;
+
+	void remove(const std::wstring& directory) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRemovals.erase(std::remove_if(mRemovals.begin(), mRemovals.end(), isReady<void>), mRemovals.end());
+		mRemovals.push_back(std::async(std::launch::async, [directory]() { prtu::remove_all(directory); }).share());
+		if (DBG)
+			LOG_DBG << "removing unpack directory " << directory << ", " << mRemovals.size() << " removals pending";
+	}
+
+	void wait() {
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (const auto& removal : mRemovals)
+			removal.wait();
+	}
+};
+
+ResolveMapCache::ResolveMapCache(const std::wstring& unpackPath, InvalidationCallback invalidationCallback)
+    : mRPKUnpackPath{unpackPath}, mTextureRoot{unpackPath + prtu::getDirSeparator<wchar_t>() + L"textures"},
+      mInvalidationCallback{std::move(invalidationCallback)}, mDirectoryRemover{std::make_shared<DirectoryRemover>()} {}
+
 ResolveMapCache::~ResolveMapCache() {
+	for (const auto& prefetch : mPrefetches)
+		prefetch.wait();
+	mDirectoryRemover->wait();
+
 	if (!mRPKUnpackPath.empty())
 		prtu::remove_all(mRPKUnpackPath);
 	if (DBG)
 		LOG_DBG << "Removed RPK unpack directory";
+
+	const Stats stats = getStats();
+	if (stats.hits + stats.misses + stats.failures > 0) {
+		LOG_INF << "resolve map cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.failures
+		        << " failures, " << stats.invalidations << " invalidations, " << stats.evictions << " evictions, "
+		        << stats.unpackedSize << " bytes unpacked in " << stats.unpackTime << " ms, waited "
+		        << stats.unpackWaitTime << " ms for unpacks and " << stats.lockWaitTime << " ms for locks, "
+		        << stats.fingerprintTime << " ms fingerprinting";
+	}
 }
 
 ResolveMapCache::LookupResult ResolveMapCache::get(const std::wstring& rpk) {
+	const auto now = std::chrono::steady_clock::now();
+
+	std::shared_future<ResolveMapSPtr> resolveMap;
+	{
+		// cache hits only need the shared lock, recently checked rpks not even a stat
+		const SharedLock lock = acquire<SharedLock>(mCacheMutex, mCounters.lockWaitTime);
+		const auto it = mCache.find(rpk);
+		if (it != mCache.end() && now - it->second.mLastCheck.load() < RPK_CHANGE_CHECK_INTERVAL) {
+			it->second.mLastUse = now;
+			resolveMap = it->second.mResolveMap;
+		}
+	}
 
-	std::lock_guard<std::mutex> lock(resolveMapCacheMutex);
+	time_t timeStamp = 0;
+	if (!resolveMap.valid()) {
+		timeStamp = prtu::getFileModificationTime(rpk);
+		if (DBG)
+			LOG_DBG << "rpk: " << rpk << " current timestamp: " << timeStamp;
 
-	const time_t timeStamp = prtu::getFileModificationTime(rpk);
-	if (DBG)
-		LOG_DBG << "rpk: " << rpk << " current timestamp: " << timeStamp;
+		// verify timestamp
+		if (timeStamp == -1) {
+			mCounters.failures++;
+			return LOOKUP_FAILURE;
+		}
 
-	// verify timestamp
-	if (timeStamp == -1)
-		return LOOKUP_FAILURE;
+		// an unchanged timestamp is trusted unless the rpk was written in the second its fingerprint was taken
+		const SharedLock lock = acquire<SharedLock>(mCacheMutex, mCounters.lockWaitTime);
+		const auto it = mCache.find(rpk);
+		if (it != mCache.end() && it->second.mTimeStamp == timeStamp && timeStamp < it->second.mFingerprintTime) {
+			it->second.mLastCheck = now;
+			it->second.mLastUse = now;
+			resolveMap = it->second.mResolveMap;
+		}
+	}
 
-	CacheStatus cs = CacheStatus::HIT;
-	auto it = mCache.find(rpk);
-	if (it != mCache.end()) {
+	// the timestamp is only a hint, e.g. syncs touch rpks without changing them. The content decides.
+	uint64_t fingerprint = 0;
+	time_t fingerprintTime = 0;
+	if (!resolveMap.valid()) {
+		const auto start = std::chrono::steady_clock::now();
+		fingerprintTime = std::time(nullptr);
+		fingerprint = fingerprintRPK(rpk);
+		mCounters.fingerprintTime += nanosecondsSince(start);
 		if (DBG)
-			LOG_DBG << "rpk: cache timestamp: " << it->second.mTimeStamp;
-		if (it->second.mTimeStamp != timeStamp) {
-			mCache.erase(it);
-			std::wstring filename = prtu::filename(rpk);
+			LOG_DBG << "rpk: " << rpk << " current fingerprint: " << fingerprint;
+		if (fingerprint == 0) {
+			mCounters.failures++;
+			return LOOKUP_FAILURE;
+		}
+	}
 
-			if (!mRPKUnpackPath.empty() && !filename.empty())
-				prtu::remove_all(mRPKUnpackPath + prtu::getDirSeparator<std::wstring>() + prtu::filename(rpk));
+	CacheStatus cs = CacheStatus::HIT;
+	std::promise<ResolveMapSPtr> unpacked;
+	RPKUnpackStoreSPtr unpackStore;
+	while (!resolveMap.valid()) {
+		UniqueLock lock = acquire<UniqueLock>(mCacheMutex, mCounters.lockWaitTime);
+		auto it = mCache.find(rpk);
+		if (it != mCache.end()) {
+			if (DBG)
+				LOG_DBG << "rpk: cache fingerprint: " << it->second.mFingerprint;
+			if (it->second.mFingerprint == fingerprint) {
+				// unchanged or another lookup was faster
+				it->second.mTimeStamp = timeStamp;
+				it->second.mFingerprintTime = fingerprintTime;
+				it->second.mLastCheck = now;
+				it->second.mLastUse = now;
+				resolveMap = it->second.mResolveMap;
+				break;
+			}
+
+			// the invalidation callback needs the outdated resolve map, let its unpack finish first
+			if (!isReady(it->second.mResolveMap)) {
+				const std::shared_future<ResolveMapSPtr> outdated = it->second.mResolveMap;
+				lock.unlock();
+				outdated.wait();
+				continue;
+			}
 
 			if (DBG)
 				LOG_DBG << "RPK change detected, forcing reload and clearing cache for " << rpk;
-			cs = CacheStatus::MISS;
+			invalidate(it);
+			mCounters.invalidations++;
 		}
-	}
-	else
+
+		ResolveMapCacheEntry& rmce = mCache[rpk];
+		rmce.mTimeStamp = timeStamp;
+		rmce.mFingerprint = fingerprint;
+		rmce.mFingerprintTime = fingerprintTime;
+		rmce.mLastCheck = now;
+		rmce.mLastUse = now;
+		rmce.mResolveMap = unpacked.get_future().share();
+		resolveMap = rmce.mResolveMap;
+		unpackStore = mUnpackStore;
 		cs = CacheStatus::MISS;
+	}
 
 	if (cs == CacheStatus::MISS) {
+		// unpack without holding the lock, lookups of this rpk wait on the future meanwhile
+		const auto start = std::chrono::steady_clock::now();
+		ResolveMapSPtr rm;
+		const bool zeroExtract = mZeroExtract;
+		if (unpackStore && !zeroExtract)
+			rm = unpackStore->getResolveMap(rpk, fingerprint);
 
-		const auto rpkURI = prtu::toFileURI(rpk);
+		prt::Status status = prt::STATUS_OK;
+		uint64_t assetLocation = 0;
+		if (!rm)
+			rm = createResolveMap(rpk, zeroExtract, assetLocation, status);
+		mCounters.unpackTime += nanosecondsSince(start);
 
-		ResolveMapCacheEntry rmce;
-		rmce.mTimeStamp = timeStamp;
+		if (status != prt::STATUS_OK) {
+			// drop the entry before waking up the waiting lookups, so the next get() tries again
+			{
+				const UniqueLock lock = acquire<UniqueLock>(mCacheMutex, mCounters.lockWaitTime);
+				mCache.erase(rpk);
+			}
+			unpacked.set_value(RESOLVE_MAP_NONE);
+			mCounters.failures++;
+			return LOOKUP_FAILURE;
+		}
 
-		prt::Status status = prt::STATUS_UNSPECIFIED_ERROR;
+		// the directory only depends on the content, so later unpacks of the same content reuse the extracted textures
+		const std::wstring textureDirectory = zeroExtract ? createTextureDirectory(fingerprint) : std::wstring();
+
+		const int64_t size = prtu::getFileSize(rpk);
+		mCounters.misses++;
+		mCounters.unpackedSize += (size > 0) ? static_cast<uint64_t>(size) : 0;
+		{
+			const UniqueLock lock = acquire<UniqueLock>(mCacheMutex, mCounters.lockWaitTime);
+			const auto it = mCache.find(rpk);
+			if (it != mCache.end() && it->second.mFingerprint == fingerprint) {
+				it->second.mSize = (size > 0) ? static_cast<uint64_t>(size) : 0;
+				it->second.mAssetLocation = assetLocation;
+				it->second.mTextureDirectory = textureDirectory;
+			}
+			evict(rpk);
+		}
+
+		unpacked.set_value(rm);
 		if (DBG)
-			LOG_DBG << "createResolveMap from " << rpk;
-		rmce.mResolveMap.reset(prt::createResolveMap(rpkURI.c_str(), mRPKUnpackPath.c_str(), &status), PRTDestroyer());
-		if (status != prt::STATUS_OK)
-			return LOOKUP_FAILURE;
+			LOG_DBG << "Unpacked RPK " << rpk;
+		return {rm, cs};
+	}
+
+	if (!isReady(resolveMap)) {
+		const auto start = std::chrono::steady_clock::now();
+		resolveMap.wait();
+		mCounters.unpackWaitTime += nanosecondsSince(start);
+	}
+
+	const ResolveMapSPtr& rm = resolveMap.get();
+	if (!rm) {
+		mCounters.failures++;
+		return LOOKUP_FAILURE;
+	}
+	mCounters.hits++;
+	return {rm, cs};
+}
+
+void ResolveMapCache::invalidate(Cache::iterator it) {
+	// the unpack directory stays until the last user of the resolve map is gone, see createResolveMap()
+	if (mInvalidationCallback && it->second.mResolveMap.get())
+		mInvalidationCallback(it->first, it->second.mResolveMap.get(), it->second.mAssetLocation);
+	mCache.erase(it);
+}
+
+// expects mCacheMutex to be locked exclusively, never evicts the entry in use or pending unpacks
+void ResolveMapCache::evict(const KeyType& keep) {
+	while (true) {
+		uint64_t size = 0;
+		auto lru = mCache.end();
+		for (auto it = mCache.begin(); it != mCache.end(); ++it) {
+			size += it->second.mSize;
+			if (it->first == keep || !isReady(it->second.mResolveMap))
+				continue;
+			if (lru == mCache.end() || it->second.mLastUse.load() < lru->second.mLastUse.load())
+				lru = it;
+		}
+
+		if ((mCache.size() <= mMaxEntries && size <= mMaxSize) || lru == mCache.end())
+			return;
 
-		it = mCache.emplace(rpk, std::move(rmce)).first;
 		if (DBG)
-			LOG_DBG << "Upacked RPK " << rpk << " to " << mRPKUnpackPath;
+			LOG_DBG << "evicting resolve map of " << lru->first << ", " << mCache.size() << " rpks with " << size
+			        << " bytes cached";
+		invalidate(lru);
+		mCounters.evictions++;
+	}
+}
+
+ResolveMapSPtr ResolveMapCache::createResolveMap(const std::wstring& rpk, bool zeroExtract, uint64_t& assetLocation,
+                                                 prt::Status& status) {
+	const auto rpkURI = prtu::toFileURI(rpk);
+	if (DBG)
+		LOG_DBG << "createResolveMap from " << rpk;
+
+	if (zeroExtract)
+		return {prt::createResolveMap(rpkURI.c_str(), nullptr, &status), PRTDestroyer()};
+
+	// a separate unpack directory per resolve map, so concurrent unpacks (get() only serializes lookups of the same
+	// rpk) never write into the same directory and nodes can keep using an outdated or evicted one meanwhile
+	const std::wstring unpackPath =
+	        mRPKUnpackPath + prtu::getDirSeparator<wchar_t>() + L"rpk_" + std::to_wstring(++mUnpackCounter);
+	prtu::remove_all(unpackPath); // leftovers of a crashed session which had the same process id
+	assetLocation = prtu::hash(unpackPath);
+	const std::shared_ptr<DirectoryRemover> directoryRemover = mDirectoryRemover;
+	auto destroy = [directoryRemover, unpackPath](const prt::ResolveMap* resolveMap) {
+		PRTDestroyer()(resolveMap); // releases the unpacked files
+		directoryRemover->remove(unpackPath);
+	};
+	return {prt::createResolveMap(rpkURI.c_str(), unpackPath.c_str(), &status), destroy};
+}
+
+void ResolveMapCache::setLimits(size_t maxEntries, uint64_t maxSize) {
+	std::lock_guard<std::shared_timed_mutex> lock(mCacheMutex);
+	mMaxEntries = maxEntries;
+	mMaxSize = maxSize;
+	evict({});
+}
+
+void ResolveMapCache::setUnpackStore(RPKUnpackStoreSPtr unpackStore) {
+	std::lock_guard<std::shared_timed_mutex> lock(mCacheMutex);
+	mUnpackStore = std::move(unpackStore);
+}
+
+void ResolveMapCache::setZeroExtract(bool zeroExtract) {
+	// the maya encoder expects the texture directory to exist
+	if (zeroExtract && !(prtu::create_directory(mRPKUnpackPath) && prtu::create_directory(mTextureRoot))) {
+		LOG_WRN << "cannot create the texture directory " << mTextureRoot << ", rule packages are unpacked";
+		return;
+	}
+	mZeroExtract = zeroExtract;
+}
+
+void ResolveMapCache::setTextureRoot(const std::wstring& textureRoot) {
+	mTextureRoot = textureRoot;
+}
+
+std::wstring ResolveMapCache::getTextureDirectory(const std::wstring& rpk) const {
+	const SharedLock lock(mCacheMutex);
+	const auto it = mCache.find(rpk);
+	return (it != mCache.end()) ? it->second.mTextureDirectory : std::wstring();
+}
+
+std::wstring ResolveMapCache::createTextureDirectory(uint64_t fingerprint) const {
+	wchar_t name[17];
+	std::swprintf(name, 17, L"%016llx", static_cast<unsigned long long>(fingerprint));
+	const std::wstring directory = mTextureRoot + prtu::getDirSeparator<wchar_t>() + name;
+	if (!prtu::create_directory(directory)) {
+		LOG_WRN << "cannot create the texture directory " << directory;
+		return {};
 	}
+	return directory;
+}
+
+std::shared_future<void> ResolveMapCache::prefetch(const std::wstring& rpk) {
+	// a compute asking for the same rpk meanwhile waits for this unpack instead of starting its own
+	auto unpack = [this, rpk]() {
+		if (get(rpk).first == nullptr)
+			LOG_WRN << "failed to prefetch rule package " << rpk;
+	};
+	std::shared_future<void> prefetch = std::async(std::launch::async, unpack).share();
+
+	std::lock_guard<std::mutex> lock(mPrefetchesMutex);
+	mPrefetches.erase(std::remove_if(mPrefetches.begin(), mPrefetches.end(), isReady<void>), mPrefetches.end());
+	mPrefetches.push_back(prefetch);
+
+	if (DBG)
+		LOG_DBG << "started prefetch of " << rpk << ", " << mPrefetches.size() << " prefetches pending";
 
-	return {it->second.mResolveMap, cs};
+	return prefetch;
+}
+
+uint64_t ResolveMapCache::getFingerprint(const std::wstring& rpk) {
+	// get() replaces the entry if the rpk changes on disk, which also replaces the fingerprint
+	std::shared_lock<std::shared_timed_mutex> lock(mCacheMutex);
+	const auto it = mCache.find(rpk);
+	return (it != mCache.end()) ? it->second.mFingerprint : 0;
+}
+
+uint64_t ResolveMapCache::getAssetLocation(const std::wstring& rpk) {
+	std::shared_lock<std::shared_timed_mutex> lock(mCacheMutex);
+	const auto it = mCache.find(rpk);
+	return (it != mCache.end()) ? it->second.mAssetLocation : 0;
+}
+
+ResolveMapCache::Stats ResolveMapCache::getStats() const {
+	Stats stats;
+	{
+		const SharedLock lock(mCacheMutex);
+		stats.rulePackages = mCache.size();
+	}
+	stats.hits = mCounters.hits;
+	stats.misses = mCounters.misses;
+	stats.failures = mCounters.failures;
+	stats.invalidations = mCounters.invalidations;
+	stats.evictions = mCounters.evictions;
+	stats.unpackedSize = mCounters.unpackedSize;
+	stats.unpackTime = toMilliseconds(mCounters.unpackTime);
+	stats.unpackWaitTime = toMilliseconds(mCounters.unpackWaitTime);
+	stats.fingerprintTime = toMilliseconds(mCounters.fingerprintTime);
+	stats.lockWaitTime = toMilliseconds(mCounters.lockWaitTime);
+	return stats;
 }
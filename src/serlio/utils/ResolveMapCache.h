@@ -19,35 +19,147 @@
 
 #pragma once
 
+#include "utils/RPKUnpackStore.h"
 #include "utils/Utilities.h"
 
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <future>
 #include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 class ResolveMapCache {
 public:
 	using KeyType = std::wstring;
 
-	explicit ResolveMapCache(const std::wstring& unpackPath) : mRPKUnpackPath{unpackPath} {}
+	// called with the cache locked before the resolve map of a changed or evicted rpk is dropped, see
+	// getAssetLocation() for the last argument
+	using InvalidationCallback =
+	        std::function<void(const std::wstring& rpk, const ResolveMapSPtr& resolveMap, uint64_t assetLocation)>;
+
+	explicit ResolveMapCache(const std::wstring& unpackPath, InvalidationCallback invalidationCallback = {});
 	ResolveMapCache(const ResolveMapCache&) = delete;
 	ResolveMapCache(ResolveMapCache&&) = delete;
 	ResolveMapCache& operator=(ResolveMapCache const&) = delete;
 	ResolveMapCache& operator=(ResolveMapCache&&) = delete;
 	~ResolveMapCache();
 
+	struct Stats {
+		size_t rulePackages = 0;
+		size_t hits = 0;
+		size_t misses = 0;            // unpacks, including reloads
+		size_t failures = 0;          // missing or broken rpks
+		size_t invalidations = 0;     // reloads of rpks changed on disk
+		size_t evictions = 0;         // see setLimits()
+		uint64_t unpackedSize = 0;    // bytes of rpk files
+		double unpackTime = 0.0;      // all times in ms, summed over all threads
+		double unpackWaitTime = 0.0;  // of lookups waiting for an unpack started by another lookup
+		double fingerprintTime = 0.0; // of change checks
+		double lockWaitTime = 0.0;
+	};
+
 	enum class CacheStatus { HIT, MISS };
 	using LookupResult = std::pair<ResolveMapSPtr, CacheStatus>;
+
+	// thread-safe: concurrent lookups of the same rpk wait for a single unpack, different rpks unpack in parallel
 	LookupResult get(const std::wstring& rpk);
 
+	// optional, rpks are unpacked into the store instead of the session specific unpack path (nullptr to disable)
+	void setUnpackStore(RPKUnpackStoreSPtr unpackStore);
+
+	// rpks loaded afterwards are not unpacked at all, their resolve maps point into the archive. PRT reads the assets
+	// from there, the maya encoder extracts the textures needed by maya into getTextureDirectory(rpk) on first use.
+	void setZeroExtract(bool zeroExtract);
+	bool isZeroExtract() const {
+		return mZeroExtract;
+	}
+
+	// the textures of each rpk content version go into their own subdirectory of the texture root, by default in the
+	// unpack path. A persistent root (e.g. next to the disk generation cache) keeps the texture paths of cached results
+	// valid in later sessions. Must be set before setZeroExtract().
+	void setTextureRoot(const std::wstring& textureRoot);
+
+	// of an rpk previously loaded with get() in zero extract mode, created along with its resolve map. Empty if the
+	// rpk was unpacked or the directory could not be created.
+	std::wstring getTextureDirectory(const std::wstring& rpk) const;
+
+	// unpacks the rpk on a background thread, so a later get() finds it in the cache
+	std::shared_future<void> prefetch(const std::wstring& rpk);
+
+	// content fingerprint of an rpk previously loaded with get(), stable across sessions. 0 if unknown.
+	uint64_t getFingerprint(const std::wstring& rpk);
+
+	// where the unpacked files of an rpk previously loaded with get() live: 0 if their paths stay valid across
+	// sessions and reloads (unpack store, zero extract), otherwise a hash of the session specific unpack directory.
+	// Generation results refer to these files, e.g. textures, so results of different locations must not be mixed.
+	uint64_t getAssetLocation(const std::wstring& rpk);
+
+	// at most maxEntries rpks with a total file size of maxSize bytes stay cached, the least recently used ones are
+	// dropped first. Nodes still using a dropped resolve map keep it, its unpack directory is removed in the
+	// background after the last one lets go.
+	void setLimits(size_t maxEntries, uint64_t maxSize);
+	static constexpr size_t DEFAULT_MAX_ENTRIES = 32;
+	static constexpr uint64_t DEFAULT_MAX_SIZE = 4ull * 1024 * 1024 * 1024;
+
+	Stats getStats() const;
+
 private:
 	struct ResolveMapCacheEntry {
-		ResolveMapSPtr mResolveMap;
-		time_t mTimeStamp;
+		std::shared_future<ResolveMapSPtr> mResolveMap; // not ready while the rpk is being unpacked
+		uint64_t mFingerprint = 0; // identifies the rpk content, see fingerprintRPK()
+		time_t mFingerprintTime = 0;
+		time_t mTimeStamp = 0; // only a hint: if it changes, the fingerprint is compared
+		std::atomic<std::chrono::steady_clock::time_point> mLastCheck; // of mTimeStamp, updated with the shared lock
+		std::atomic<std::chrono::steady_clock::time_point> mLastUse; // updated with the shared lock
+		uint64_t mSize = 0;                                         // of the rpk file, 0 while unpacking
+		uint64_t mAssetLocation = 0;                                // see getAssetLocation(), set after unpacking
+		std::wstring mTextureDirectory;                             // see getTextureDirectory(), set after unpacking
 	};
 	using Cache = std::map<KeyType, ResolveMapCacheEntry>;
 	Cache mCache;
+	mutable std::shared_timed_mutex mCacheMutex; // shared for lookups, exclusive for changes of mCache
+
+	// updated without locking, see Stats for the meaning. Times in ns.
+	struct Counters {
+		std::atomic<size_t> hits{0};
+		std::atomic<size_t> misses{0};
+		std::atomic<size_t> failures{0};
+		std::atomic<size_t> invalidations{0};
+		std::atomic<size_t> evictions{0};
+		std::atomic<uint64_t> unpackedSize{0};
+		std::atomic<uint64_t> unpackTime{0};
+		std::atomic<uint64_t> unpackWaitTime{0};
+		std::atomic<uint64_t> fingerprintTime{0};
+		std::atomic<uint64_t> lockWaitTime{0};
+	};
+	Counters mCounters;
+
+	void invalidate(Cache::iterator it);
+	void evict(const KeyType& keep);
+	ResolveMapSPtr createResolveMap(const std::wstring& rpk, bool zeroExtract, uint64_t& assetLocation,
+	                                prt::Status& status);
+	std::wstring createTextureDirectory(uint64_t fingerprint) const; // empty on failure
+
+	size_t mMaxEntries = DEFAULT_MAX_ENTRIES; // guarded by mCacheMutex
+	uint64_t mMaxSize = DEFAULT_MAX_SIZE;     // guarded by mCacheMutex
+
+	RPKUnpackStoreSPtr mUnpackStore; // guarded by mCacheMutex
+	std::atomic<bool> mZeroExtract{false};
+
+	const std::wstring mRPKUnpackPath; // parent of the unpack directories, see createResolveMap()
+	std::wstring mTextureRoot;
+	const InvalidationCallback mInvalidationCallback;
+
+	// each resolve map gets its own unpack directory, removed by the deleter of the resolve map
+	struct DirectoryRemover;
+	const std::shared_ptr<DirectoryRemover> mDirectoryRemover; // shared with the deleters, which may outlive us
+	std::atomic<size_t> mUnpackCounter{0};
 
-	const std::wstring mRPKUnpackPath;
+	std::vector<std::shared_future<void>> mPrefetches; // joined on destruction
+	std::mutex mPrefetchesMutex;
 };
 
 using ResolveMapCacheUPtr = std::unique_ptr<ResolveMapCache>;
\ No newline at end of file
@@ -30,6 +30,7 @@ struct IUnknown;
 #	include <windows.h>
 #	include <shellapi.h>
 #else
+#	include <dirent.h>
 #	include <dlfcn.h>
 #	include <unistd.h>
 #endif
@@ -240,6 +241,49 @@ void remove_all(const std::wstring& path) {
 #endif
 }
 
+bool create_directory(const std::wstring& path) {
+#ifdef _WIN32
+	std::wstring pc = path;
+	std::replace(pc.begin(), pc.end(), L'/', L'\\');
+	if (CreateDirectoryW(pc.c_str(), nullptr) == 0 && GetLastError() != ERROR_ALREADY_EXISTS)
+		return false;
+	const DWORD attributes = GetFileAttributesW(pc.c_str());
+	return (attributes != INVALID_FILE_ATTRIBUTES) && ((attributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+#else
+	const std::string p = toOSNarrowFromUTF16(path);
+	if (mkdir(p.c_str(), 0777) == 0)
+		return true;
+	struct stat st;
+	return (stat(p.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+#endif
+}
+
+std::vector<std::wstring> list_directory(const std::wstring& path) {
+	std::vector<std::wstring> names;
+#ifdef _WIN32
+	std::wstring pattern = path + L"\\*";
+	std::replace(pattern.begin(), pattern.end(), L'/', L'\\');
+	WIN32_FIND_DATAW findData;
+	const HANDLE find = FindFirstFileW(pattern.c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+		return names;
+	do {
+		names.emplace_back(findData.cFileName);
+	} while (FindNextFileW(find, &findData) != 0);
+	FindClose(find);
+#else
+	DIR* dir = opendir(toOSNarrowFromUTF16(path).c_str());
+	if (dir == nullptr)
+		return names;
+	while (const dirent* entry = readdir(dir))
+		names.push_back(toUTF16FromOSNarrow(entry->d_name));
+	closedir(dir);
+#endif
+	auto isDotEntry = [](const std::wstring& n) { return n == L"." || n == L".."; };
+	names.erase(std::remove_if(names.begin(), names.end(), isDotEntry), names.end());
+	return names;
+}
+
 std::wstring temp_directory_path() {
 #ifdef _WIN32
 	DWORD dwRetVal = 0;
@@ -304,6 +348,19 @@ time_t getFileModificationTime(const std::wstring& p) {
 	return -1;
 }
 
+int64_t getFileSize(const std::wstring& p) {
+#ifdef _WIN32
+	std::wstring pn = p;
+	std::replace(pn.begin(), pn.end(), L'/', L'\\');
+	struct _stat64 st;
+	const int ierr = _wstat64(pn.c_str(), &st);
+#else
+	struct stat st;
+	const int ierr = stat(prtu::toOSNarrowFromUTF16(p).c_str(), &st);
+#endif
+	return (ierr == 0) ? static_cast<int64_t>(st.st_size) : -1;
+}
+
 std::wstring toGenericPath(const std::wstring& osPath) {
 	std::wstring genPath = osPath;
 	std::replace(genPath.begin(), genPath.end(), L'\\', L'/');
@@ -338,4 +395,88 @@ AttributeMapUPtr createValidatedOptions(const wchar_t* encID, const prt::Attribu
 	return AttributeMapUPtr(validatedOptions);
 }
 
+uint64_t hashAttributeMap(const prt::AttributeMap* attrs, uint64_t h) {
+	if (attrs == nullptr)
+		return h;
+
+	size_t keyCount = 0;
+	wchar_t const* const* keyPtrs = attrs->getKeys(&keyCount);
+	std::vector<std::wstring> keys(keyPtrs, keyPtrs + keyCount);
+	std::sort(keys.begin(), keys.end());
+
+	for (const std::wstring& key : keys) {
+		const wchar_t* k = key.c_str();
+		const prt::Attributable::PrimitiveType type = attrs->getType(k);
+		h = hash(key, h);
+		h = hash(&type, sizeof(type), h);
+
+		size_t count = 0;
+		switch (type) {
+			case prt::Attributable::PT_BOOL: {
+				const bool v = attrs->getBool(k);
+				h = hash(&v, sizeof(v), h);
+				break;
+			}
+			case prt::Attributable::PT_INT: {
+				const int32_t v = attrs->getInt(k);
+				h = hash(&v, sizeof(v), h);
+				break;
+			}
+			case prt::Attributable::PT_FLOAT: {
+				const double v = attrs->getFloat(k);
+				h = hash(&v, sizeof(v), h);
+				break;
+			}
+			case prt::Attributable::PT_STRING:
+				h = hash(std::wstring(attrs->getString(k)), h);
+				break;
+			case prt::Attributable::PT_BOOL_ARRAY: {
+				const bool* v = attrs->getBoolArray(k, &count);
+				h = hash(v, count * sizeof(bool), h);
+				break;
+			}
+			case prt::Attributable::PT_INT_ARRAY: {
+				const int32_t* v = attrs->getIntArray(k, &count);
+				h = hash(v, count * sizeof(int32_t), h);
+				break;
+			}
+			case prt::Attributable::PT_FLOAT_ARRAY: {
+				const double* v = attrs->getFloatArray(k, &count);
+				h = hash(v, count * sizeof(double), h);
+				break;
+			}
+			case prt::Attributable::PT_STRING_ARRAY: {
+				wchar_t const* const* v = attrs->getStringArray(k, &count);
+				for (size_t i = 0; i < count; i++)
+					h = hash(std::wstring(v[i]), h);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	return h;
+}
+
+int32_t computeSeed(float x, float z) {
+	int32_t seed = *(int32_t*)(&x);
+	seed ^= *(int32_t*)(&z);
+	seed %= 714025;
+	return seed;
+}
+
+int32_t computeSeed(const double* vertices, size_t count) {
+	// single precision like the maya point types to keep the seeds of existing scenes
+	float x = 0.0f;
+	float z = 0.0f;
+	for (size_t vi = 0; vi < count; vi += 3) {
+		x += static_cast<float>(vertices[vi + 0]);
+		z += static_cast<float>(vertices[vi + 2]);
+	}
+	x /= static_cast<float>(count);
+	z /= static_cast<float>(count);
+	return computeSeed(x, z);
+}
+
 } // namespace prtu
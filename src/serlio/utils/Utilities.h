@@ -37,6 +37,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 // PRT version >= VERSION_MAJOR.VERSION_MINOR
@@ -74,6 +75,7 @@ using ResolveMapBuilderUPtr = std::unique_ptr<prt::ResolveMapBuilder, PRTDestroy
 using RuleFileInfoUPtr = std::unique_ptr<const prt::RuleFileInfo, PRTDestroyer>;
 using EncoderInfoUPtr = std::unique_ptr<const prt::EncoderInfo, PRTDestroyer>;
 using OcclusionSetUPtr = std::unique_ptr<prt::OcclusionSet, PRTDestroyer>;
+using OcclusionSetSPtr = std::shared_ptr<prt::OcclusionSet>;
 using ResolveMapSPtr = std::shared_ptr<const prt::ResolveMap>;
 
 namespace prtu {
@@ -97,9 +99,12 @@ std::vector<const C*> toPtrVec(const std::vector<std::unique_ptr<C, D>>& sv) {
 // poor mans std::filesystem - we don't want boost or c++17 dependency right now
 SRL_TEST_EXPORTS_API std::wstring filename(const std::wstring& path);
 time_t getFileModificationTime(const std::wstring& p);
+int64_t getFileSize(const std::wstring& p); // -1 if the file does not exist
 std::wstring temp_directory_path();
 std::wstring getProcessTempDir(const std::wstring& prefix);
 void remove_all(const std::wstring& path);
+bool create_directory(const std::wstring& path); // true if the directory exists afterwards
+std::vector<std::wstring> list_directory(const std::wstring& path); // file names, without "." and ".."
 std::wstring toGenericPath(const std::wstring& osPath);
 
 template <typename C>
@@ -144,6 +149,48 @@ std::string objectToXML(std::unique_ptr<T, PRTDestroyer>& ptr) {
 
 AttributeMapUPtr createValidatedOptions(const wchar_t* encID, const prt::AttributeMap* unvalidatedOptions = nullptr);
 
+// 64bit FNV-1a, used to derive cache keys from geometry and attribute data
+constexpr uint64_t HASH_OFFSET_BASIS = 14695981039346656037ULL;
+
+inline uint64_t hash(const void* data, size_t size, uint64_t h = HASH_OFFSET_BASIS) {
+	constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		h ^= bytes[i];
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+
+template <typename T>
+uint64_t hash(const std::vector<T>& v, uint64_t h = HASH_OFFSET_BASIS) {
+	static_assert(std::is_trivially_copyable<T>::value, "can only hash plain data");
+	return hash(v.data(), v.size() * sizeof(T), h);
+}
+
+inline uint64_t hash(const std::wstring& s, uint64_t h = HASH_OFFSET_BASIS) {
+	return hash(s.data(), s.size() * sizeof(wchar_t), h);
+}
+
+// independent of the order in which the keys have been inserted
+SRL_TEST_EXPORTS_API uint64_t hashAttributeMap(const prt::AttributeMap* attrs, uint64_t h = HASH_OFFSET_BASIS);
+
+inline uint64_t hashCombine(uint64_t h, uint64_t v) {
+	return hash(&v, sizeof(v), h);
+}
+
+// random seed derived from the x and z coordinates of a point, like mu::computeSeed(const MFloatPoint&)
+int32_t computeSeed(float x, float z);
+
+// random seed derived from the vertex coordinates (x, y, z triples). note that the coordinate sums are divided by the
+// number of coordinates instead of vertices, this is kept to not change the seeds of existing scenes.
+int32_t computeSeed(const double* vertices, size_t count);
+
+// e.g. the node seed plus the seed of a face, wraps around instead of the undefined signed integer overflow
+inline int32_t addSeeds(int32_t seed, int32_t offset) {
+	return static_cast<int32_t>(static_cast<uint32_t>(seed) + static_cast<uint32_t>(offset));
+}
+
 inline std::wstring getRuleFileEntry(ResolveMapSPtr resolveMap) {
 	const std::wstring sCGB(L".cgb");
 
@@ -19,15 +19,33 @@
 
 #include "PRTContext.h"
 
+#include "batch/AttributeFile.h"
+#include "batch/ObjIO.h"
+
+#include "modifiers/DiskGenerationCache.h"
+#include "modifiers/GenerationCache.h"
+#include "modifiers/MayaCallbacks.h"
+#include "modifiers/OcclusionManager.h"
+#include "modifiers/PRTMesh.h"
 #include "modifiers/RuleAttributes.h"
 
 #include "utils/LogHandler.h"
+#include "utils/PRTCacheManager.h"
+#include "utils/RPKUnpackStore.h"
 #include "utils/Utilities.h"
 
 #define CATCH_CONFIG_RUNNER
 #include "catch/catch.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <set>
 #include <sstream>
+#include <thread>
 
 namespace {
 
@@ -137,6 +155,287 @@ TEST_CASE("default attribute values") {
 	// TODO: add assertion for value, needs interface into PRTModifierAction.cpp without introducing maya dep here
 }
 
+TEST_CASE("resolve map prefetch") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	ResolveMapCache resolveMapCache(prtu::getProcessTempDir(L"serlio_test_prefetch_"));
+
+	SECTION("prefetched rpk is cached") {
+		resolveMapCache.prefetch(rpk).wait();
+		const ResolveMapCache::LookupResult lookupResult = resolveMapCache.get(rpk);
+		CHECK(lookupResult.first != nullptr);
+		CHECK(lookupResult.second == ResolveMapCache::CacheStatus::HIT);
+	}
+
+	SECTION("failed prefetch") {
+		const std::wstring missingRpk = testDataPath + L"/does-not-exist.rpk";
+		resolveMapCache.prefetch(missingRpk).wait();
+		CHECK(resolveMapCache.get(missingRpk).first == nullptr);
+	}
+}
+
+TEST_CASE("preload rule packages") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::vector<std::wstring> rpks = {rpk, testDataPath + L"/does-not-exist.rpk", rpk};
+	CHECK(prtCtx->preloadRulePackages(rpks) == 2);
+	CHECK(prtCtx->mResolveMapCache->get(rpk).second == ResolveMapCache::CacheStatus::HIT);
+}
+
+TEST_CASE("concurrent resolve map lookups") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	ResolveMapCache resolveMapCache(prtu::getProcessTempDir(L"serlio_test_concurrent_"));
+
+	std::vector<std::future<ResolveMapCache::LookupResult>> lookups;
+	auto lookup = [&resolveMapCache, &rpk]() { return resolveMapCache.get(rpk); };
+	for (size_t i = 0; i < 8; i++)
+		lookups.push_back(std::async(std::launch::async, lookup));
+
+	std::set<const prt::ResolveMap*> resolveMaps;
+	size_t misses = 0;
+	for (auto& lookup : lookups) {
+		const ResolveMapCache::LookupResult lookupResult = lookup.get();
+		CHECK(lookupResult.first != nullptr);
+		resolveMaps.insert(lookupResult.first.get());
+		if (lookupResult.second == ResolveMapCache::CacheStatus::MISS)
+			misses++;
+	}
+
+	// all lookups share a single unpack
+	CHECK(resolveMaps.size() == 1);
+	CHECK(misses == 1);
+}
+
+TEST_CASE("concurrent unpacks of different rule packages") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::wstring unpackPath = prtu::getProcessTempDir(L"serlio_test_concurrent_unpacks_");
+	REQUIRE(prtu::create_directory(unpackPath));
+	const std::wstring rpkCopy = unpackPath + prtu::getDirSeparator<wchar_t>() + L"copy.rpk";
+	{
+		std::ifstream in(prtu::toOSNarrowFromUTF16(rpk), std::ios::binary);
+		std::ofstream out(prtu::toOSNarrowFromUTF16(rpkCopy), std::ios::binary);
+		out << in.rdbuf();
+	}
+
+	{
+		ResolveMapCache resolveMapCache(unpackPath);
+		auto lookup = [&resolveMapCache](const std::wstring& r) { return resolveMapCache.get(r).first; };
+		std::future<ResolveMapSPtr> lookup1 = std::async(std::launch::async, lookup, rpk);
+		std::future<ResolveMapSPtr> lookup2 = std::async(std::launch::async, lookup, rpkCopy);
+		const ResolveMapSPtr resolveMap1 = lookup1.get();
+		const ResolveMapSPtr resolveMap2 = lookup2.get();
+		REQUIRE(resolveMap1 != nullptr);
+		REQUIRE(resolveMap2 != nullptr);
+
+		// same content, but each unpack has its own directory
+		const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap1);
+		const wchar_t* ruleFileURI1 = resolveMap1->getString(ruleFile.c_str());
+		const wchar_t* ruleFileURI2 = resolveMap2->getString(ruleFile.c_str());
+		REQUIRE(ruleFileURI1 != nullptr);
+		REQUIRE(ruleFileURI2 != nullptr);
+		CHECK(std::wstring(ruleFileURI1) != std::wstring(ruleFileURI2));
+	}
+
+	prtu::remove_all(unpackPath);
+}
+
+TEST_CASE("resolve map cache stats") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	ResolveMapCache resolveMapCache(prtu::getProcessTempDir(L"serlio_test_stats_"));
+	REQUIRE(resolveMapCache.get(rpk).first != nullptr);
+	REQUIRE(resolveMapCache.get(rpk).first != nullptr);
+	REQUIRE(resolveMapCache.get(testDataPath + L"/does-not-exist.rpk").first == nullptr);
+
+	const ResolveMapCache::Stats stats = resolveMapCache.getStats();
+	CHECK(stats.rulePackages == 1);
+	CHECK(stats.hits == 1);
+	CHECK(stats.misses == 1);
+	CHECK(stats.failures == 1);
+	CHECK(stats.unpackedSize == static_cast<uint64_t>(prtu::getFileSize(rpk)));
+	CHECK(stats.unpackTime > 0.0);
+}
+
+TEST_CASE("resolve map cache limits") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::wstring tmpDir = prtu::getProcessTempDir(L"serlio_test_limits_");
+	REQUIRE(prtu::create_directory(tmpDir));
+
+	// the same content under different paths gives two cache entries
+	const std::wstring rpk1 = tmpDir + L"/limits1.rpk";
+	const std::wstring rpk2 = tmpDir + L"/limits2.rpk";
+	for (const std::wstring& copy : {rpk1, rpk2}) {
+		std::ifstream in(prtu::toOSNarrowFromUTF16(rpk), std::ios::binary);
+		std::ofstream out(prtu::toOSNarrowFromUTF16(copy), std::ios::binary);
+		out << in.rdbuf();
+	}
+
+	{
+		std::vector<uint64_t> invalidatedLocations;
+		auto onInvalidation = [&invalidatedLocations](const std::wstring&, const ResolveMapSPtr&, uint64_t location) {
+			invalidatedLocations.push_back(location);
+		};
+		ResolveMapCache resolveMapCache(tmpDir + L"/unpack", onInvalidation);
+		resolveMapCache.setLimits(1, ResolveMapCache::DEFAULT_MAX_SIZE);
+
+		const ResolveMapSPtr resolveMap1 = resolveMapCache.get(rpk1).first;
+		REQUIRE(resolveMap1 != nullptr);
+		const uint64_t assetLocation1 = resolveMapCache.getAssetLocation(rpk1);
+		CHECK(assetLocation1 != 0);
+		REQUIRE(resolveMapCache.get(rpk2).first != nullptr);
+		CHECK(invalidatedLocations == std::vector<uint64_t>{assetLocation1});
+
+		// rpk1 has been evicted, but its resolve map stays usable as long as it is referenced
+		const ResolveMapCache::LookupResult lookupResult = resolveMapCache.get(rpk1);
+		CHECK(lookupResult.second == ResolveMapCache::CacheStatus::MISS);
+		CHECK(lookupResult.first != resolveMap1);
+		const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap1);
+		CHECK(resolveMap1->getString(ruleFile.c_str()) != nullptr);
+
+		// the same content is unpacked again into a new directory, its results must not be mixed with the old ones
+		CHECK(resolveMapCache.getFingerprint(rpk1) != 0);
+		CHECK(resolveMapCache.getAssetLocation(rpk1) != assetLocation1);
+
+		// a size limit below a single rpk evicts every rpk, even the most recently loaded one is unpacked again
+		resolveMapCache.setLimits(ResolveMapCache::DEFAULT_MAX_ENTRIES, 0);
+		CHECK(resolveMapCache.get(rpk2).second == ResolveMapCache::CacheStatus::MISS);
+		CHECK(resolveMapCache.get(rpk2).second == ResolveMapCache::CacheStatus::HIT);
+	}
+
+	prtu::remove_all(tmpDir);
+}
+
+TEST_CASE("rpk content fingerprint") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::wstring tmpDir = prtu::getProcessTempDir(L"serlio_test_fingerprint_");
+	REQUIRE(prtu::create_directory(tmpDir));
+
+	const std::wstring copy = tmpDir + L"/fingerprint.rpk";
+	auto writeCopy = [&rpk, &copy]() {
+		std::ifstream in(prtu::toOSNarrowFromUTF16(rpk), std::ios::binary);
+		std::ofstream out(prtu::toOSNarrowFromUTF16(copy), std::ios::binary);
+		out << in.rdbuf();
+	};
+	writeCopy();
+
+	{
+		ResolveMapCache resolveMapCache(tmpDir + L"/unpack");
+		const ResolveMapSPtr resolveMap = resolveMapCache.get(copy).first;
+		REQUIRE(resolveMap != nullptr);
+		REQUIRE(resolveMapCache.get(rpk).first != nullptr);
+
+		// the fingerprint only depends on the content
+		CHECK(resolveMapCache.getFingerprint(copy) != 0);
+		CHECK(resolveMapCache.getFingerprint(copy) == resolveMapCache.getFingerprint(rpk));
+
+		// rewriting the same content (e.g. by a sync) keeps the resolve map
+		std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+		writeCopy();
+		const ResolveMapCache::LookupResult lookupResult = resolveMapCache.get(copy);
+		CHECK(lookupResult.second == ResolveMapCache::CacheStatus::HIT);
+		CHECK(lookupResult.first == resolveMap);
+	}
+
+	prtu::remove_all(tmpDir);
+}
+
+TEST_CASE("zero extract") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	ResolveMapCache resolveMapCache(prtu::getProcessTempDir(L"serlio_test_zero_extract_"));
+	resolveMapCache.setZeroExtract(true);
+	REQUIRE(resolveMapCache.isZeroExtract());
+
+	const ResolveMapSPtr resolveMap = resolveMapCache.get(rpk).first;
+	REQUIRE(resolveMap != nullptr);
+	const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const wchar_t* ruleFileURI = resolveMap->getString(ruleFile.c_str());
+	REQUIRE(ruleFileURI != nullptr);
+
+	// the rule file is read from the archive instead of an unpacked file
+	CHECK(std::wstring(ruleFileURI).find(L"file:") != 0);
+
+	// the textures go into a directory created once per rpk content
+	const std::wstring textureDirectory = resolveMapCache.getTextureDirectory(rpk);
+	REQUIRE_FALSE(textureDirectory.empty());
+	CHECK(prtu::getFileModificationTime(textureDirectory) != -1);
+	CHECK(resolveMapCache.getTextureDirectory(rpk) == textureDirectory);
+	CHECK(resolveMapCache.getTextureDirectory(testDataPath + L"/not-loaded.rpk").empty());
+}
+
+TEST_CASE("rpk unpack store") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::wstring storeDir = prtu::getProcessTempDir(L"serlio_test_unpack_store_");
+	const std::wstring sep(1, prtu::getDirSeparator<wchar_t>());
+
+	SECTION("later sessions reuse the unpacked rpk") {
+		size_t keyCount = 0;
+		{
+			RPKUnpackStore unpackStore(storeDir, RPKUnpackStore::DEFAULT_SIZE_BUDGET);
+			const ResolveMapSPtr resolveMap = unpackStore.getResolveMap(rpk, 1);
+			REQUIRE(resolveMap != nullptr);
+			resolveMap->getKeys(&keyCount);
+		}
+
+		// the rpk itself is not needed anymore
+		RPKUnpackStore unpackStore(storeDir, RPKUnpackStore::DEFAULT_SIZE_BUDGET);
+		const ResolveMapSPtr resolveMap = unpackStore.getResolveMap(testDataPath + L"/does-not-exist.rpk", 1);
+		REQUIRE(resolveMap != nullptr);
+		size_t reusedKeyCount = 0;
+		resolveMap->getKeys(&reusedKeyCount);
+		CHECK(reusedKeyCount == keyCount);
+	}
+
+	SECTION("unused entries beyond the budget are removed") {
+		RPKUnpackStore unpackStore(storeDir, 0);
+		CHECK(unpackStore.getResolveMap(rpk, 1) != nullptr);
+		const ResolveMapSPtr resolveMap = unpackStore.getResolveMap(rpk, 2);
+		REQUIRE(resolveMap != nullptr);
+		CHECK(prtu::getFileModificationTime(storeDir + sep + L"0000000000000001") == -1);
+		CHECK(prtu::getFileModificationTime(storeDir + sep + L"0000000000000001.lock") == -1);
+		CHECK(prtu::getFileModificationTime(storeDir + sep + L"0000000000000002") != -1);
+	}
+
+	prtu::remove_all(storeDir);
+}
+
+TEST_CASE("prt cache manager") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	ResolveMapCache resolveMapCache1(prtu::getProcessTempDir(L"serlio_test_cache_manager_1_"));
+	ResolveMapCache resolveMapCache2(prtu::getProcessTempDir(L"serlio_test_cache_manager_2_"));
+	const ResolveMapSPtr resolveMap1 = resolveMapCache1.get(rpk).first;
+	const ResolveMapSPtr resolveMap2 = resolveMapCache2.get(rpk).first;
+	REQUIRE(resolveMap1 != nullptr);
+	REQUIRE(resolveMap2 != nullptr);
+
+	CacheObjectUPtr cache(prt::CacheObject::create(prt::CacheObject::CACHE_TYPE_DEFAULT));
+	PRTCacheManager cacheManager(*cache, 1024 * 1024);
+
+	SECTION("hits and misses") {
+		cacheManager.touch(rpk, resolveMap1);
+		cacheManager.touch(rpk, resolveMap1);
+		const PRTCacheManager::Stats stats = cacheManager.getStats();
+		CHECK(stats.rulePackages == 1);
+		CHECK(stats.memorySize == static_cast<size_t>(prtu::getFileSize(rpk)));
+		CHECK(stats.hits == 1);
+		CHECK(stats.misses == 1);
+	}
+
+	SECTION("reloaded rpk is flushed") {
+		cacheManager.touch(rpk, resolveMap1);
+		cacheManager.touch(rpk, resolveMap2);
+		const PRTCacheManager::Stats stats = cacheManager.getStats();
+		CHECK(stats.rulePackages == 1);
+		CHECK(stats.misses == 2);
+		CHECK(stats.flushes == 1);
+	}
+
+	SECTION("shrinking the budget flushes") {
+		cacheManager.touch(rpk, resolveMap1);
+		cacheManager.setMemoryBudget(0);
+		const PRTCacheManager::Stats stats = cacheManager.getStats();
+		CHECK(stats.rulePackages == 0);
+		CHECK(stats.memorySize == 0);
+		CHECK(stats.flushes == 1);
+	}
+}
+
 const AttributeGroup AG_NONE = {};
 const AttributeGroup AG_A = {L"a"};
 const AttributeGroup AG_AK = {L"a", L"k"};
@@ -268,6 +567,24 @@ TEST_CASE("rule attribute sorting") {
 	}
 }
 
+TEST_CASE("rule attribute registry") {
+	RuleAttribute A = getAttr(L"style$A", AG_NONE, ORDER_NONE, ORDER_NONE, L"foo", true);
+	A.mayaFullName = L"PRTstyleA";
+	RuleAttribute B = getAttr(L"style$B", AG_NONE, ORDER_NONE, ORDER_NONE, L"foo", true);
+	B.mayaFullName = L"PRTstyleB";
+
+	const RuleAttributeRegistry registry({A, B});
+	CHECK(registry.getAttributes().size() == 2);
+
+	const RuleAttribute* b = registry.findByMayaFullName(L"PRTstyleB");
+	REQUIRE(b != nullptr);
+	CHECK(b->fqName == L"style$B");
+	CHECK(registry.findByFqName(L"style$A") == &registry.getAttributes().front());
+
+	CHECK(registry.findByMayaFullName(L"PRTstyleC") == nullptr);
+	CHECK(registry.findByFqName(L"style$C") == nullptr);
+}
+
 TEST_CASE("join") {
 	const std::vector<std::wstring> input1 = {L"foo"};
 	CHECK(join<wchar_t>(input1, L" ") == L"foo");
@@ -297,6 +614,612 @@ TEST_CASE("toFileURI") {
 #endif
 }
 
+TEST_CASE("generation cache") {
+	auto makeKey = [](uint64_t shapeHash) {
+		GenerationCache::Key key;
+		key.shapeHash = shapeHash;
+		key.ruleFile = L"bldg.cgb";
+		key.startRule = L"Default$Lot";
+		return key;
+	};
+	auto makeResult = [](size_t numVertices) {
+		GenerationResultUPtr result(new GenerationResult());
+		result->vertices.resize(numVertices);
+		return GenerationResultSPtr(std::move(result));
+	};
+
+	const GenerationResultSPtr r = makeResult(100);
+	GenerationCache cache(3 * r->getMemorySize());
+
+	SECTION("hit and miss") {
+		cache.insert(makeKey(1), r);
+		CHECK(cache.get(makeKey(1)) == r);
+		CHECK(cache.get(makeKey(2)) == nullptr);
+	}
+
+	SECTION("least recently used entry is evicted first") {
+		cache.insert(makeKey(1), makeResult(100));
+		cache.insert(makeKey(2), makeResult(100));
+		cache.insert(makeKey(3), makeResult(100));
+		CHECK(cache.get(makeKey(1)) != nullptr);
+		cache.insert(makeKey(4), makeResult(100));
+		CHECK(cache.size() == 3);
+		CHECK(cache.get(makeKey(1)) != nullptr);
+		CHECK(cache.get(makeKey(2)) == nullptr);
+		CHECK(cache.getMemorySize() <= cache.getMemoryBudget());
+	}
+
+	SECTION("shrinking the budget evicts entries") {
+		cache.insert(makeKey(1), makeResult(100));
+		cache.insert(makeKey(2), makeResult(100));
+		cache.setMemoryBudget(0);
+		CHECK(cache.size() == 0);
+		CHECK(cache.getMemorySize() == 0);
+	}
+
+	SECTION("results of a removed asset location are dropped") {
+		GenerationCache::Key key1 = makeKey(1);
+		key1.assetLocation = 7;
+		GenerationCache::Key otherLocationKey = makeKey(1);
+		otherLocationKey.assetLocation = 8;
+		cache.insert(key1, makeResult(100));
+		cache.insert(otherLocationKey, makeResult(100));
+		cache.insert(makeKey(2), makeResult(100));
+		cache.removeAssetLocation(7);
+		CHECK(cache.size() == 2);
+		CHECK(cache.get(key1) == nullptr);
+		CHECK(cache.get(otherLocationKey) != nullptr);
+		CHECK(cache.get(makeKey(2)) != nullptr);
+		CHECK(cache.getMemorySize() == 2 * r->getMemorySize());
+	}
+}
+
+TEST_CASE("disk generation cache") {
+	const std::wstring cacheDir = prtu::getProcessTempDir(L"serlio_test_disk_cache_");
+	DiskGenerationCache cache(cacheDir);
+
+	GenerationCache::Key key;
+	key.shapeHash = 1;
+	key.ruleFile = L"bldg.cgb";
+	key.startRule = L"Default$Lot";
+	key.rpkFingerprint = 42;
+
+	GenerationResult result;
+	result.hasMesh = true;
+	result.vertices = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 1.0, 0.0, 1.0};
+	result.faceCounts = {3};
+	result.vertexIndices = {0, 1, 2};
+	result.uvs = {{0.0, 0.0, 1.0, 0.0, 1.0, 1.0}};
+	result.uvCounts = {{3}};
+	result.uvIndices = {{0, 1, 2}};
+	result.faceRanges = {0, 1};
+	AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+	amb->setFloat(L"Default$height", 10.0);
+	amb->setString(L"Default$style", L"modern");
+	result.attributes.reset(amb->createAttributeMap());
+
+	SECTION("roundtrip") {
+		cache.put(key, result);
+		const GenerationResultUPtr cached = cache.get(key);
+		REQUIRE(cached != nullptr);
+		CHECK(cached->hasMesh);
+		CHECK(cached->vertices == result.vertices);
+		CHECK(cached->vertexIndices == result.vertexIndices);
+		CHECK(cached->uvs == result.uvs);
+		CHECK(cached->faceRanges == result.faceRanges);
+		CHECK(cached->materials.empty());
+		REQUIRE(cached->attributes != nullptr);
+		CHECK(prtu::hashAttributeMap(cached->attributes.get()) == prtu::hashAttributeMap(result.attributes.get()));
+	}
+
+	SECTION("changed rpk is a miss") {
+		cache.put(key, result);
+		GenerationCache::Key changedKey = key;
+		changedKey.rpkFingerprint++;
+		CHECK(cache.get(changedKey) == nullptr);
+	}
+
+	const auto listEntries = [&cacheDir]() {
+		std::vector<std::wstring> entries;
+		for (const std::wstring& name : prtu::list_directory(cacheDir))
+			entries.push_back(cacheDir + prtu::getDirSeparator<wchar_t>() + name);
+		return entries;
+	};
+
+	const auto readFile = [](const std::wstring& path) {
+		std::ifstream in(prtu::toOSNarrowFromUTF16(path), std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	};
+
+	const auto writeFile = [](const std::wstring& path, const std::string& content) {
+		std::ofstream out(prtu::toOSNarrowFromUTF16(path), std::ios::binary | std::ios::trunc);
+		out.write(content.data(), content.size());
+	};
+
+	SECTION("truncated file is a miss") {
+		cache.put(key, result);
+		const std::vector<std::wstring> entries = listEntries();
+		REQUIRE(entries.size() == 1);
+		const std::string content = readFile(entries[0]);
+		for (const size_t size : {content.size() / 2, content.size() - 1}) {
+			writeFile(entries[0], content.substr(0, size));
+			CHECK(cache.get(key) == nullptr);
+		}
+	}
+
+	SECTION("corrupt counts are a miss") {
+		cache.put(key, result);
+		const std::vector<std::wstring> entries = listEntries();
+		REQUIRE(entries.size() == 1);
+		const std::string content = readFile(entries[0]);
+
+		// the vertex count follows magic, version, key hash and mesh flag
+		const size_t vertexCountOffset = 2 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint8_t);
+		for (const uint64_t count : {std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max() / 8 + 1,
+		                             static_cast<uint64_t>(content.size())}) {
+			std::string corrupt = content;
+			std::memcpy(&corrupt[vertexCountOffset], &count, sizeof(count));
+			writeFile(entries[0], corrupt);
+			CHECK(cache.get(key) == nullptr);
+		}
+	}
+
+	SECTION("size budget") {
+		cache.put(key, result);
+		const std::vector<std::wstring> entries = listEntries();
+		REQUIRE(entries.size() == 1);
+		const uint64_t entrySize = static_cast<uint64_t>(prtu::getFileSize(entries[0]));
+
+		// two entries exceed the budget, one is removed again
+		DiskGenerationCache boundedCache(cacheDir, entrySize + entrySize / 2);
+		GenerationCache::Key otherKey = key;
+		otherKey.shapeHash = 2;
+		boundedCache.put(otherKey, result);
+		CHECK(listEntries().size() == 1);
+		const bool hasKey = boundedCache.get(key) != nullptr;
+		const bool hasOtherKey = boundedCache.get(otherKey) != nullptr;
+		CHECK(hasKey != hasOtherKey);
+	}
+
+	prtu::remove_all(cacheDir);
+}
+
+TEST_CASE("disk generation cache and unpack directories") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::wstring tmpDir = prtu::getProcessTempDir(L"serlio_test_disk_cache_assets_");
+	const std::wstring sep(1, prtu::getDirSeparator<wchar_t>());
+	const std::wstring unpackDir = tmpDir + sep + L"unpack";
+	DiskGenerationCache diskCache(tmpDir + sep + L"generation");
+
+	GenerationCache::Key key;
+	key.shapeHash = 1;
+	key.ruleFile = L"bldg.cgb";
+	key.startRule = L"Default$Lot";
+
+	GenerationResult result;
+	result.hasMesh = true;
+	result.vertices = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 1.0, 0.0, 1.0};
+	result.faceCounts = {3};
+	result.vertexIndices = {0, 1, 2};
+	result.faceRanges = {0, 1};
+
+	SECTION("session specific unpack directory") {
+		{
+			ResolveMapCache resolveMapCache(unpackDir);
+			REQUIRE(resolveMapCache.get(rpk).first != nullptr);
+			key.rpkFingerprint = resolveMapCache.getFingerprint(rpk);
+			key.assetLocation = resolveMapCache.getAssetLocation(rpk);
+			CHECK(key.assetLocation != 0);
+
+			// e.g. a texture of the rpk
+			AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+			amb->setString(L"diffuseMap", (unpackDir + sep + L"rpk_1" + sep + L"assets" + sep + L"tex.jpg").c_str());
+			result.materials.emplace_back(amb->createAttributeMap());
+			diskCache.put(key, result);
+		}
+
+		// the next session must not get paths into the removed unpack directory
+		REQUIRE(prtu::getFileModificationTime(unpackDir) == -1);
+		CHECK(diskCache.get(key) == nullptr);
+	}
+
+	SECTION("unpack store") {
+		{
+			ResolveMapCache resolveMapCache(unpackDir);
+			resolveMapCache.setUnpackStore(
+			        std::make_shared<RPKUnpackStore>(tmpDir + sep + L"store", RPKUnpackStore::DEFAULT_SIZE_BUDGET));
+			REQUIRE(resolveMapCache.get(rpk).first != nullptr);
+			key.rpkFingerprint = resolveMapCache.getFingerprint(rpk);
+			key.assetLocation = resolveMapCache.getAssetLocation(rpk);
+			CHECK(key.assetLocation == 0);
+			diskCache.put(key, result);
+		}
+
+		// the unpacked files stay in the store
+		REQUIRE(prtu::getFileModificationTime(unpackDir) == -1);
+		CHECK(diskCache.get(key) != nullptr);
+	}
+
+	prtu::remove_all(tmpDir);
+}
+
+TEST_CASE("batch input") {
+	const std::wstring inputDir = prtu::getProcessTempDir(L"serlio_test_batch_input_");
+	REQUIRE(prtu::create_directory(inputDir));
+	const auto writeFile = [&inputDir](const std::string& name, const std::string& content) {
+		const std::string path = prtu::toOSNarrowFromUTF16(inputDir) + prtu::getDirSeparator<char>() + name;
+		std::ofstream(path, std::ios::binary) << content;
+		return path;
+	};
+
+	SECTION("obj objects become initial shapes") {
+		const std::string path = writeFile("shapes.obj", "v 0 0 0\nv 1 0 0\nv 1 0 1\nv 0 0 1\n"
+		                                                 "o first\nf 1 2 3 4\n"
+		                                                 "o second\nf 1/1/1 3/1/1 4/1/1\nf -4 -3 -2\n");
+		const std::vector<batch::InitialShapeGeometry> shapes = batch::readObj(path);
+		REQUIRE(shapes.size() == 2);
+		CHECK(shapes[0].name == L"first");
+		CHECK(shapes[0].vertexCoords.size() == 12);
+		CHECK(shapes[0].indices == std::vector<uint32_t>({0, 1, 2, 3}));
+		CHECK(shapes[0].faceCounts == std::vector<uint32_t>({4}));
+
+		// only the vertices used by the shape, in order of their first use
+		CHECK(shapes[1].name == L"second");
+		CHECK(shapes[1].vertexCoords == std::vector<double>({0, 0, 0, 1, 0, 1, 0, 0, 1, 1, 0, 0}));
+		CHECK(shapes[1].indices == std::vector<uint32_t>({0, 1, 2, 0, 3, 1}));
+		CHECK(shapes[1].faceCounts == std::vector<uint32_t>({3, 3}));
+	}
+
+	SECTION("invalid obj input") {
+		CHECK_THROWS_AS(batch::readObj(writeFile("index.obj", "v 0 0 0\nf 1 2 3\n")), std::runtime_error);
+		CHECK_THROWS_AS(batch::readObj(writeFile("face.obj", "v 0 0 0\nv 1 0 0\nf 1 2\n")), std::runtime_error);
+		CHECK_THROWS_AS(batch::readObj(writeFile("empty.obj", "v 0 0 0\n")), std::runtime_error);
+	}
+
+	SECTION("seed of the input mesh") {
+		std::vector<batch::InitialShapeGeometry> shapes(2);
+		shapes[0].vertexCoords = {0, 0, 0, 2, 0, 0};
+		shapes[1].vertexCoords = {2, 0, 4, 0, 0, 4};
+
+		// like serlioAssign, the centroid of the vertices (not of the coordinates)
+		CHECK(batch::computeSeed(shapes) == prtu::computeSeed(1.0f, 2.0f));
+	}
+
+	SECTION("json attributes") {
+		const std::string path = writeFile("attributes.json", R"({ "height": 12.5, "Default$style": "modern",
+		                                                           "Other$flat": true, "levels": [1, 2, 3],
+		                                                           "names": ["a", "b\"c"] })");
+		const AttributeMapUPtr attributes = batch::readAttributes(path);
+		REQUIRE(attributes != nullptr);
+		CHECK(attributes->getFloat(L"Default$height") == 12.5);
+		CHECK(std::wstring(attributes->getString(L"Default$style")) == L"modern");
+		CHECK(attributes->getBool(L"Other$flat"));
+
+		size_t count = 0;
+		const double* levels = attributes->getFloatArray(L"Default$levels", &count);
+		REQUIRE(count == 3);
+		CHECK(levels[2] == 3.0);
+		const wchar_t* const* names = attributes->getStringArray(L"Default$names", &count);
+		REQUIRE(count == 2);
+		CHECK(std::wstring(names[1]) == L"b\"c");
+	}
+
+	SECTION("invalid json input") {
+		CHECK_THROWS_AS(batch::readAttributes(writeFile("value.json", R"({ "height": })")), std::runtime_error);
+		CHECK_THROWS_AS(batch::readAttributes(writeFile("colon.json", R"({ "height" 1 })")), std::runtime_error);
+		CHECK_THROWS_AS(batch::readAttributes(writeFile("open.json", R"({ "height": [1, 2 })")), std::runtime_error);
+	}
+
+	prtu::remove_all(inputDir);
+}
+
+TEST_CASE("initial shape per face") {
+	// two quads sharing an edge
+	const PRTMesh mesh({0, 0, 0, 1, 0, 0, 2, 0, 0, 0, 0, 1, 1, 0, 1, 2, 0, 1}, {0, 3, 4, 1, 1, 4, 5, 2}, {4, 4});
+	const std::vector<PRTMesh> faces = mesh.splitFaces();
+	REQUIRE(faces.size() == 2);
+	for (const PRTMesh& face : faces) {
+		CHECK(face.faceCountsCount() == 1);
+		CHECK(face.indicesCount() == 4);
+		CHECK(face.vcCount() == 12);
+	}
+	const std::vector<double> secondFaceCoords(faces[1].vertexCoords(), faces[1].vertexCoords() + faces[1].vcCount());
+	CHECK(secondFaceCoords == std::vector<double>({1, 0, 0, 1, 0, 1, 2, 0, 1, 2, 0, 0}));
+
+	// each face gets its own seed, derived from the centroid of the face
+	const int32_t seed0 = prtu::computeSeed(faces[0].vertexCoords(), faces[0].vcCount());
+	const int32_t seed1 = prtu::computeSeed(faces[1].vertexCoords(), faces[1].vcCount());
+	CHECK(seed0 != seed1);
+	CHECK(faces[0].hash() != faces[1].hash());
+
+	// the node seed is added to the face seed without signed integer overflow
+	CHECK(prtu::addSeeds(7, seed1) == 7 + seed1);
+	CHECK(prtu::addSeeds(std::numeric_limits<int32_t>::max(), 1) == std::numeric_limits<int32_t>::min());
+	CHECK(prtu::addSeeds(std::numeric_limits<int32_t>::min(), -1) == std::numeric_limits<int32_t>::max());
+}
+
+TEST_CASE("attribute map hash") {
+	AttributeMapBuilderUPtr amb1(prt::AttributeMapBuilder::create());
+	amb1->setFloat(L"height", 10.0);
+	amb1->setString(L"style", L"modern");
+	const AttributeMapUPtr am1(amb1->createAttributeMap());
+
+	AttributeMapBuilderUPtr amb2(prt::AttributeMapBuilder::create());
+	amb2->setString(L"style", L"modern");
+	amb2->setFloat(L"height", 10.0);
+	const AttributeMapUPtr am2(amb2->createAttributeMap());
+
+	CHECK(prtu::hashAttributeMap(am1.get()) == prtu::hashAttributeMap(am2.get()));
+
+	amb2->setFloat(L"height", 11.0);
+	const AttributeMapUPtr am3(amb2->createAttributeMap());
+	CHECK(prtu::hashAttributeMap(am1.get()) != prtu::hashAttributeMap(am3.get()));
+}
+
+TEST_CASE("interrupt generation") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const ResolveMapSPtr resolveMap = prtCtx->mResolveMapCache->get(rpk).first;
+	REQUIRE(resolveMap);
+	const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const RuleFileInfoUPtr ruleInfo(prt::createRuleFileInfo(resolveMap->getString(ruleFile.c_str())));
+	REQUIRE(ruleInfo);
+	const std::wstring startRule = prtu::detectStartRule(ruleInfo);
+
+	const double vertexCoords[] = {0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0, 0.0, 0.0};
+	const uint32_t indices[] = {0, 1, 2, 3};
+	const uint32_t faceCounts[] = {4};
+	const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+	const AttributeMapUPtr attributes(amb->createAttributeMap());
+	const InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+	REQUIRE(isb->setGeometry(vertexCoords, 12, indices, 4, faceCounts, 1) == prt::STATUS_OK);
+	isb->setAttributes(ruleFile.c_str(), startRule.c_str(), 0, L"", attributes.get(), resolveMap.get());
+	const InitialShapeUPtr shape(isb->createInitialShapeAndReset());
+	const prt::InitialShape* shapes[] = {shape.get()};
+
+	const wchar_t* encIDs[] = {L"MayaEncoder"};
+	const AttributeMapUPtr encOpts = prtu::createValidatedOptions(encIDs[0]);
+	const prt::AttributeMap* encOptsPtrs[] = {encOpts.get()};
+	auto generate = [&](MayaCallbacks& callbacks) {
+		return prt::generate(shapes, 1, nullptr, encIDs, 1, encOptsPtrs, &callbacks, prtCtx->theCache.get(), nullptr);
+	};
+
+	SECTION("not interrupted") {
+		std::atomic<bool> cancelled(false);
+		MayaCallbacks callbacks(1, [&cancelled]() { return cancelled.load(); });
+		const prt::Status status =
+		        generateInterruptible([&]() { return generate(callbacks); }, []() { return false; }, cancelled);
+		CHECK(status == prt::STATUS_OK);
+		CHECK_FALSE(cancelled);
+		const GenerationResultUPtr result = callbacks.takeResult();
+		REQUIRE(result);
+		CHECK(result->hasMesh);
+	}
+
+	SECTION("interrupted while generating") {
+		// the first cancellation check of the encoder blocks until the interrupt has been noticed
+		std::atomic<bool> cancelled(false);
+		std::atomic<bool> generating(false);
+		MayaCallbacks callbacks(1, [&cancelled, &generating]() {
+			generating = true;
+			const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while (!cancelled && std::chrono::steady_clock::now() < timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			return cancelled.load();
+		});
+		generateInterruptible([&]() { return generate(callbacks); }, [&generating]() { return generating.load(); },
+		                      cancelled);
+		CHECK(cancelled);
+		const GenerationResultUPtr result = callbacks.takeResult();
+		CHECK((!result || !result->hasMesh));
+	}
+}
+
+TEST_CASE("preview face budget") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const ResolveMapSPtr resolveMap = prtCtx->mResolveMapCache->get(rpk).first;
+	REQUIRE(resolveMap);
+	const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const RuleFileInfoUPtr ruleInfo(prt::createRuleFileInfo(resolveMap->getString(ruleFile.c_str())));
+	REQUIRE(ruleInfo);
+	const std::wstring startRule = prtu::detectStartRule(ruleInfo);
+
+	const double vertexCoords[] = {0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0, 0.0, 0.0};
+	const uint32_t indices[] = {0, 1, 2, 3};
+	const uint32_t faceCounts[] = {4};
+	const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+	const AttributeMapUPtr attributes(amb->createAttributeMap());
+	const InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+	REQUIRE(isb->setGeometry(vertexCoords, 12, indices, 4, faceCounts, 1) == prt::STATUS_OK);
+	isb->setAttributes(ruleFile.c_str(), startRule.c_str(), 0, L"", attributes.get(), resolveMap.get());
+	const InitialShapeUPtr shape(isb->createInitialShapeAndReset());
+	const prt::InitialShape* shapes[] = {shape.get()};
+
+	const wchar_t* encIDs[] = {L"MayaEncoder"};
+	auto generate = [&](int32_t maxFaces) {
+		const AttributeMapBuilderUPtr optionsBuilder(prt::AttributeMapBuilder::create());
+		optionsBuilder->setInt(EO_MAX_FACES, maxFaces);
+		const AttributeMapUPtr options(optionsBuilder->createAttributeMap());
+		const AttributeMapUPtr encOpts = prtu::createValidatedOptions(encIDs[0], options.get());
+		const prt::AttributeMap* encOptsPtrs[] = {encOpts.get()};
+		MayaCallbacks callbacks(1);
+		const prt::Status status = prt::generate(shapes, 1, nullptr, encIDs, 1, encOptsPtrs, &callbacks,
+		                                         prtCtx->theCache.get(), nullptr);
+		CHECK(status == prt::STATUS_OK);
+		return callbacks.takeResult();
+	};
+
+	const GenerationResultUPtr full = generate(0);
+	REQUIRE(full);
+	REQUIRE_FALSE(full->faceCounts.empty());
+
+	// the first leaf shape is kept even if it alone exceeds the budget
+	const GenerationResultUPtr limited = generate(1);
+	REQUIRE(limited);
+	CHECK_FALSE(limited->faceCounts.empty());
+	CHECK(limited->faceCounts.size() <= full->faceCounts.size());
+}
+
+TEST_CASE("generate several initial shapes") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const ResolveMapSPtr resolveMap = prtCtx->mResolveMapCache->get(rpk).first;
+	REQUIRE(resolveMap);
+	const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const RuleFileInfoUPtr ruleInfo(prt::createRuleFileInfo(resolveMap->getString(ruleFile.c_str())));
+	REQUIRE(ruleInfo);
+	const std::wstring startRule = prtu::detectStartRule(ruleInfo);
+
+	// unit squares 10 units apart along the x axis, generated in parallel by PRT
+	constexpr size_t SHAPE_COUNT = 16;
+	constexpr double SPACING = 10.0;
+	const uint32_t indices[] = {0, 1, 2, 3};
+	const uint32_t faceCounts[] = {4};
+	const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+	const AttributeMapUPtr attributes(amb->createAttributeMap());
+	const InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
+	std::vector<InitialShapeUPtr> shapes;
+	for (size_t i = 0; i < SHAPE_COUNT; i++) {
+		const double x = static_cast<double>(i) * SPACING;
+		const double vertexCoords[] = {x, 0.0, 0.0, x, 0.0, 1.0, x + 1.0, 0.0, 1.0, x + 1.0, 0.0, 0.0};
+		REQUIRE(isb->setGeometry(vertexCoords, 12, indices, 4, faceCounts, 1) == prt::STATUS_OK);
+		isb->setAttributes(ruleFile.c_str(), startRule.c_str(), 0, L"", attributes.get(), resolveMap.get());
+		shapes.emplace_back(isb->createInitialShapeAndReset());
+	}
+	const InitialShapeNOPtrVector shapePtrs = prtu::toPtrVec(shapes);
+
+	const wchar_t* encIDs[] = {L"MayaEncoder"};
+	const AttributeMapUPtr encOpts = prtu::createValidatedOptions(encIDs[0]);
+	const prt::AttributeMap* encOptsPtrs[] = {encOpts.get()};
+	MayaCallbacks callbacks(SHAPE_COUNT);
+	const prt::Status status = prt::generate(shapePtrs.data(), shapePtrs.size(), nullptr, encIDs, 1, encOptsPtrs,
+	                                         &callbacks, prtCtx->theCache.get(), nullptr);
+	REQUIRE(status == prt::STATUS_OK);
+
+	// every result ends up at the index of its initial shape
+	for (size_t i = 0; i < SHAPE_COUNT; i++) {
+		const GenerationResultUPtr result = callbacks.takeResult(i);
+		REQUIRE(result);
+		REQUIRE(result->hasMesh);
+		REQUIRE_FALSE(result->vertices.empty());
+		double sumX = 0.0;
+		for (size_t v = 0; v < result->vertices.size(); v += 3)
+			sumX += result->vertices[v];
+		const double meanX = sumX / static_cast<double>(result->vertices.size() / 3);
+		CHECK(meanX >= static_cast<double>(i) * SPACING - 1.0);
+		CHECK(meanX <= static_cast<double>(i) * SPACING + 2.0);
+	}
+	CHECK_FALSE(callbacks.takeResult(SHAPE_COUNT));
+}
+
+TEST_CASE("occlusion manager") {
+	OcclusionManager occlusionManager;
+	const int owner1 = 0;
+	const int owner2 = 0;
+
+	auto makeInput = [](uint64_t inputHash) {
+		OcclusionManager::OccluderInput input;
+		input.inputHash = inputHash;
+		input.shapes.resize(2);
+		return input;
+	};
+
+	CHECK_FALSE(occlusionManager.isDirty());
+
+	occlusionManager.setInput(&owner1, makeInput(1));
+	occlusionManager.setInput(&owner2, makeInput(2));
+	CHECK(occlusionManager.isDirty());
+	CHECK(occlusionManager.hasInput(&owner1, 1));
+	CHECK_FALSE(occlusionManager.hasInput(&owner1, 2));
+
+	// shapes are only part of the occlusion set after a rebuild
+	const OcclusionManager::Occluders occluders = occlusionManager.getOccluders(&owner1);
+	CHECK(occluders.occlusionSet == nullptr);
+	CHECK(occluders.handles.empty());
+	CHECK(occluders.epoch == 0);
+
+	occlusionManager.removeInput(&owner2);
+	CHECK_FALSE(occlusionManager.hasInput(&owner2, 2));
+}
+
+TEST_CASE("occlusion manager epochs") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const ResolveMapSPtr resolveMap = prtCtx->mResolveMapCache->get(rpk).first;
+	REQUIRE(resolveMap);
+	const std::wstring ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const RuleFileInfoUPtr ruleInfo(prt::createRuleFileInfo(resolveMap->getString(ruleFile.c_str())));
+	REQUIRE(ruleInfo);
+	const std::wstring startRule = prtu::detectStartRule(ruleInfo);
+
+	// unit squares 2 units apart along the x axis
+	auto makeInput = [&](uint64_t inputHash, size_t shapeCount, double x) {
+		OcclusionManager::OccluderInput input;
+		input.inputHash = inputHash;
+		input.ruleFile = ruleFile;
+		input.startRule = startRule;
+		input.attributes.reset(AttributeMapBuilderUPtr(prt::AttributeMapBuilder::create())->createAttributeMap());
+		input.resolveMap = resolveMap;
+		for (size_t i = 0; i < shapeCount; i++) {
+			OcclusionManager::OccluderShape shape;
+			const double sx = x + 2.0 * static_cast<double>(i);
+			shape.vertexCoords = {sx, 0.0, 0.0, sx, 0.0, 1.0, sx + 1.0, 0.0, 1.0, sx + 1.0, 0.0, 0.0};
+			shape.indices = {0, 1, 2, 3};
+			shape.faceCounts = {4};
+			input.shapes.push_back(std::move(shape));
+		}
+		return input;
+	};
+
+	OcclusionManager occlusionManager;
+	MayaCallbacks callbacks(0);
+	const int single1 = 0;
+	const int single2 = 0;
+	const int perFace = 0;
+	occlusionManager.setInput(&single1, makeInput(1, 1, 0.0));
+	occlusionManager.setInput(&single2, makeInput(2, 1, 10.0));
+	occlusionManager.setInput(&perFace, makeInput(3, 2, 20.0));
+	occlusionManager.rebuild(&callbacks, prtCtx->theCache.get());
+	CHECK_FALSE(occlusionManager.isDirty());
+
+	const OcclusionManager::Occluders occluders1 = occlusionManager.getOccluders(&single1);
+	REQUIRE(occluders1.occlusionSet != nullptr);
+	CHECK(occluders1.handles.size() == 1);
+	CHECK(occluders1.epoch != 0);
+	const uint64_t epoch1 = occluders1.epoch;
+	const uint64_t epoch2 = occlusionManager.getEpoch(&single2);
+	const uint64_t perFaceEpoch = occlusionManager.getEpoch(&perFace);
+
+	SECTION("a changed owner keeps its occluders until the next rebuild") {
+		occlusionManager.setInput(&single1, makeInput(4, 1, 0.5));
+		CHECK(occlusionManager.isDirty());
+		const OcclusionManager::Occluders changed = occlusionManager.getOccluders(&single1);
+		CHECK(changed.occlusionSet == occluders1.occlusionSet);
+		CHECK(changed.handles == occluders1.handles);
+		CHECK(changed.epoch == epoch1);
+	}
+
+	SECTION("the occluders of a single shape only matter to the other owners") {
+		occlusionManager.setInput(&single1, makeInput(4, 1, 0.5));
+		occlusionManager.rebuild(&callbacks, prtCtx->theCache.get());
+		CHECK(occlusionManager.getEpoch(&single1) == epoch1);
+		CHECK(occlusionManager.getEpoch(&single2) != epoch2);
+		CHECK(occlusionManager.getEpoch(&perFace) != perFaceEpoch);
+	}
+
+	SECTION("the shapes of an owner see each other") {
+		occlusionManager.setInput(&perFace, makeInput(5, 2, 20.5));
+		occlusionManager.rebuild(&callbacks, prtCtx->theCache.get());
+		CHECK(occlusionManager.getEpoch(&perFace) != perFaceEpoch);
+		CHECK(occlusionManager.getEpoch(&single1) != epoch1);
+	}
+
+	SECTION("removed occluders") {
+		occlusionManager.removeInput(&single2);
+		CHECK(occlusionManager.isDirty());
+		occlusionManager.rebuild(&callbacks, prtCtx->theCache.get());
+		CHECK(occlusionManager.getEpoch(&single1) != epoch1);
+		CHECK(occlusionManager.getEpoch(&single2) == 0);
+	}
+}
+
 // we use a custom main function to manage PRT lifetime
 int main(int argc, char* argv[]) {
 	const std::vector<std::wstring> addExtDirs = {